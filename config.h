@@ -8,10 +8,27 @@
 #include "stb_image.h"
 #include "tiny_obj_loader.h"
 #include <glm/gtc/type_ptr.hpp>
+#include <glm/gtc/packing.hpp>
+#include <glm/gtc/quaternion.hpp>
 #include <glm/gtx/euler_angles.hpp>
 #include <sstream>
+#include <iomanip>
 #include <fstream>
 #include <string>
+#include <cstdint>
+#include <limits>
+#include <cstring>
+#include <thread>
+#include <chrono>
+#include <future>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <algorithm>
+#include <unordered_map>
+#include <unordered_set>
+#include <map>
 
 struct image
 {
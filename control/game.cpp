@@ -6,6 +6,7 @@ Game::Game(GameCreateInfo* createInfo)
 	this->centerXMouse = createInfo->width / 2;
 	this->height = createInfo->height;
 	this->centerYMouse = createInfo->height / 2;
+	this->textureBudget = createInfo->textureBudget;
 
 	//seconds since program started.
 	lastTime = glfwGetTime();
@@ -15,8 +16,9 @@ Game::Game(GameCreateInfo* createInfo)
 	window = makeWindow();
 	glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_HIDDEN);
 
-	renderer = new Engine(width, height);
 	scene = new Scene();	
+	renderer = new Engine(width, height, textureBudget, scene);
+	renderer->populateScene(scene);
 }
 
 
@@ -7,6 +7,8 @@ struct GameCreateInfo
 {
 	int width;
 	int height;
+	//memory the material textures may take, in bytes.
+	size_t textureBudget;
 };
 
 enum class returnCode
@@ -29,6 +31,7 @@ private:
 
 	GLFWwindow* window;
 	int width, height, centerYMouse, centerXMouse;
+	size_t textureBudget;
 	Scene* scene;
 	Engine* renderer;
 
@@ -1,21 +1,86 @@
 #include "config.h"
 #include "control/game.h"
+#include "view/clusterHierarchy.h"
+#include "view/textureContainer.h"
+#include "view/image.h"
+#include "view/virtualTextureFile.h"
+#include "view/vertexTransform.h"
+
+int main(int argc, char** argv)
+{
+	//offline step for meshes too large to load, the engine streams the result.
+	if (argc == 4 && std::string(argv[1]) == "--build-clusters")
+	{
+		ClusterBuildInfo buildInfo;
+		buildInfo.sourceFilename = argv[2];
+		buildInfo.clusterFilename = argv[3];
+		buildInfo.preTransform = glm::mat4(1.0f);
+		buildInfo.leafTriangles = 4096;
+		buildInfo.sliceBytes = 256 << 20;
+		return util::buildClusterHierarchy(&buildInfo) ? 0 : 1;
+	}
+
+	//compares the obj loader's vertex transform kernels with the per vertex path, no window needed.
+	if (argc >= 2 && argc <= 3 && std::string(argv[1]) == "--bench-transform")
+	{
+		size_t vertexCount = argc == 3 ? size_t(std::max(1, atoi(argv[2]))) : 1000003;
+		util::benchmarkVertexTransform(vertexCount, 10);
+		return 0;
+	}
+
+	//offline step for textures too large to load, the engine streams textures/terrain.vtex onto the terrain.
+	if (argc == 4 && std::string(argv[1]) == "--build-virtual-texture")
+		return util::buildVirtualTexture(argv[2], argv[3]) ? 0 : 1;
+
+	//offline step for textures, the engine picks up <image>.ktx2 next to the image on its own.
+	if (argc == 5 && std::string(argv[1]) == "--compress-texture")
+	{
+		std::string formatName = argv[4];
+		BlockFormat format;
+		if (formatName == "bc1")
+			format = BlockFormat::BC1;
+		else if (formatName == "bc3")
+			format = BlockFormat::BC3;
+		else if (formatName == "bc5")
+			format = BlockFormat::BC5;
+		else if (formatName == "bc7")
+			format = BlockFormat::BC7;
+		else
+		{
+			std::cout << "Unknown block format " << formatName << ", expected bc1, bc3, bc5 or bc7\n";
+			return 1;
+		}
+
+		image source = util::loadFromFile(argv[2]);
+		if (!source.pixels)
+		{
+			std::cout << "Failed to load texture " << argv[2] << '\n';
+			return 1;
+		}
+		std::vector<MipLevel> chain = util::buildMipChain(source.pixels, source.width, source.height);
+		util::freeImgMem(source);
+
+		std::vector<std::vector<unsigned char>> levels;
+		for (const MipLevel& level : chain)
+			levels.push_back(util::compressLevel(level, format));
+		return util::ktx2Write(argv[3], format, chain[0].width, chain[0].height, levels) ? 0 : 1;
+	}
 
-int main()
-{		
 	int width = 640;
 	int height = 480;
 	int mouseXStart = width / 2;
 	int mouseYStart = height / 2;
+	//texture memory in megabytes, lower it on machines with little video memory.
+	size_t textureBudget = 512;
+	if (argc == 3 && std::string(argv[1]) == "--texture-budget")
+		textureBudget = size_t(std::max(1, atoi(argv[2])));
 	
 	GameCreateInfo appInfo;
 	appInfo.width = width;
 	appInfo.height = height;
+	appInfo.textureBudget = textureBudget << 20;
 	Game* app = new Game(&appInfo);
 
-
-	Engine* renderer = new Engine(width, height);
-
 	returnCode nextAction = returnCode::CONTINUE;
 	while (nextAction == returnCode::CONTINUE)
 	{
@@ -4,6 +4,7 @@ Cube::Cube(CubeCreateInfo* createInfo)
 {
 	this->position = createInfo->positions;
 	this->eulers = createInfo->eulers;
+	this->lod = 0;
 }
 
 void Cube::update(float rate)
@@ -11,6 +11,8 @@ class Cube
 public:
 	glm::vec3 position, eulers;
 	glm::mat4 modelTransform;
+	//level of detail the renderer picked last frame, kept so it doesn't flicker between two.
+	unsigned int lod;
 	Cube(CubeCreateInfo* createInfo);
 	void update(float rate);
 };
\ No newline at end of file
@@ -39,6 +39,8 @@ Scene::~Scene()
 	delete player;
 	for(Light* light : lights)
 		delete light;
+	for (SceneNode* node : nodes)
+		delete node;
 }
 
 void Scene::update(float rate)
@@ -52,6 +54,11 @@ void Scene::movePlayer(glm::vec3 dPos)
 	player->position += dPos;
 }
 
+void Scene::addNode(SceneNodeCreateInfo* createInfo)
+{
+	nodes.push_back(new SceneNode(createInfo));
+}
+
 void Scene::spinPlayer(glm::vec3 dEulers)
 {
 	player->eulers += dEulers;
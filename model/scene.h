@@ -3,6 +3,7 @@
 #include "cube.h"
 #include "player.h"
 #include "light.h"
+#include "sceneNode.h"
 
 //scene has access to all objects, like ue levels. When we update objects, its done via scene.
 class Scene
@@ -13,8 +14,10 @@ public:
 	void update(float rate);
 	void movePlayer(glm::vec3 dPos);
 	void spinPlayer(glm::vec3 dEulers);
+	void addNode(SceneNodeCreateInfo* createInfo);
 
 	Cube* cube;
 	Player* player;
 	std::vector<Light*> lights;
+	std::vector<SceneNode*> nodes;
 };
\ No newline at end of file
@@ -0,0 +1,7 @@
+#include "sceneNode.h"
+
+SceneNode::SceneNode(SceneNodeCreateInfo* createInfo)
+{
+	this->modelTransform = createInfo->modelTransform;
+	this->mesh = createInfo->mesh;
+}
@@ -0,0 +1,17 @@
+#pragma once
+#include "../config.h"
+
+struct SceneNodeCreateInfo
+{
+	glm::mat4 modelTransform;
+	unsigned int mesh;
+};
+
+//a placed mesh from a loaded glb, mesh indexes the meshes of the engine's GltfModel.
+class SceneNode
+{
+public:
+	glm::mat4 modelTransform;
+	unsigned int mesh;
+	SceneNode(SceneNodeCreateInfo* createInfo);
+};
@@ -0,0 +1,18 @@
+@echo off
+rem compiles the shaders to the SPIR-V modules the engine loads when the driver has ARB_gl_spirv.
+rem one module per feature set, the light count is a specialization constant. uniforms and
+rem samplers have fixed locations and bindings in the source, nothing is looked up by name.
+rem needs glslangValidator from the Vulkan SDK on the path.
+setlocal enabledelayedexpansion
+cd /d "%~dp0"
+if not exist spirv mkdir spirv
+set failed=0
+for %%b in ("" ".bindless") do for %%v in ("" ".virtual") do for %%o in ("" ".octahedral") do (
+	set defines=
+	if not "%%~b"=="" set defines=!defines! -DBINDLESS
+	if not "%%~v"=="" set defines=!defines! -DVIRTUAL_TEXTURE
+	if not "%%~o"=="" set defines=!defines! -DOCTAHEDRAL_NORMALS
+	glslangValidator -G --auto-map-locations --auto-map-bindings -S vert !defines! -o spirv\vertex%%~b%%~v%%~o.spv vertex.txt || set failed=1
+	glslangValidator -G --auto-map-locations --auto-map-bindings -S frag !defines! -o spirv\fragment%%~b%%~v%%~o.spv fragment.txt || set failed=1
+)
+exit /b %failed%
@@ -0,0 +1,255 @@
+#include "bakedMesh.h"
+
+namespace
+{
+	const char bakedMeshMagic[4] = { 'B', 'M', 'S', 'H' };
+
+	//keeps every stream aligned for the widest type it holds.
+	uint64_t alignOffset(uint64_t offset)
+	{
+		return (offset + 15) & ~uint64_t(15);
+	}
+
+	//count elements of elementSize at offset lie inside the file, without overflowing on garbage.
+	bool inside(const mappedFile& baked, uint64_t offset, uint64_t count, uint64_t elementSize)
+	{
+		if (offset > baked.size || (elementSize && count > (baked.size - offset) / elementSize))
+			return false;
+		return true;
+	}
+
+	//offset + count <= total without overflowing.
+	bool inRange(uint64_t offset, uint64_t count, uint64_t total)
+	{
+		return offset <= total && count <= total - offset;
+	}
+
+	bool terminated(const char* text, size_t size)
+	{
+		return memchr(text, 0, size) != nullptr;
+	}
+}
+
+std::vector<unsigned char> util::packIndices(const MeshData& mesh)
+{
+	std::vector<unsigned char> packed;
+
+	if (mesh.indexType == GL_UNSIGNED_SHORT)
+	{
+		packed.resize(mesh.indices.size() * sizeof(uint16_t));
+		uint16_t* shortIndices = reinterpret_cast<uint16_t*>(packed.data());
+		for (size_t i = 0; i < mesh.indices.size(); ++i)
+			shortIndices[i] = uint16_t(mesh.indices[i]);
+	}
+	else
+	{
+		packed.resize(mesh.indices.size() * sizeof(uint32_t));
+		memcpy(packed.data(), mesh.indices.data(), packed.size());
+	}
+
+	return packed;
+}
+
+bool util::bakedMeshWrite(const char* bakedFilename, const char* sourceFilename, const MeshBakeSettings& settings,
+	const MeshData& mesh, const std::vector<unsigned char>& vertices, const std::vector<Meshlet>& meshlets)
+{
+	BakedMeshHeader header{};
+	memcpy(header.magic, bakedMeshMagic, sizeof(header.magic));
+	header.version = bakedMeshVersion;
+	if (!fileStamp(sourceFilename, header.sourceModifiedTime, header.sourceSize))
+		return false;
+	header.settings = settings;
+	header.layout = mesh.layout;
+	memcpy(header.boundsMin, glm::value_ptr(mesh.boundsMin), sizeof(header.boundsMin));
+	memcpy(header.boundsMax, glm::value_ptr(mesh.boundsMax), sizeof(header.boundsMax));
+	header.vertexCount = mesh.vertexCount;
+	header.indexCount = uint32_t(mesh.indices.size());
+	header.indexType = mesh.indexType;
+
+	std::vector<unsigned char> indices = packIndices(mesh);
+	header.vertexBytes = vertices.size();
+	header.indexBytes = indices.size();
+	std::vector<unsigned char> storedVertices, storedIndices;
+	if (settings.compress)
+	{
+		storedVertices = encodeVertices(vertices.data(), mesh.vertexCount, mesh.layout.stride);
+		storedIndices = encodeIndices(mesh.indices);
+	}
+	const std::vector<unsigned char>& vertexStream = settings.compress ? storedVertices : vertices;
+	const std::vector<unsigned char>& indexStream = settings.compress ? storedIndices : indices;
+
+	header.vertexOffset = alignOffset(sizeof(BakedMeshHeader));
+	header.vertexStoredBytes = vertexStream.size();
+	header.indexOffset = alignOffset(header.vertexOffset + header.vertexStoredBytes);
+	header.indexStoredBytes = indexStream.size();
+	header.meshletOffset = alignOffset(header.indexOffset + header.indexStoredBytes);
+	header.meshletCount = meshlets.size();
+	header.lodOffset = alignOffset(header.meshletOffset + header.meshletCount * sizeof(Meshlet));
+	header.lodCount = mesh.lods.size();
+	header.materialOffset = alignOffset(header.lodOffset + header.lodCount * sizeof(MeshLod));
+	header.materialCount = mesh.materials.size();
+	header.submeshOffset = alignOffset(header.materialOffset + header.materialCount * sizeof(MeshMaterial));
+	header.submeshCount = mesh.submeshes.size();
+	header.libraryOffset = alignOffset(header.submeshOffset + header.submeshCount * sizeof(MeshSubmesh));
+	header.libraryCount = mesh.materialLibraries.size();
+
+	std::vector<BakedLibraryStamp> libraries(mesh.materialLibraries.size(), BakedLibraryStamp{});
+	for (size_t i = 0; i < libraries.size(); ++i)
+	{
+		const std::string& library = mesh.materialLibraries[i];
+		if (library.size() >= sizeof(libraries[i].filename)
+			|| !fileStamp(library.c_str(), libraries[i].modifiedTime, libraries[i].size))
+			return false;
+		memcpy(libraries[i].filename, library.c_str(), library.size());
+	}
+
+	//written next to the old file and moved over it once complete, a crash mid write leaves the old one.
+	std::string temporaryFilename = std::string(bakedFilename) + ".tmp";
+	std::ofstream file(temporaryFilename, std::ios::binary | std::ios::trunc);
+	if (!file)
+		return false;
+
+	const char padding[16] = {};
+	file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	file.write(padding, header.vertexOffset - sizeof(header));
+	file.write(reinterpret_cast<const char*>(vertexStream.data()), header.vertexStoredBytes);
+	file.write(padding, header.indexOffset - header.vertexOffset - header.vertexStoredBytes);
+	file.write(reinterpret_cast<const char*>(indexStream.data()), header.indexStoredBytes);
+	file.write(padding, header.meshletOffset - header.indexOffset - header.indexStoredBytes);
+	file.write(reinterpret_cast<const char*>(meshlets.data()), meshlets.size() * sizeof(Meshlet));
+	file.write(padding, header.lodOffset - header.meshletOffset - header.meshletCount * sizeof(Meshlet));
+	file.write(reinterpret_cast<const char*>(mesh.lods.data()), mesh.lods.size() * sizeof(MeshLod));
+	file.write(padding, header.materialOffset - header.lodOffset - header.lodCount * sizeof(MeshLod));
+	file.write(reinterpret_cast<const char*>(mesh.materials.data()), mesh.materials.size() * sizeof(MeshMaterial));
+	file.write(padding, header.submeshOffset - header.materialOffset - header.materialCount * sizeof(MeshMaterial));
+	file.write(reinterpret_cast<const char*>(mesh.submeshes.data()), mesh.submeshes.size() * sizeof(MeshSubmesh));
+	file.write(padding, header.libraryOffset - header.submeshOffset - header.submeshCount * sizeof(MeshSubmesh));
+	file.write(reinterpret_cast<const char*>(libraries.data()), libraries.size() * sizeof(BakedLibraryStamp));
+
+	file.close();
+	if (!file)
+	{
+		std::remove(temporaryFilename.c_str());
+		return false;
+	}
+	return util::replaceFile(temporaryFilename.c_str(), bakedFilename);
+}
+
+bool util::bakedMeshIsCurrent(const mappedFile& baked, const char* sourceFilename, const MeshBakeSettings& settings)
+{
+	if (!baked.data || baked.size < sizeof(BakedMeshHeader))
+		return false;
+
+	const BakedMeshHeader* header = reinterpret_cast<const BakedMeshHeader*>(baked.data);
+	if (memcmp(header->magic, bakedMeshMagic, sizeof(header->magic)) != 0 || header->version != bakedMeshVersion)
+		return false;
+
+	int64_t modifiedTime, size;
+	if (!fileStamp(sourceFilename, modifiedTime, size)
+		|| modifiedTime != header->sourceModifiedTime || size != header->sourceSize)
+		return false;
+
+	if (memcmp(&header->settings, &settings, sizeof(settings)) != 0)
+		return false;
+
+	//a truncated or corrupt file must never reach the gpu.
+	if (!inside(baked, header->vertexOffset, header->vertexStoredBytes, 1)
+		|| !inside(baked, header->indexOffset, header->indexStoredBytes, 1)
+		|| !inside(baked, header->meshletOffset, header->meshletCount, sizeof(Meshlet))
+		|| !inside(baked, header->lodOffset, header->lodCount, sizeof(MeshLod))
+		|| !inside(baked, header->materialOffset, header->materialCount, sizeof(MeshMaterial))
+		|| !inside(baked, header->submeshOffset, header->submeshCount, sizeof(MeshSubmesh))
+		|| !inside(baked, header->libraryOffset, header->libraryCount, sizeof(BakedLibraryStamp)))
+		return false;
+
+	//the stream sizes have to follow from the counts, the uploads trust them.
+	uint64_t indexSize;
+	if (header->indexType == GL_UNSIGNED_SHORT)
+		indexSize = sizeof(uint16_t);
+	else if (header->indexType == GL_UNSIGNED_INT)
+		indexSize = sizeof(uint32_t);
+	else
+		return false;
+	if (header->vertexBytes != uint64_t(header->vertexCount) * header->layout.stride
+		|| header->indexBytes != uint64_t(header->indexCount) * indexSize)
+		return false;
+	//uncompressed streams are handed to the gpu straight out of the mapping.
+	if (!header->settings.compress
+		&& (header->vertexStoredBytes != header->vertexBytes || header->indexStoredBytes != header->indexBytes))
+		return false;
+
+	//the tables have to agree with each other and the streams, drawing indexes them unchecked.
+	if (header->submeshCount != header->lodCount * header->materialCount)
+		return false;
+	const MeshLod* lods = reinterpret_cast<const MeshLod*>(baked.data + header->lodOffset);
+	for (uint64_t i = 0; i < header->lodCount; ++i)
+		if (!inRange(lods[i].indexOffset, lods[i].indexCount, header->indexCount))
+			return false;
+	const MeshSubmesh* submeshes = reinterpret_cast<const MeshSubmesh*>(baked.data + header->submeshOffset);
+	for (uint64_t i = 0; i < header->submeshCount; ++i)
+		if (!inRange(submeshes[i].indexOffset, submeshes[i].indexCount, header->indexCount)
+			|| !inRange(submeshes[i].meshletOffset, submeshes[i].meshletCount, header->meshletCount)
+			|| submeshes[i].material >= header->materialCount)
+			return false;
+	const Meshlet* meshlets = reinterpret_cast<const Meshlet*>(baked.data + header->meshletOffset);
+	for (uint64_t i = 0; i < header->meshletCount; ++i)
+		if (!inRange(meshlets[i].indexOffset, meshlets[i].indexCount, header->indexCount))
+			return false;
+	//the names go on as c strings.
+	const MeshMaterial* materials = reinterpret_cast<const MeshMaterial*>(baked.data + header->materialOffset);
+	for (uint64_t i = 0; i < header->materialCount; ++i)
+		if (!terminated(materials[i].name, sizeof(materials[i].name))
+			|| !terminated(materials[i].diffuseTexture, sizeof(materials[i].diffuseTexture)))
+			return false;
+
+	const BakedLibraryStamp* libraries = reinterpret_cast<const BakedLibraryStamp*>(baked.data + header->libraryOffset);
+	for (uint64_t i = 0; i < header->libraryCount; ++i)
+	{
+		char filename[sizeof(libraries[i].filename) + 1] = {};
+		memcpy(filename, libraries[i].filename, sizeof(libraries[i].filename));
+		if (!fileStamp(filename, modifiedTime, size)
+			|| modifiedTime != libraries[i].modifiedTime || size != libraries[i].size)
+			return false;
+	}
+	return true;
+}
+
+bool util::bakedMeshView(const mappedFile& baked, MeshView& view,
+	std::vector<unsigned char>& vertexStorage, std::vector<unsigned char>& indexStorage)
+{
+	const BakedMeshHeader* header = reinterpret_cast<const BakedMeshHeader*>(baked.data);
+
+	view.vertices = baked.data + header->vertexOffset;
+	view.indices = baked.data + header->indexOffset;
+	if (header->settings.compress)
+	{
+		vertexStorage.resize(size_t(header->vertexBytes));
+		indexStorage.resize(size_t(header->indexBytes));
+		std::future<bool> vertices = std::async(std::launch::async, decodeVertices, vertexStorage.data(), size_t(header->vertexCount),
+			size_t(header->layout.stride), baked.data + header->vertexOffset, size_t(header->vertexStoredBytes));
+		bool indicesDecoded = decodeIndices(indexStorage.data(), header->indexCount, header->indexType, header->vertexCount,
+			baked.data + header->indexOffset, size_t(header->indexStoredBytes));
+		if (!vertices.get() || !indicesDecoded)
+			return false;
+		view.vertices = vertexStorage.data();
+		view.indices = indexStorage.data();
+	}
+
+	view.vertexBytes = size_t(header->vertexBytes);
+	view.indexBytes = size_t(header->indexBytes);
+	view.vertexCount = header->vertexCount;
+	view.indexCount = header->indexCount;
+	view.indexType = header->indexType;
+	view.layout = header->layout;
+	view.boundsMin = glm::make_vec3(header->boundsMin);
+	view.boundsMax = glm::make_vec3(header->boundsMax);
+	view.meshlets = reinterpret_cast<const Meshlet*>(baked.data + header->meshletOffset);
+	view.meshletCount = size_t(header->meshletCount);
+	view.lods = reinterpret_cast<const MeshLod*>(baked.data + header->lodOffset);
+	view.lodCount = size_t(header->lodCount);
+	view.materials = reinterpret_cast<const MeshMaterial*>(baked.data + header->materialOffset);
+	view.materialCount = size_t(header->materialCount);
+	view.submeshes = reinterpret_cast<const MeshSubmesh*>(baked.data + header->submeshOffset);
+	view.submeshCount = size_t(header->submeshCount);
+	return true;
+}
@@ -0,0 +1,88 @@
+#pragma once
+#include "../config.h"
+#include "objectLoader.h"
+#include "mappedFile.h"
+#include "vertexFormat.h"
+#include "meshlet.h"
+#include "meshSimplifier.h"
+#include "meshCodec.h"
+
+//bump whenever the layout of BakedMeshHeader or the streams after it changes.
+const uint32_t bakedMeshVersion = 7;
+
+//everything that changes the baked output besides the source, compared byte for byte.
+struct MeshBakeSettings
+{
+	float preTransform[16];
+	uint32_t optimize;
+	VertexFormat format;
+	uint32_t buildMeshlets;
+	uint32_t lodCount;
+	//vertex and index streams go through meshCodec.
+	uint32_t compress;
+};
+
+//an .mtl the baked materials were read from, checked like the source obj.
+struct BakedLibraryStamp
+{
+	char filename[240];
+	int64_t modifiedTime, size;
+};
+
+//start of every baked mesh file, the vertex and index streams follow at the given offsets.
+struct BakedMeshHeader
+{
+	char magic[4];
+	uint32_t version;
+	//stamp of the source obj and the settings it was baked with.
+	int64_t sourceModifiedTime, sourceSize;
+	MeshBakeSettings settings;
+	VertexLayout layout;
+	float boundsMin[3], boundsMax[3];
+	uint32_t vertexCount, indexCount, indexType;
+	//bytes are what the gpu gets, stored bytes what is in the file, smaller when compressed.
+	uint64_t vertexOffset, vertexBytes, vertexStoredBytes, indexOffset, indexBytes, indexStoredBytes;
+	uint64_t meshletOffset, meshletCount;
+	uint64_t lodOffset, lodCount;
+	uint64_t materialOffset, materialCount;
+	uint64_t submeshOffset, submeshCount;
+	uint64_t libraryOffset, libraryCount;
+};
+
+//streams ready for upload, pointing either into MeshData or straight into a mapped baked file.
+struct MeshView
+{
+	const void* vertices;
+	const void* indices;
+	size_t vertexBytes, indexBytes;
+	unsigned int vertexCount, indexCount, indexType;
+	VertexLayout layout;
+	glm::vec3 boundsMin, boundsMax;
+	const Meshlet* meshlets;
+	size_t meshletCount;
+	const MeshLod* lods;
+	size_t lodCount;
+	const MeshMaterial* materials;
+	size_t materialCount;
+	const MeshSubmesh* submeshes;
+	size_t submeshCount;
+};
+
+namespace util
+{
+	//indices narrowed to the mesh index type, the way they are stored on disk and on the gpu.
+	std::vector<unsigned char> packIndices(const MeshData& mesh);
+
+	//writes the final streams next to the source so the next start can skip parsing.
+	//vertices are the packed stream described by mesh.layout.
+	bool bakedMeshWrite(const char* bakedFilename, const char* sourceFilename, const MeshBakeSettings& settings,
+		const MeshData& mesh, const std::vector<unsigned char>& vertices, const std::vector<Meshlet>& meshlets);
+
+	//true if the mapped file is a baked mesh of this version made from the current source and settings.
+	bool bakedMeshIsCurrent(const mappedFile& baked, const char* sourceFilename, const MeshBakeSettings& settings);
+
+	//only valid while the baked file stays mapped. compressed streams are decoded into the storage
+	//vectors, vertices on a worker thread while this one does the indices. false if decoding failed.
+	bool bakedMeshView(const mappedFile& baked, MeshView& view,
+		std::vector<unsigned char>& vertexStorage, std::vector<unsigned char>& indexStorage);
+}
@@ -0,0 +1,77 @@
+#include "bakedTexture.h"
+
+namespace
+{
+	const char bakedTextureMagic[4] = { 'M', 'I', 'P', 'S' };
+
+	uint64_t alignOffset(uint64_t offset)
+	{
+		return (offset + 15) & ~uint64_t(15);
+	}
+}
+
+bool util::bakedTextureWrite(const char* bakedFilename, const char* sourceFilename, const std::vector<MipLevel>& chain)
+{
+	if (chain.empty() || chain.size() > bakedTextureMaxLevels)
+		return false;
+
+	BakedTextureHeader header{};
+	memcpy(header.magic, bakedTextureMagic, sizeof(header.magic));
+	header.version = bakedTextureVersion;
+	if (!fileStamp(sourceFilename, header.sourceModifiedTime, header.sourceSize))
+		return false;
+	header.width = chain[0].width;
+	header.height = chain[0].height;
+	header.levelCount = uint32_t(chain.size());
+	header.internalFormat = GL_RGBA8;
+
+	uint64_t offset = alignOffset(sizeof(header));
+	for (size_t l = 0; l < chain.size(); ++l)
+	{
+		header.levelOffset[l] = offset;
+		header.levelBytes[l] = chain[l].pixels.size();
+		offset = alignOffset(offset + header.levelBytes[l]);
+	}
+
+	std::ofstream file(bakedFilename, std::ios::binary | std::ios::trunc);
+	if (!file)
+		return false;
+
+	const char padding[16] = {};
+	file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	uint64_t written = sizeof(header);
+	for (size_t l = 0; l < chain.size(); ++l)
+	{
+		file.write(padding, header.levelOffset[l] - written);
+		file.write(reinterpret_cast<const char*>(chain[l].pixels.data()), header.levelBytes[l]);
+		written = header.levelOffset[l] + header.levelBytes[l];
+	}
+
+	return bool(file);
+}
+
+bool util::bakedTextureIsCurrent(const mappedFile& baked, const char* sourceFilename)
+{
+	if (!baked.data || baked.size < sizeof(BakedTextureHeader))
+		return false;
+
+	const BakedTextureHeader* header = reinterpret_cast<const BakedTextureHeader*>(baked.data);
+	if (memcmp(header->magic, bakedTextureMagic, sizeof(header->magic)) != 0 || header->version != bakedTextureVersion)
+		return false;
+
+	int64_t modifiedTime, size;
+	if (!fileStamp(sourceFilename, modifiedTime, size)
+		|| modifiedTime != header->sourceModifiedTime || size != header->sourceSize)
+		return false;
+
+	if (header->levelCount == 0 || header->levelCount > bakedTextureMaxLevels)
+		return false;
+
+	//a truncated write must never reach the gpu.
+	for (uint32_t l = 0; l < header->levelCount; ++l)
+	{
+		if (header->levelOffset[l] + header->levelBytes[l] > baked.size)
+			return false;
+	}
+	return true;
+}
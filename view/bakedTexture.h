@@ -0,0 +1,30 @@
+#pragma once
+#include "../config.h"
+#include "mappedFile.h"
+#include "mipChain.h"
+
+//bump whenever the layout of BakedTextureHeader or the levels after it changes.
+const uint32_t bakedTextureVersion = 1;
+//enough for a 32768 texel wide texture.
+const uint32_t bakedTextureMaxLevels = 16;
+
+//start of every baked texture file, the levels follow at the given offsets.
+struct BakedTextureHeader
+{
+	char magic[4];
+	uint32_t version;
+	//stamp of the source image.
+	int64_t sourceModifiedTime, sourceSize;
+	//the glTextureStorage2D internal format the levels are stored in.
+	uint32_t width, height, levelCount, internalFormat;
+	uint64_t levelOffset[bakedTextureMaxLevels], levelBytes[bakedTextureMaxLevels];
+};
+
+namespace util
+{
+	//writes the filtered chain next to the source so the next start can skip decoding and filtering.
+	bool bakedTextureWrite(const char* bakedFilename, const char* sourceFilename, const std::vector<MipLevel>& chain);
+
+	//true if the mapped file is a baked texture of this version made from the current source.
+	bool bakedTextureIsCurrent(const mappedFile& baked, const char* sourceFilename);
+}
@@ -0,0 +1,81 @@
+#include "bindlessMaterials.h"
+
+BindlessMaterials::BindlessMaterials()
+{
+	buffer = 0;
+}
+
+BindlessMaterials::~BindlessMaterials()
+{
+	clear();
+}
+
+bool BindlessMaterials::supported()
+{
+	return GLAD_GL_ARB_bindless_texture != 0;
+}
+
+void BindlessMaterials::build(const std::vector<Material*>& materials)
+{
+	clear();
+
+	std::vector<MaterialRecord> records(materials.size());
+	for (size_t i = 0; i < materials.size(); ++i)
+	{
+		//the handle is the same for every material sharing the texture, it's made resident once.
+		const Texture* texture = materials[i]->texture.get();
+		if (!residentHandles.count(texture))
+		{
+			uint64_t handle = glGetTextureHandleARB(texture->texture);
+			glMakeTextureHandleResidentARB(handle);
+			residentHandles[texture] = handle;
+		}
+
+		records[i].textureHandle = residentHandles[texture];
+		records[i].padding = 0;
+		records[i].diffuse[0] = materials[i]->diffuse.x;
+		records[i].diffuse[1] = materials[i]->diffuse.y;
+		records[i].diffuse[2] = materials[i]->diffuse.z;
+		records[i].diffuse[3] = 0.0f;
+		materials[i]->id = (unsigned int)i;
+	}
+
+	//handles get rewritten when a texture changes size.
+	glCreateBuffers(1, &buffer);
+	glNamedBufferStorage(buffer, std::max<size_t>(records.size(), 1) * sizeof(MaterialRecord), records.data(), GL_DYNAMIC_STORAGE_BIT);
+}
+
+void BindlessMaterials::release(const Texture* texture)
+{
+	auto resident = residentHandles.find(texture);
+	if (resident == residentHandles.end())
+		return;
+	glMakeTextureHandleNonResidentARB(resident->second);
+	residentHandles.erase(resident);
+}
+
+void BindlessMaterials::update(const Texture* texture, const std::vector<Material*>& materials)
+{
+	uint64_t handle = glGetTextureHandleARB(texture->texture);
+	glMakeTextureHandleResidentARB(handle);
+	residentHandles[texture] = handle;
+	for (const Material* material : materials)
+		if (material->texture.get() == texture)
+			glNamedBufferSubData(buffer, material->id * sizeof(MaterialRecord) + offsetof(MaterialRecord, textureHandle), sizeof(handle), &handle);
+}
+
+void BindlessMaterials::bind()
+{
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, materialBufferBinding, buffer);
+}
+
+void BindlessMaterials::clear()
+{
+	//textures must not be deleted while their handle is resident.
+	for (const auto& resident : residentHandles)
+		glMakeTextureHandleNonResidentARB(resident.second);
+	residentHandles.clear();
+	if (buffer)
+		glDeleteBuffers(1, &buffer);
+	buffer = 0;
+}
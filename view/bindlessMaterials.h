@@ -0,0 +1,45 @@
+#pragma once
+#include "../config.h"
+#include "material.h"
+
+//shader storage binding of the material records, the virtual texture requests take 2.
+const unsigned int materialBufferBinding = 1;
+
+//one material as the bindless fragment shader reads it, std430.
+struct MaterialRecord
+{
+	//resident handle of the material's texture.
+	uint64_t textureHandle;
+	uint64_t padding;
+	//w unused.
+	float diffuse[4];
+};
+
+//the ARB_bindless_texture path: every material texture stays resident and the shader picks its
+//record by material id, so drawing never binds a texture. needs the extension, without it the
+//engine falls back to TextureArrays.
+class BindlessMaterials
+{
+public:
+	//material records, bound to materialBufferBinding.
+	unsigned int buffer;
+
+	BindlessMaterials();
+	~BindlessMaterials();
+
+	static bool supported();
+	//makes every material's texture resident and writes one record per material, setting each
+	//material's id to its record. replaces whatever an earlier build made.
+	void build(const std::vector<Material*>& materials);
+	//call before the texture gets a new name, its handle stops being resident.
+	void release(const Texture* texture);
+	//makes the texture's new handle resident and points the records of the materials using it at
+	//it, materials as given to build.
+	void update(const Texture* texture, const std::vector<Material*>& materials);
+	void bind();
+	void clear();
+
+private:
+	//every material texture and its resident handle.
+	std::unordered_map<const Texture*, uint64_t> residentHandles;
+};
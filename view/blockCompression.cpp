@@ -0,0 +1,421 @@
+#include "blockCompression.h"
+
+namespace
+{
+	//16 texels of a 4x4 block, rgba as floats in 0..255. texels past the image edge repeat the last row or column.
+	struct Block
+	{
+		float texels[16][4];
+	};
+
+	void fetchBlock(const MipLevel& level, int blockX, int blockY, Block& block)
+	{
+		for (int y = 0; y < 4; ++y)
+			for (int x = 0; x < 4; ++x)
+			{
+				int sourceX = std::min(blockX * 4 + x, level.width - 1);
+				int sourceY = std::min(blockY * 4 + y, level.height - 1);
+				const unsigned char* texel = &level.pixels[4 * (size_t(sourceY) * level.width + sourceX)];
+				for (int c = 0; c < 4; ++c)
+					block.texels[4 * y + x][c] = texel[c];
+			}
+	}
+
+	float squaredDistance(const float* a, const float* b, int channels)
+	{
+		float sum = 0.0f;
+		for (int c = 0; c < channels; ++c)
+			sum += (a[c] - b[c]) * (a[c] - b[c]);
+		return sum;
+	}
+
+	//principal axis of the block's first channels through a few power iterations on the covariance.
+	void principalAxis(const Block& block, int channels, float* mean, float* axis)
+	{
+		for (int c = 0; c < channels; ++c)
+		{
+			mean[c] = 0.0f;
+			for (int i = 0; i < 16; ++i)
+				mean[c] += block.texels[i][c];
+			mean[c] /= 16.0f;
+		}
+
+		float covariance[4][4] = {};
+		for (int i = 0; i < 16; ++i)
+			for (int a = 0; a < channels; ++a)
+				for (int b = 0; b < channels; ++b)
+					covariance[a][b] += (block.texels[i][a] - mean[a]) * (block.texels[i][b] - mean[b]);
+
+		for (int c = 0; c < channels; ++c)
+			axis[c] = 1.0f;
+		for (int iteration = 0; iteration < 8; ++iteration)
+		{
+			float next[4] = {};
+			float length = 0.0f;
+			for (int a = 0; a < channels; ++a)
+			{
+				for (int b = 0; b < channels; ++b)
+					next[a] += covariance[a][b] * axis[b];
+				length = std::max(length, std::abs(next[a]));
+			}
+			//flat blocks have no direction, any axis works.
+			if (length == 0.0f)
+				return;
+			for (int c = 0; c < channels; ++c)
+				axis[c] = next[c] / length;
+		}
+	}
+
+	//endpoints at the extremes of the block's projection on its principal axis.
+	void fitEndpoints(const Block& block, int channels, float* endpoint0, float* endpoint1)
+	{
+		float mean[4], axis[4];
+		principalAxis(block, channels, mean, axis);
+		float axisLength = 0.0f;
+		for (int c = 0; c < channels; ++c)
+			axisLength += axis[c] * axis[c];
+
+		float minimum = 0.0f, maximum = 0.0f;
+		for (int i = 0; i < 16; ++i)
+		{
+			float t = 0.0f;
+			for (int c = 0; c < channels; ++c)
+				t += (block.texels[i][c] - mean[c]) * axis[c];
+			minimum = std::min(minimum, t);
+			maximum = std::max(maximum, t);
+		}
+		for (int c = 0; c < channels; ++c)
+		{
+			endpoint0[c] = std::min(std::max(mean[c] + axis[c] * maximum / axisLength, 0.0f), 255.0f);
+			endpoint1[c] = std::min(std::max(mean[c] + axis[c] * minimum / axisLength, 0.0f), 255.0f);
+		}
+	}
+
+	//least squares endpoints for fixed per texel weights of endpoint0, keeps them if the system is singular.
+	void refineEndpoints(const Block& block, int channels, const float* weights, float* endpoint0, float* endpoint1)
+	{
+		float aa = 0.0f, ab = 0.0f, bb = 0.0f;
+		float ax[4] = {}, bx[4] = {};
+		for (int i = 0; i < 16; ++i)
+		{
+			float a = weights[i], b = 1.0f - weights[i];
+			aa += a * a;
+			ab += a * b;
+			bb += b * b;
+			for (int c = 0; c < channels; ++c)
+			{
+				ax[c] += a * block.texels[i][c];
+				bx[c] += b * block.texels[i][c];
+			}
+		}
+
+		float determinant = aa * bb - ab * ab;
+		if (std::abs(determinant) < 1e-6f)
+			return;
+		for (int c = 0; c < channels; ++c)
+		{
+			endpoint0[c] = std::min(std::max((bb * ax[c] - ab * bx[c]) / determinant, 0.0f), 255.0f);
+			endpoint1[c] = std::min(std::max((aa * bx[c] - ab * ax[c]) / determinant, 0.0f), 255.0f);
+		}
+	}
+
+	uint16_t packRgb565(const float* color)
+	{
+		int r = int(color[0] * 31.0f / 255.0f + 0.5f);
+		int g = int(color[1] * 63.0f / 255.0f + 0.5f);
+		int b = int(color[2] * 31.0f / 255.0f + 0.5f);
+		return uint16_t(r << 11 | g << 5 | b);
+	}
+
+	void unpackRgb565(uint16_t packed, float* color)
+	{
+		int r = packed >> 11 & 31, g = packed >> 5 & 63, b = packed & 31;
+		color[0] = float(r << 3 | r >> 2);
+		color[1] = float(g << 2 | g >> 4);
+		color[2] = float(b << 3 | b >> 2);
+	}
+
+	//4 color mode palette as bc1 decodes it, weight of endpoint 0 per index.
+	const float bc1Weights[4] = { 1.0f, 0.0f, 2.0f / 3.0f, 1.0f / 3.0f };
+
+	void bc1Palette(uint16_t color0, uint16_t color1, float palette[4][3])
+	{
+		unpackRgb565(color0, palette[0]);
+		unpackRgb565(color1, palette[1]);
+		for (int c = 0; c < 3; ++c)
+		{
+			palette[2][c] = (2.0f * palette[0][c] + palette[1][c]) / 3.0f;
+			palette[3][c] = (palette[0][c] + 2.0f * palette[1][c]) / 3.0f;
+		}
+	}
+
+	int nearest(const float* texel, const float (*palette)[3], int count)
+	{
+		int best = 0;
+		float bestDistance = std::numeric_limits<float>::max();
+		for (int i = 0; i < count; ++i)
+		{
+			float distance = squaredDistance(texel, palette[i], 3);
+			if (distance < bestDistance)
+			{
+				bestDistance = distance;
+				best = i;
+			}
+		}
+		return best;
+	}
+
+	void encodeBc1(const Block& block, unsigned char* out)
+	{
+		float endpoint0[4], endpoint1[4];
+		fitEndpoints(block, 3, endpoint0, endpoint1);
+
+		//one refinement pass against the indices the first fit picks.
+		float palette[4][3];
+		for (int c = 0; c < 3; ++c)
+			for (int p = 0; p < 4; ++p)
+				palette[p][c] = bc1Weights[p] * endpoint0[c] + (1.0f - bc1Weights[p]) * endpoint1[c];
+		float weights[16];
+		for (int i = 0; i < 16; ++i)
+			weights[i] = bc1Weights[nearest(block.texels[i], palette, 4)];
+		refineEndpoints(block, 3, weights, endpoint0, endpoint1);
+
+		uint16_t color0 = packRgb565(endpoint0), color1 = packRgb565(endpoint1);
+		//color0 > color1 selects the 4 color mode, equal endpoints stay in 3 color mode with every index 0.
+		if (color0 < color1)
+			std::swap(color0, color1);
+		bc1Palette(color0, color1, palette);
+
+		uint32_t indices = 0;
+		if (color0 != color1)
+			for (int i = 0; i < 16; ++i)
+				indices |= uint32_t(nearest(block.texels[i], palette, 4)) << (2 * i);
+
+		out[0] = uint8_t(color0);
+		out[1] = uint8_t(color0 >> 8);
+		out[2] = uint8_t(color1);
+		out[3] = uint8_t(color1 >> 8);
+		for (int i = 0; i < 4; ++i)
+			out[4 + i] = uint8_t(indices >> (8 * i));
+	}
+
+	//one channel in the 8 value mode, endpoints at the block's min and max.
+	void encodeBc4(const Block& block, int channel, unsigned char* out)
+	{
+		float minimum = 255.0f, maximum = 0.0f;
+		for (int i = 0; i < 16; ++i)
+		{
+			minimum = std::min(minimum, block.texels[i][channel]);
+			maximum = std::max(maximum, block.texels[i][channel]);
+		}
+
+		int value0 = int(maximum + 0.5f), value1 = int(minimum + 0.5f);
+		uint64_t indices = 0;
+		if (value0 > value1)
+			for (int i = 0; i < 16; ++i)
+			{
+				//step 7 is endpoint 0, step 0 endpoint 1, steps between map to indices 2 to 7.
+				float t = (block.texels[i][channel] - value1) / float(value0 - value1);
+				int step = std::min(std::max(int(t * 7.0f + 0.5f), 0), 7);
+				uint64_t index = step == 7 ? 0 : step == 0 ? 1 : uint64_t(8 - step);
+				indices |= index << (3 * i);
+			}
+
+		out[0] = uint8_t(value0);
+		out[1] = uint8_t(value1);
+		for (int i = 0; i < 6; ++i)
+			out[2 + i] = uint8_t(indices >> (8 * i));
+	}
+
+	//bc7 appends fields lsb first.
+	struct BitWriter
+	{
+		unsigned char* out;
+		int bit;
+
+		void put(uint32_t value, int count)
+		{
+			for (int i = 0; i < count; ++i, ++bit)
+				out[bit >> 3] |= uint8_t((value >> i & 1) << (bit & 7));
+		}
+	};
+
+	const int bc7Weights[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+	//best 7 bit value plus shared p bit for an endpoint, returns the squared error.
+	float quantizeBc7Endpoint(const float* endpoint, int quantized[4], int& pBit)
+	{
+		float bestError = std::numeric_limits<float>::max();
+		for (int p = 0; p < 2; ++p)
+		{
+			int candidate[4];
+			float error = 0.0f;
+			for (int c = 0; c < 4; ++c)
+			{
+				candidate[c] = std::min(std::max(int((endpoint[c] - p) / 2.0f + 0.5f), 0), 127);
+				float decoded = float(candidate[c] << 1 | p);
+				error += (decoded - endpoint[c]) * (decoded - endpoint[c]);
+			}
+			if (error < bestError)
+			{
+				bestError = error;
+				pBit = p;
+				memcpy(quantized, candidate, sizeof(candidate));
+			}
+		}
+		return bestError;
+	}
+
+	//mode 6: one rgba subset, 7 bit endpoints with a p bit each and 4 bit indices.
+	void encodeBc7(const Block& block, unsigned char* out)
+	{
+		float endpoint0[4], endpoint1[4];
+		fitEndpoints(block, 4, endpoint0, endpoint1);
+
+		float weights[16];
+		for (int i = 0; i < 16; ++i)
+		{
+			float best = std::numeric_limits<float>::max();
+			for (int w = 0; w < 16; ++w)
+			{
+				float interpolated[4];
+				for (int c = 0; c < 4; ++c)
+					interpolated[c] = ((64 - bc7Weights[w]) * endpoint0[c] + bc7Weights[w] * endpoint1[c]) / 64.0f;
+				float distance = squaredDistance(block.texels[i], interpolated, 4);
+				if (distance < best)
+				{
+					best = distance;
+					weights[i] = (64 - bc7Weights[w]) / 64.0f;
+				}
+			}
+		}
+		refineEndpoints(block, 4, weights, endpoint0, endpoint1);
+
+		int quantized[2][4], pBits[2];
+		quantizeBc7Endpoint(endpoint0, quantized[0], pBits[0]);
+		quantizeBc7Endpoint(endpoint1, quantized[1], pBits[1]);
+		float palette[16][4];
+		for (int w = 0; w < 16; ++w)
+			for (int c = 0; c < 4; ++c)
+			{
+				int value0 = quantized[0][c] << 1 | pBits[0], value1 = quantized[1][c] << 1 | pBits[1];
+				palette[w][c] = float(((64 - bc7Weights[w]) * value0 + bc7Weights[w] * value1 + 32) >> 6);
+			}
+
+		int indices[16];
+		for (int i = 0; i < 16; ++i)
+		{
+			float best = std::numeric_limits<float>::max();
+			for (int w = 0; w < 16; ++w)
+			{
+				float distance = squaredDistance(block.texels[i], palette[w], 4);
+				if (distance < best)
+				{
+					best = distance;
+					indices[i] = w;
+				}
+			}
+		}
+
+		//the first index is stored without its top bit, so it has to be below 8.
+		if (indices[0] >= 8)
+		{
+			std::swap(quantized[0], quantized[1]);
+			std::swap(pBits[0], pBits[1]);
+			for (int& index : indices)
+				index = 15 - index;
+		}
+
+		memset(out, 0, 16);
+		BitWriter writer{ out, 0 };
+		writer.put(1 << 6, 7);
+		for (int c = 0; c < 4; ++c)
+		{
+			writer.put(quantized[0][c], 7);
+			writer.put(quantized[1][c], 7);
+		}
+		writer.put(pBits[0], 1);
+		writer.put(pBits[1], 1);
+		writer.put(indices[0], 3);
+		for (int i = 1; i < 16; ++i)
+			writer.put(indices[i], 4);
+	}
+
+	void encodeBlock(const Block& block, BlockFormat format, unsigned char* out)
+	{
+		switch (format)
+		{
+		case BlockFormat::BC1:
+			encodeBc1(block, out);
+			break;
+		case BlockFormat::BC3:
+			encodeBc4(block, 3, out);
+			encodeBc1(block, out + 8);
+			break;
+		case BlockFormat::BC5:
+			encodeBc4(block, 0, out);
+			encodeBc4(block, 1, out + 8);
+			break;
+		case BlockFormat::BC7:
+			encodeBc7(block, out);
+			break;
+		}
+	}
+}
+
+size_t util::blockBytes(BlockFormat format)
+{
+	return format == BlockFormat::BC1 ? 8 : 16;
+}
+
+unsigned int util::blockInternalFormat(BlockFormat format)
+{
+	switch (format)
+	{
+	case BlockFormat::BC1:
+		return GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+	case BlockFormat::BC3:
+		return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+	case BlockFormat::BC5:
+		return GL_COMPRESSED_RG_RGTC2;
+	default:
+		return GL_COMPRESSED_RGBA_BPTC_UNORM;
+	}
+}
+
+size_t util::compressedLevelBytes(BlockFormat format, int width, int height)
+{
+	return size_t((width + 3) / 4) * size_t((height + 3) / 4) * blockBytes(format);
+}
+
+std::vector<unsigned char> util::compressLevel(const MipLevel& level, BlockFormat format)
+{
+	int blocksX = (level.width + 3) / 4, blocksY = (level.height + 3) / 4;
+	size_t bytes = blockBytes(format);
+	std::vector<unsigned char> blocks(size_t(blocksX) * blocksY * bytes);
+
+	auto encodeRows = [&](int begin, int end)
+	{
+		Block block;
+		for (int y = begin; y < end; ++y)
+			for (int x = 0; x < blocksX; ++x)
+			{
+				fetchBlock(level, x, y, block);
+				encodeBlock(block, format, &blocks[(size_t(y) * blocksX + x) * bytes]);
+			}
+	};
+
+	//small levels aren't worth the thread startup.
+	const int minBlocksPerThread = 1024;
+	int threadCount = int(std::max(1u, std::thread::hardware_concurrency()));
+	threadCount = std::min(threadCount, std::max(1, blocksX * blocksY / minBlocksPerThread));
+
+	std::vector<std::thread> workers;
+	for (int i = 1; i < threadCount; ++i)
+		workers.emplace_back(encodeRows, blocksY * i / threadCount, blocksY * (i + 1) / threadCount);
+	encodeRows(0, blocksY / threadCount);
+	for (std::thread& worker : workers)
+		worker.join();
+
+	return blocks;
+}
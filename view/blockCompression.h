@@ -0,0 +1,23 @@
+#pragma once
+#include "../config.h"
+#include "mipChain.h"
+
+//bc1: opaque rgb, 8 bytes per 4x4 block. bc3: rgba, bc1 color plus a bc4 alpha block, 16 bytes.
+//bc5: two bc4 channels for normal maps, 16 bytes. bc7: rgba at close to rgba8 quality, 16 bytes.
+enum class BlockFormat : uint32_t
+{
+	BC1, BC3, BC5, BC7
+};
+
+namespace util
+{
+	size_t blockBytes(BlockFormat format);
+	//the glTextureStorage2D internal format, unorm like the rgba8 textures.
+	unsigned int blockInternalFormat(BlockFormat format);
+	//bytes of a width x height level, partial blocks at the edges count as whole ones.
+	size_t compressedLevelBytes(BlockFormat format, int width, int height);
+
+	//encodes an rgba8 level into 4x4 blocks in row order, rows of blocks are split across all cores.
+	//bc1 and bc3 pick endpoints along the principal axis of each block, bc7 only uses mode 6.
+	std::vector<unsigned char> compressLevel(const MipLevel& level, BlockFormat format);
+}
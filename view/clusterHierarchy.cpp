@@ -0,0 +1,786 @@
+#include "clusterHierarchy.h"
+#include "mappedFile.h"
+#include "vertexTransform.h"
+#include "meshOptimizer.h"
+#include "meshSimplifier.h"
+
+namespace
+{
+	//records are read and written this many at a time, never the whole file.
+	const size_t recordBlockSize = 1 << 14;
+	const int histogramBins = 256;
+	//clusters simplified together, the group is also the page they are streamed in.
+	const size_t groupSize = 4;
+	//a group that can't lose this much passes its clusters on to be grouped differently instead.
+	const float maxGroupShrink = 0.85f;
+	//a block this far under the slice size is cut into clusters in memory.
+	const size_t blockBytesPerTriangle = 256;
+
+	//a triangle once every slice is merged, 64 bit indices so huge files can't overflow.
+	struct TriangleRecord
+	{
+		int64_t position[3], texCoord[3], normal[3];
+		float centroid[3];
+	};
+
+	//triangles of one subtree, waiting in a temporary file.
+	struct Subset
+	{
+		std::string filename;
+		uint64_t count;
+		glm::vec3 centroidMin, centroidMax;
+	};
+
+	//a cut cluster whose group isn't written yet.
+	struct PendingCluster
+	{
+		MeshData mesh;
+		glm::vec4 sphere;
+		int32_t childGroup;
+		//of childGroup, or 0 and sphere for source triangles. the group this ends up in encloses both.
+		float childError;
+		glm::vec4 childSphere;
+	};
+
+	//an edge between two positions, the smaller one first, so neighbouring clusters find each other.
+	struct EdgeKey
+	{
+		float values[6];
+	};
+
+	struct EdgeKeyHash
+	{
+		size_t operator()(const EdgeKey& key) const
+		{
+			uint32_t bits[6];
+			memcpy(bits, key.values, sizeof(bits));
+			size_t hash = 0;
+			for (uint32_t word : bits)
+				hash = hash * 31 + std::hash<uint32_t>()(word);
+			return hash;
+		}
+	};
+
+	struct EdgeKeyEqual
+	{
+		bool operator()(const EdgeKey& a, const EdgeKey& b) const
+		{
+			return memcmp(a.values, b.values, sizeof(a.values)) == 0;
+		}
+	};
+
+	EdgeKey edgeKey(const float* a, const float* b)
+	{
+		if (std::lexicographical_compare(b, b + 3, a, a + 3))
+			std::swap(a, b);
+		EdgeKey key;
+		memcpy(key.values, a, 3 * sizeof(float));
+		memcpy(key.values + 3, b, 3 * sizeof(float));
+		return key;
+	}
+
+	struct LeafCorner
+	{
+		int64_t position, texCoord, normal;
+	};
+
+	struct LeafCornerHash
+	{
+		size_t operator()(const LeafCorner& corner) const
+		{
+			size_t hash = std::hash<int64_t>()(corner.position);
+			hash = hash * 31 + std::hash<int64_t>()(corner.texCoord);
+			hash = hash * 31 + std::hash<int64_t>()(corner.normal);
+			return hash;
+		}
+	};
+
+	struct LeafCornerEqual
+	{
+		bool operator()(const LeafCorner& a, const LeafCorner& b) const
+		{
+			return a.position == b.position
+				&& a.texCoord == b.texCoord
+				&& a.normal == b.normal;
+		}
+	};
+
+	//bitwise identical vertices, children duplicate the ones on their shared cut.
+	struct VertexKey
+	{
+		float values[8];
+	};
+
+	struct VertexKeyHash
+	{
+		size_t operator()(const VertexKey& key) const
+		{
+			uint32_t bits[8];
+			memcpy(bits, key.values, sizeof(bits));
+			size_t hash = 0;
+			for (uint32_t word : bits)
+				hash = hash * 31 + std::hash<uint32_t>()(word);
+			return hash;
+		}
+	};
+
+	struct VertexKeyEqual
+	{
+		bool operator()(const VertexKey& a, const VertexKey& b) const
+		{
+			return memcmp(a.values, b.values, sizeof(a.values)) == 0;
+		}
+	};
+
+	//calls visit for every record of the file, one block at a time.
+	template <typename Visit>
+	void forEachRecord(const std::string& filename, Visit visit)
+	{
+		std::ifstream file(filename, std::ios::binary);
+		std::vector<TriangleRecord> block(recordBlockSize);
+		while (file)
+		{
+			file.read(reinterpret_cast<char*>(block.data()), block.size() * sizeof(TriangleRecord));
+			size_t read = size_t(file.gcount()) / sizeof(TriangleRecord);
+			for (size_t i = 0; i < read; ++i)
+				visit(block[i]);
+		}
+	}
+
+	glm::vec4 enclosingSphere(glm::vec4 a, glm::vec4 b)
+	{
+		glm::vec3 offset = glm::vec3(b) - glm::vec3(a);
+		float distance = glm::length(offset);
+		if (distance + b.w <= a.w)
+			return a;
+		if (distance + a.w <= b.w)
+			return b;
+
+		float radius = 0.5f * (distance + a.w + b.w);
+		glm::vec3 center = glm::vec3(a) + offset * ((radius - a.w) / distance);
+		return glm::vec4(center, radius);
+	}
+
+	glm::vec4 meshSphere(const MeshData& mesh)
+	{
+		glm::vec3 center = 0.5f * (mesh.boundsMin + mesh.boundsMax);
+		float radius = 0.0f;
+		for (unsigned int v = 0; v < mesh.vertexCount; ++v)
+			radius = std::max(radius, glm::length(glm::make_vec3(&mesh.vertices[8 * v]) - center));
+		return glm::vec4(center, radius);
+	}
+
+	void computeBounds(MeshData& mesh)
+	{
+		mesh.boundsMin = glm::vec3(std::numeric_limits<float>::max());
+		mesh.boundsMax = glm::vec3(-std::numeric_limits<float>::max());
+		for (unsigned int v = 0; v < mesh.vertexCount; ++v)
+		{
+			mesh.boundsMin = glm::min(mesh.boundsMin, glm::make_vec3(&mesh.vertices[8 * v]));
+			mesh.boundsMax = glm::max(mesh.boundsMax, glm::make_vec3(&mesh.vertices[8 * v]));
+		}
+	}
+
+	class HierarchyBuilder
+	{
+	public:
+		HierarchyBuilder(const ClusterBuildInfo& info) : info(info), fileCount(0), maxVertexCount(0), maxIndexCount(0),
+			positionCount(0), texCoordCount(0), normalCount(0), triangleCount(0)
+		{
+			defaultNormal = glm::normalize(glm::mat3(info.preTransform) * glm::vec3(0.0f, 0.0f, 1.0f));
+			//at least a few groups worth, fewer and the blocks' borders would be most of them.
+			blockTriangles = std::max(info.sliceBytes / blockBytesPerTriangle, size_t(16) * groupSize * std::max(info.leafTriangles, 1u));
+		}
+
+		bool build()
+		{
+			if (!streamSource())
+				return false;
+
+			positions = util::mapFile(tempName("positions").c_str());
+			texCoords = util::mapFile(tempName("texcoords").c_str());
+			normals = util::mapFile(tempName("normals").c_str());
+
+			Subset root = computeCentroids();
+			bool written = false;
+			if (root.count == 0)
+				std::cout << "Obj " << info.sourceFilename << " has no triangles to build clusters from\n";
+			else
+			{
+				output.open(info.clusterFilename, std::ios::binary | std::ios::trunc);
+				ClusterFileHeader header{};
+				output.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+				//whatever couldn't be simplified any further is always resident.
+				std::vector<PendingCluster> top = buildBlock(root);
+				size_t rootTriangles = 0;
+				for (const PendingCluster& cluster : top)
+					rootTriangles += cluster.mesh.indices.size() / 3;
+				for (const std::vector<size_t>& group : groupClusters(top))
+				{
+					glm::vec4 sphere = top[group[0]].sphere;
+					for (size_t member : group)
+						sphere = enclosingSphere(enclosingSphere(sphere, top[member].sphere), top[member].childSphere);
+					writeGroup(top, group, std::numeric_limits<float>::max(), sphere);
+				}
+
+				memcpy(header.magic, clusterFileMagic, sizeof(header.magic));
+				header.version = clusterFileVersion;
+				header.groupCount = uint32_t(groups.size());
+				header.clusterCount = uint32_t(clusters.size());
+				header.groupOffset = alignOutput();
+				output.write(reinterpret_cast<const char*>(groups.data()), groups.size() * sizeof(ClusterGroup));
+				header.clusterOffset = alignOutput();
+				output.write(reinterpret_cast<const char*>(clusters.data()), clusters.size() * sizeof(ClusterRecord));
+				header.maxVertexCount = maxVertexCount;
+				header.maxIndexCount = maxIndexCount;
+				header.layout = util::floatVertexLayout();
+				output.seekp(0);
+				output.write(reinterpret_cast<const char*>(&header), sizeof(header));
+				written = bool(output);
+				output.close();
+
+				std::cout << "Built " << clusters.size() << " clusters in " << groups.size() << " groups from " << triangleCount
+					<< " triangles into " << info.clusterFilename << ", " << top.size() << " root clusters with " << rootTriangles
+					<< " triangles, largest page " << maxVertexCount << " vertices and " << maxIndexCount << " indices\n";
+			}
+
+			util::unmapFile(positions);
+			util::unmapFile(texCoords);
+			util::unmapFile(normals);
+			std::remove(tempName("positions").c_str());
+			std::remove(tempName("texcoords").c_str());
+			std::remove(tempName("normals").c_str());
+			std::remove(root.filename.c_str());
+			return written;
+		}
+
+	private:
+		std::string tempName(const char* name)
+		{
+			return std::string(info.clusterFilename) + ".tmp." + name;
+		}
+
+		std::string nextSubsetName()
+		{
+			return tempName(std::to_string(fileCount++).c_str());
+		}
+
+		//parses one slice at a time, attributes and triangles go straight out to temporary files.
+		bool streamSource()
+		{
+			mappedFile source = util::mapFile(info.sourceFilename);
+			if (!source.data)
+			{
+				std::cout << "Failed to open obj " << info.sourceFilename << '\n';
+				return false;
+			}
+
+			std::ofstream positionFile(tempName("positions"), std::ios::binary | std::ios::trunc);
+			std::ofstream texCoordFile(tempName("texcoords"), std::ios::binary | std::ios::trunc);
+			std::ofstream normalFile(tempName("normals"), std::ios::binary | std::ios::trunc);
+			std::ofstream triangleFile(tempName("triangles"), std::ios::binary | std::ios::trunc);
+
+			const char* cursor = reinterpret_cast<const char*>(source.data);
+			const char* end = cursor + source.size;
+			std::vector<TriangleRecord> records;
+			while (cursor < end)
+			{
+				const char* sliceEnd = cursor + std::min<size_t>(std::max<size_t>(info.sliceBytes, 1), end - cursor);
+				if (sliceEnd < end && sliceEnd[-1] != '\n')
+					sliceEnd = util::objNextLine(sliceEnd, end);
+
+				ObjChunk chunk;
+				util::objParseChunk(cursor, sliceEnd, chunk);
+				cursor = sliceEnd;
+
+				util::transformPositions(chunk.positions.data(), chunk.positions.size() / 3, info.preTransform);
+				util::transformNormals(chunk.normals.data(), chunk.normals.size() / 3, info.preTransform);
+
+				records.clear();
+				for (size_t corner = 0; corner + 2 < chunk.corners.size(); corner += 3)
+				{
+					TriangleRecord record{};
+					for (int c = 0; c < 3; ++c)
+					{
+						const ObjCorner& objCorner = chunk.corners[corner + c];
+						unsigned char relative = chunk.relative[corner + c];
+						record.position[c] = objCorner.position + (relative & 1 ? positionCount : 0);
+						record.texCoord[c] = objCorner.texCoord + (relative & 2 ? texCoordCount : 0);
+						record.normal[c] = objCorner.normal + (relative & 4 ? normalCount : 0);
+					}
+					records.push_back(record);
+				}
+
+				positionFile.write(reinterpret_cast<const char*>(chunk.positions.data()), chunk.positions.size() * sizeof(float));
+				texCoordFile.write(reinterpret_cast<const char*>(chunk.texCoords.data()), chunk.texCoords.size() * sizeof(float));
+				normalFile.write(reinterpret_cast<const char*>(chunk.normals.data()), chunk.normals.size() * sizeof(float));
+				triangleFile.write(reinterpret_cast<const char*>(records.data()), records.size() * sizeof(TriangleRecord));
+				positionCount += chunk.positions.size() / 3;
+				texCoordCount += chunk.texCoords.size() / 2;
+				normalCount += chunk.normals.size() / 3;
+			}
+
+			util::unmapFile(source);
+			return bool(positionFile) && bool(texCoordFile) && bool(normalFile) && bool(triangleFile);
+		}
+
+		//needs every position on disk, a face may reference vertices further down the file.
+		Subset computeCentroids()
+		{
+			Subset root;
+			root.filename = nextSubsetName();
+			root.count = 0;
+			root.centroidMin = glm::vec3(std::numeric_limits<float>::max());
+			root.centroidMax = glm::vec3(-std::numeric_limits<float>::max());
+
+			const float* positionData = reinterpret_cast<const float*>(positions.data);
+			uint64_t skipped = 0, degenerate = 0;
+			std::ofstream file(root.filename, std::ios::binary | std::ios::trunc);
+			forEachRecord(tempName("triangles"), [&](TriangleRecord record)
+			{
+				glm::vec3 corners[3];
+				for (int c = 0; c < 3; ++c)
+				{
+					if (record.position[c] < 0 || record.position[c] >= positionCount)
+					{
+						++skipped;
+						return;
+					}
+					corners[c] = glm::make_vec3(&positionData[3 * record.position[c]]);
+				}
+				//two corners in one spot cover nothing and would lock the simplifier around them.
+				if (corners[0] == corners[1] || corners[1] == corners[2] || corners[2] == corners[0])
+				{
+					++degenerate;
+					return;
+				}
+				glm::vec3 centroid = (corners[0] + corners[1] + corners[2]) / 3.0f;
+
+				memcpy(record.centroid, glm::value_ptr(centroid), sizeof(record.centroid));
+				file.write(reinterpret_cast<const char*>(&record), sizeof(record));
+				root.centroidMin = glm::min(root.centroidMin, centroid);
+				root.centroidMax = glm::max(root.centroidMax, centroid);
+				++root.count;
+			});
+			std::remove(tempName("triangles").c_str());
+
+			if (skipped > 0)
+				std::cout << "Obj " << info.sourceFilename << " has " << skipped << " triangles with missing vertices, skipped\n";
+			if (degenerate > 0)
+				std::cout << "Obj " << info.sourceFilename << " has " << degenerate << " degenerate triangles, skipped\n";
+			triangleCount = root.count;
+			return root;
+		}
+
+		//splits near the median along the longest axis, found with a histogram of centroids.
+		std::pair<Subset, Subset> split(const Subset& subset)
+		{
+			glm::vec3 extent = subset.centroidMax - subset.centroidMin;
+			int axis = extent.x >= extent.y && extent.x >= extent.z ? 0 : (extent.y >= extent.z ? 1 : 2);
+
+			float splitPosition = subset.centroidMin[axis] + 0.5f * extent[axis];
+			if (extent[axis] > 0.0f)
+			{
+				std::vector<uint64_t> histogram(histogramBins, 0);
+				float binScale = histogramBins / extent[axis];
+				forEachRecord(subset.filename, [&](const TriangleRecord& record)
+				{
+					int bin = int((record.centroid[axis] - subset.centroidMin[axis]) * binScale);
+					++histogram[std::min(std::max(bin, 0), histogramBins - 1)];
+				});
+
+				uint64_t below = 0;
+				for (int bin = 0; bin < histogramBins - 1; ++bin)
+				{
+					below += histogram[bin];
+					if (below * 2 >= subset.count)
+					{
+						splitPosition = subset.centroidMin[axis] + (bin + 1) / binScale;
+						break;
+					}
+				}
+			}
+
+			Subset sides[2];
+			std::ofstream files[2];
+			for (int side = 0; side < 2; ++side)
+			{
+				sides[side].filename = nextSubsetName();
+				sides[side].count = 0;
+				sides[side].centroidMin = glm::vec3(std::numeric_limits<float>::max());
+				sides[side].centroidMax = glm::vec3(-std::numeric_limits<float>::max());
+				files[side].open(sides[side].filename, std::ios::binary | std::ios::trunc);
+			}
+
+			//every centroid in one bin or in one spot, fall back to splitting by file order.
+			bool byPosition = extent[axis] > 0.0f;
+			uint64_t visited = 0;
+			auto place = [&](const TriangleRecord& record, int side)
+			{
+				glm::vec3 centroid = glm::make_vec3(record.centroid);
+				files[side].write(reinterpret_cast<const char*>(&record), sizeof(record));
+				sides[side].centroidMin = glm::min(sides[side].centroidMin, centroid);
+				sides[side].centroidMax = glm::max(sides[side].centroidMax, centroid);
+				++sides[side].count;
+			};
+			forEachRecord(subset.filename, [&](const TriangleRecord& record)
+			{
+				int side = byPosition ? (record.centroid[axis] >= splitPosition ? 1 : 0) : (visited * 2 >= subset.count ? 1 : 0);
+				++visited;
+				place(record, side);
+			});
+
+			if (sides[0].count == 0 || sides[1].count == 0)
+			{
+				for (int side = 0; side < 2; ++side)
+				{
+					files[side].close();
+					std::remove(sides[side].filename.c_str());
+				}
+				Subset ordered = subset;
+				ordered.centroidMin = ordered.centroidMax = subset.centroidMin;
+				return split(ordered);
+			}
+
+			return std::make_pair(sides[0], sides[1]);
+		}
+
+		MeshData loadBlock(const Subset& subset)
+		{
+			const float* positionData = reinterpret_cast<const float*>(positions.data);
+			const float* texCoordData = reinterpret_cast<const float*>(texCoords.data);
+			const float* normalData = reinterpret_cast<const float*>(normals.data);
+
+			MeshData mesh;
+			mesh.layout = util::floatVertexLayout();
+			mesh.indices.reserve(3 * size_t(subset.count));
+			std::unordered_map<LeafCorner, unsigned int, LeafCornerHash, LeafCornerEqual> uniqueVertices;
+
+			forEachRecord(subset.filename, [&](const TriangleRecord& record)
+			{
+				for (int c = 0; c < 3; ++c)
+				{
+					LeafCorner corner = { record.position[c], record.texCoord[c], record.normal[c] };
+					auto inserted = uniqueVertices.emplace(corner, (unsigned int)(mesh.vertices.size() / 8));
+					mesh.indices.push_back(inserted.first->second);
+					if (!inserted.second)
+						continue;
+
+					const float* position = &positionData[3 * corner.position];
+					mesh.vertices.insert(mesh.vertices.end(), position, position + 3);
+
+					bool hasTexCoord = corner.texCoord >= 0 && corner.texCoord < texCoordCount;
+					mesh.vertices.push_back(hasTexCoord ? texCoordData[2 * corner.texCoord] : 0.0f);
+					mesh.vertices.push_back(hasTexCoord ? texCoordData[2 * corner.texCoord + 1] : 0.0f);
+
+					const float* normal = corner.normal >= 0 && corner.normal < normalCount
+						? &normalData[3 * corner.normal] : glm::value_ptr(defaultNormal);
+					mesh.vertices.insert(mesh.vertices.end(), normal, normal + 3);
+				}
+			});
+
+			mesh.vertexCount = (unsigned int)(mesh.vertices.size() / 8);
+			mesh.indexType = GL_UNSIGNED_INT;
+			return mesh;
+		}
+
+		//every mesh welded into one buffer, so the borders between them aren't locked seams.
+		MeshData merge(const std::vector<const MeshData*>& meshes)
+		{
+			MeshData merged;
+			merged.layout = util::floatVertexLayout();
+			std::unordered_map<VertexKey, unsigned int, VertexKeyHash, VertexKeyEqual> uniqueVertices;
+
+			for (const MeshData* mesh : meshes)
+				for (unsigned int index : mesh->indices)
+				{
+					VertexKey key;
+					memcpy(key.values, &mesh->vertices[8 * index], sizeof(key.values));
+					auto inserted = uniqueVertices.emplace(key, (unsigned int)(merged.vertices.size() / 8));
+					if (inserted.second)
+						merged.vertices.insert(merged.vertices.end(), key.values, key.values + 8);
+					merged.indices.push_back(inserted.first->second);
+				}
+
+			merged.vertexCount = (unsigned int)(merged.vertices.size() / 8);
+			merged.indexType = GL_UNSIGNED_INT;
+			return merged;
+		}
+
+		//splits triangles [begin, end) at the median centroid of the longest axis until they fit a
+		//cluster, so every cluster is a compact patch. pending carries the child fields into every
+		//cluster made, remap is all -1 and left that way.
+		void cutClusters(const MeshData& mesh, const std::vector<unsigned int>& indices, const std::vector<glm::vec3>& centroids,
+			std::vector<uint32_t>& triangles, size_t begin, size_t end, std::vector<int>& remap, PendingCluster& pending,
+			std::vector<PendingCluster>& result)
+		{
+			if (end - begin > std::max(info.leafTriangles, 1u))
+			{
+				glm::vec3 low(std::numeric_limits<float>::max()), high(-std::numeric_limits<float>::max());
+				for (size_t t = begin; t < end; ++t)
+				{
+					low = glm::min(low, centroids[triangles[t]]);
+					high = glm::max(high, centroids[triangles[t]]);
+				}
+				glm::vec3 extent = high - low;
+				int axis = extent.x >= extent.y && extent.x >= extent.z ? 0 : (extent.y >= extent.z ? 1 : 2);
+				size_t middle = begin + (end - begin) / 2;
+				std::nth_element(triangles.begin() + begin, triangles.begin() + middle, triangles.begin() + end, [&](uint32_t a, uint32_t b)
+				{
+					return centroids[a][axis] < centroids[b][axis];
+				});
+				cutClusters(mesh, indices, centroids, triangles, begin, middle, remap, pending, result);
+				cutClusters(mesh, indices, centroids, triangles, middle, end, remap, pending, result);
+				return;
+			}
+
+			MeshData& cluster = pending.mesh;
+			cluster = MeshData();
+			cluster.layout = util::floatVertexLayout();
+			std::vector<unsigned int> used;
+			for (size_t t = begin; t < end; ++t)
+				for (int c = 0; c < 3; ++c)
+				{
+					unsigned int index = indices[3 * triangles[t] + c];
+					if (remap[index] < 0)
+					{
+						remap[index] = int(used.size());
+						used.push_back(index);
+						cluster.vertices.insert(cluster.vertices.end(), &mesh.vertices[8 * index], &mesh.vertices[8 * index] + 8);
+					}
+					cluster.indices.push_back((unsigned int)remap[index]);
+				}
+			for (unsigned int index : used)
+				remap[index] = -1;
+
+			cluster.vertexCount = (unsigned int)used.size();
+			cluster.indexType = GL_UNSIGNED_INT;
+			util::optimizeVertexCache(cluster.indices, cluster.vertexCount);
+			util::optimizeVertexFetch(cluster);
+			computeBounds(cluster);
+			pending.sphere = meshSphere(cluster);
+			if (pending.childGroup < 0)
+				pending.childSphere = pending.sphere;
+			result.push_back(std::move(pending));
+		}
+
+		void cutClusters(const MeshData& mesh, const std::vector<unsigned int>& indices, int32_t childGroup, float childError,
+			glm::vec4 childSphere, std::vector<PendingCluster>& result)
+		{
+			std::vector<glm::vec3> centroids(indices.size() / 3, glm::vec3(0.0f));
+			std::vector<uint32_t> triangles(centroids.size());
+			for (size_t t = 0; t < centroids.size(); ++t)
+			{
+				for (int c = 0; c < 3; ++c)
+					centroids[t] += glm::make_vec3(&mesh.vertices[8 * indices[3 * t + c]]) / 3.0f;
+				triangles[t] = uint32_t(t);
+			}
+			std::vector<int> remap(mesh.vertexCount, -1);
+			PendingCluster pending;
+			pending.childGroup = childGroup;
+			pending.childError = childError;
+			pending.childSphere = childSphere;
+			cutClusters(mesh, indices, centroids, triangles, 0, triangles.size(), remap, pending, result);
+		}
+
+		//greedy growth over shared border edges, clusters that share the most are grouped. borders
+		//locked in the last level are long and dense, so the next groups tend to straddle them.
+		std::vector<std::vector<size_t>> groupClusters(const std::vector<PendingCluster>& pending)
+		{
+			std::unordered_map<EdgeKey, size_t, EdgeKeyHash, EdgeKeyEqual> borderOwner;
+			std::vector<std::unordered_map<size_t, unsigned int>> shared(pending.size());
+			for (size_t i = 0; i < pending.size(); ++i)
+			{
+				const MeshData& mesh = pending[i].mesh;
+				//edges used once are the cluster's border, inside edges are used twice.
+				std::unordered_map<EdgeKey, unsigned int, EdgeKeyHash, EdgeKeyEqual> edgeUse;
+				for (size_t t = 0; t + 2 < mesh.indices.size(); t += 3)
+					for (int e = 0; e < 3; ++e)
+						++edgeUse[edgeKey(&mesh.vertices[8 * mesh.indices[t + e]], &mesh.vertices[8 * mesh.indices[t + (e + 1) % 3]])];
+				for (const auto& edge : edgeUse)
+				{
+					if (edge.second != 1)
+						continue;
+					auto owner = borderOwner.emplace(edge.first, i);
+					if (!owner.second && owner.first->second != i)
+					{
+						++shared[i][owner.first->second];
+						++shared[owner.first->second][i];
+					}
+				}
+			}
+
+			//seeds go in cluster order, which follows the spatial splits, so groups stay compact.
+			std::vector<std::vector<size_t>> groups;
+			std::vector<bool> grouped(pending.size(), false);
+			for (size_t seed = 0; seed < pending.size(); ++seed)
+			{
+				if (grouped[seed])
+					continue;
+				std::vector<size_t> group(1, seed);
+				grouped[seed] = true;
+				std::unordered_map<size_t, unsigned int> candidates = shared[seed];
+				while (group.size() < groupSize)
+				{
+					size_t best = pending.size();
+					unsigned int bestShared = 0;
+					for (const auto& candidate : candidates)
+						if (!grouped[candidate.first] && (candidate.second > bestShared || (candidate.second == bestShared && candidate.first < best)))
+						{
+							best = candidate.first;
+							bestShared = candidate.second;
+						}
+					if (best == pending.size())
+						break;
+					group.push_back(best);
+					grouped[best] = true;
+					for (const auto& neighbour : shared[best])
+						candidates[neighbour.first] += neighbour.second;
+				}
+				groups.push_back(group);
+			}
+			return groups;
+		}
+
+		uint64_t alignOutput()
+		{
+			uint64_t offset = uint64_t(output.tellp());
+			uint64_t aligned = (offset + 15) & ~uint64_t(15);
+			const char padding[16] = {};
+			output.write(padding, aligned - offset);
+			return aligned;
+		}
+
+		//the members become one page, their meshes are freed.
+		int32_t writeGroup(std::vector<PendingCluster>& pending, const std::vector<size_t>& members, float error, glm::vec4 sphere)
+		{
+			ClusterGroup group{};
+			memcpy(group.sphere, glm::value_ptr(sphere), sizeof(group.sphere));
+			group.error = error;
+			group.firstCluster = uint32_t(clusters.size());
+			group.clusterCount = uint32_t(members.size());
+			for (size_t member : members)
+			{
+				const PendingCluster& cluster = pending[member];
+				ClusterRecord record{};
+				memcpy(record.sphere, glm::value_ptr(cluster.sphere), sizeof(record.sphere));
+				record.childGroup = cluster.childGroup;
+				record.firstVertex = group.vertexCount;
+				record.vertexCount = cluster.mesh.vertexCount;
+				record.firstIndex = group.indexCount;
+				record.indexCount = uint32_t(cluster.mesh.indices.size());
+				group.vertexCount += record.vertexCount;
+				group.indexCount += record.indexCount;
+				clusters.push_back(record);
+			}
+
+			group.pageOffset = alignOutput();
+			for (size_t member : members)
+				output.write(reinterpret_cast<const char*>(pending[member].mesh.vertices.data()), 8 * size_t(pending[member].mesh.vertexCount) * sizeof(float));
+			for (size_t member : members)
+			{
+				output.write(reinterpret_cast<const char*>(pending[member].mesh.indices.data()), pending[member].mesh.indices.size() * sizeof(uint32_t));
+				pending[member].mesh = MeshData();
+			}
+
+			maxVertexCount = std::max(maxVertexCount, group.vertexCount);
+			maxIndexCount = std::max(maxIndexCount, group.indexCount);
+			groups.push_back(group);
+			if (groups.size() % 1024 == 0)
+				std::cout << "Cluster build: " << groups.size() << " groups\n";
+			return int32_t(groups.size() - 1);
+		}
+
+		//welds the group, simplifies it to half with its outer border locked and cuts the result into
+		//the clusters of the next level. false if it barely shrinks, the members are left alone then.
+		bool simplifyGroup(std::vector<PendingCluster>& pending, const std::vector<size_t>& members, std::vector<PendingCluster>& next)
+		{
+			std::vector<const MeshData*> meshes;
+			for (size_t member : members)
+				meshes.push_back(&pending[member].mesh);
+			MeshData merged = merge(meshes);
+
+			float error = 0.0f;
+			std::vector<unsigned int> simplified = util::simplifyMesh(merged, merged.indices, merged.indices.size() / 2, error);
+			if (simplified.empty() || float(simplified.size()) > maxGroupShrink * float(merged.indices.size()))
+				return false;
+
+			//the max over the levels below rather than their sum, every level is simplified from the
+			//one under it and its vertices are source vertices, so errors don't stack up in practice.
+			glm::vec4 sphere = pending[members[0]].sphere;
+			for (size_t member : members)
+			{
+				error = std::max(error, pending[member].childError);
+				sphere = enclosingSphere(enclosingSphere(sphere, pending[member].sphere), pending[member].childSphere);
+			}
+			int32_t group = writeGroup(pending, members, error, sphere);
+			cutClusters(merged, simplified, group, error, sphere, next);
+			return true;
+		}
+
+		//groups, simplifies and cuts level by level until no group shrinks anymore. what is left are
+		//clusters along borders that only a bigger block can simplify, and the coarsest level.
+		void simplifyLevels(std::vector<PendingCluster>& pending)
+		{
+			bool shrunk = true;
+			while (shrunk)
+			{
+				shrunk = false;
+				std::vector<PendingCluster> next;
+				for (const std::vector<size_t>& group : groupClusters(pending))
+				{
+					if (simplifyGroup(pending, group, next))
+						shrunk = true;
+					else
+						for (size_t member : group)
+							next.push_back(std::move(pending[member]));
+				}
+				pending.swap(next);
+			}
+		}
+
+		//post order, only the unsimplified clusters of one block per level of the split are ever held.
+		std::vector<PendingCluster> buildBlock(const Subset& subset)
+		{
+			std::vector<PendingCluster> pending;
+			if (subset.count <= blockTriangles)
+			{
+				MeshData block = loadBlock(subset);
+				std::remove(subset.filename.c_str());
+				cutClusters(block, block.indices, -1, 0.0f, glm::vec4(0.0f), pending);
+				block = MeshData();
+				simplifyLevels(pending);
+				return pending;
+			}
+
+			std::pair<Subset, Subset> sides = split(subset);
+			std::remove(subset.filename.c_str());
+			pending = buildBlock(sides.first);
+			std::vector<PendingCluster> right = buildBlock(sides.second);
+			for (PendingCluster& cluster : right)
+				pending.push_back(std::move(cluster));
+			right.clear();
+			simplifyLevels(pending);
+			return pending;
+		}
+
+		ClusterBuildInfo info;
+		glm::vec3 defaultNormal;
+		mappedFile positions, texCoords, normals;
+		std::ofstream output;
+		std::vector<ClusterGroup> groups;
+		std::vector<ClusterRecord> clusters;
+		size_t blockTriangles;
+		unsigned int fileCount;
+		uint32_t maxVertexCount, maxIndexCount;
+		int64_t positionCount, texCoordCount, normalCount;
+		uint64_t triangleCount;
+	};
+}
+
+bool util::buildClusterHierarchy(ClusterBuildInfo* buildInfo)
+{
+	HierarchyBuilder builder(*buildInfo);
+	return builder.build();
+}
@@ -0,0 +1,68 @@
+#pragma once
+#include "../config.h"
+#include "objectLoader.h"
+
+//paged cluster file, for meshes too large to ever be loaded whole.
+//header, the pages, the group table and then the cluster table, written by buildClusterHierarchy.
+const char clusterFileMagic[4] = { 'C', 'L', 'U', 'S' };
+const uint32_t clusterFileVersion = 2;
+
+struct ClusterFileHeader
+{
+	char magic[4];
+	uint32_t version;
+	uint32_t groupCount, clusterCount;
+	uint64_t groupOffset, clusterOffset;
+	//largest page in the file, the streamer sizes its gpu slots from these.
+	uint32_t maxVertexCount, maxIndexCount;
+	VertexLayout layout;
+};
+
+//neighbouring clusters simplified together, the clusters of the next level up came out of them.
+//the group is the page, its clusters are streamed and drawn instead of that coarser level as one.
+//a page is vertexCount float vertices followed by indexCount 32 bit indices.
+struct ClusterGroup
+{
+	//center xyz, radius w. encloses the groups below so projected error only grows upwards.
+	float sphere[4];
+	//of the clusters simplified out of this group, in mesh units, at least that of every group below.
+	//max float for the root groups, which are always resident and have nothing coarser.
+	float error;
+	uint32_t firstCluster, clusterCount;
+	uint32_t vertexCount, indexCount;
+	uint32_t padding;
+	uint64_t pageOffset;
+};
+
+//at most leafTriangles triangles, vertices and indices relative to the start of its group's page.
+struct ClusterRecord
+{
+	//center xyz, radius w, for culling.
+	float sphere[4];
+	//the group this cluster was simplified from, drawn instead of it up close. -1 for source triangles.
+	int32_t childGroup;
+	uint32_t firstVertex, vertexCount;
+	uint32_t firstIndex, indexCount;
+	uint32_t padding[3];
+};
+
+struct ClusterBuildInfo
+{
+	const char* sourceFilename;
+	const char* clusterFilename;
+	glm::mat4 preTransform;
+	//triangles per cluster at every level, pages hold a few clusters.
+	unsigned int leafTriangles;
+	//how much of the obj gets parsed at once, the rest is only ever seen through temporary files.
+	size_t sliceBytes;
+};
+
+namespace util
+{
+	//streams the obj slice by slice into temporary files next to the output and splits the triangles
+	//spatially into blocks of about a slice. every block is cut into clusters, and neighbouring
+	//clusters are grouped, simplified to half and cut again level by level, grouped differently
+	//each time so a border locked at one level is simplified at the next. sibling blocks continue
+	//with what is left of both, so memory stays around one slice.
+	bool buildClusterHierarchy(ClusterBuildInfo* buildInfo);
+}
@@ -0,0 +1,353 @@
+#include "clusterStreamer.h"
+
+namespace
+{
+	//set in loading for pages that couldn't be read, so they aren't requested again every frame.
+	const unsigned char pageFailed = 2;
+}
+
+ClusterStreamer::ClusterStreamer(ClusterStreamerCreateInfo* createInfo)
+	: filename(createInfo->filename), uploads(createInfo->uploads), rootsResident(false), uploadsPerFrame(std::max(1u, createInfo->uploadsPerFrame)),
+	maxPendingPages(std::max(1u, createInfo->maxPendingPages)), slotVertices(0), slotIndices(0), frame(0), ringFull(false), stopping(false)
+{
+	VBO = EBO = VAO = 0;
+	layout = util::floatVertexLayout();
+
+	std::ifstream file(filename, std::ios::binary);
+	ClusterFileHeader header{};
+	file.read(reinterpret_cast<char*>(&header), sizeof(header));
+	if (!file || memcmp(header.magic, clusterFileMagic, sizeof(header.magic)) != 0
+		|| header.version != clusterFileVersion || header.groupCount == 0)
+	{
+		std::cout << "Failed to open cluster file " << filename << '\n';
+		return;
+	}
+
+	groups.resize(header.groupCount);
+	clusters.resize(header.clusterCount);
+	file.seekg(header.groupOffset);
+	file.read(reinterpret_cast<char*>(groups.data()), groups.size() * sizeof(ClusterGroup));
+	file.seekg(header.clusterOffset);
+	file.read(reinterpret_cast<char*>(clusters.data()), clusters.size() * sizeof(ClusterRecord));
+	bool consistent = bool(file);
+	for (const ClusterGroup& group : groups)
+		consistent = consistent && uint64_t(group.firstCluster) + group.clusterCount <= clusters.size();
+	for (const ClusterRecord& cluster : clusters)
+		consistent = consistent && cluster.childGroup < int64_t(groups.size());
+	if (!consistent)
+	{
+		std::cout << "Cluster file " << filename << " is truncated\n";
+		groups.clear();
+		clusters.clear();
+		return;
+	}
+
+	//every cluster names the group it came from, turned around into the groups every group is needed by.
+	parentOffsets.assign(groups.size() + 1, 0);
+	for (const ClusterGroup& group : groups)
+		for (uint32_t c = group.firstCluster; c < group.firstCluster + group.clusterCount; ++c)
+			if (clusters[c].childGroup >= 0)
+				++parentOffsets[clusters[c].childGroup + 1];
+	for (size_t g = 0; g < groups.size(); ++g)
+		parentOffsets[g + 1] += parentOffsets[g];
+	parents.resize(parentOffsets.back());
+	std::vector<uint32_t> filled(parentOffsets.begin(), parentOffsets.end() - 1);
+	for (uint32_t g = 0; g < groups.size(); ++g)
+		for (uint32_t c = groups[g].firstCluster; c < groups[g].firstCluster + groups[g].clusterCount; ++c)
+			if (clusters[c].childGroup >= 0)
+				parents[filled[clusters[c].childGroup]++] = g;
+
+	layout = header.layout;
+	slotVertices = header.maxVertexCount;
+	slotIndices = header.maxIndexCount;
+	size_t slotBytes = slotVertices * layout.stride + slotIndices * sizeof(uint32_t);
+	size_t slotCount = std::max<size_t>(1, createInfo->residentBytes / std::max<size_t>(slotBytes, 1));
+
+	glCreateBuffers(1, &VBO);
+	glCreateBuffers(1, &EBO);
+	glCreateVertexArrays(1, &VAO);
+	glVertexArrayVertexBuffer(VAO, 0, VBO, 0, layout.stride);
+	glVertexArrayElementBuffer(VAO, EBO);
+	glNamedBufferStorage(VBO, slotCount * slotVertices * layout.stride, nullptr, 0);
+	glNamedBufferStorage(EBO, slotCount * slotIndices * sizeof(uint32_t), nullptr, 0);
+	for (unsigned int i = 0; i < 3; ++i)
+	{
+		const VertexAttribute& attribute = layout.attributes[i];
+		glEnableVertexArrayAttrib(VAO, i);
+		glVertexArrayAttribFormat(VAO, i, attribute.components, attribute.type, attribute.normalized, attribute.offset);
+		glVertexArrayAttribBinding(VAO, i, 0);
+	}
+
+	groupSlots.assign(groups.size(), -1);
+	lastUsed.assign(groups.size(), 0);
+	loading.assign(groups.size(), 0);
+	slotGroups.assign(slotCount, -1);
+	for (size_t slot = slotCount; slot-- > 0;)
+		freeSlots.push_back(int(slot));
+
+	//the root groups are what gets drawn while nothing else is resident, read up front and never evicted.
+	rootsResident = true;
+	for (uint32_t g = 0; g < groups.size() && rootsResident; ++g)
+	{
+		if (parentOffsets[g] != parentOffsets[g + 1])
+			continue;
+		LoadedPage root;
+		root.group = g;
+		if (!uploads->allocate(pageBytes(g), root.region))
+		{
+			std::cout << "A root page of " << filename << " doesn't fit the upload ring\n";
+			rootsResident = false;
+		}
+		else if (!readPage(file, g, root.region.data))
+		{
+			std::cout << "Failed to read a root page of " << filename << '\n';
+			uploads->release(root.region);
+			rootsResident = false;
+		}
+		else if (!upload(root))
+		{
+			std::cout << "The root pages of " << filename << " don't fit the resident budget\n";
+			rootsResident = false;
+		}
+	}
+
+	loader = std::thread(&ClusterStreamer::loaderLoop, this);
+}
+
+ClusterStreamer::~ClusterStreamer()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	wake.notify_all();
+	if (loader.joinable())
+		loader.join();
+
+	//loaded pages that never got uploaded.
+	for (const LoadedPage& page : loaded)
+		uploads->release(page.region);
+
+	glDeleteVertexArrays(1, &VAO);
+	glDeleteBuffers(1, &VBO);
+	glDeleteBuffers(1, &EBO);
+}
+
+size_t ClusterStreamer::pageBytes(uint32_t group)
+{
+	const ClusterGroup& page = groups[group];
+	return size_t(page.vertexCount) * layout.stride + size_t(page.indexCount) * sizeof(uint32_t);
+}
+
+bool ClusterStreamer::readPage(std::ifstream& file, uint32_t group, unsigned char* data)
+{
+	file.clear();
+	file.seekg(groups[group].pageOffset);
+	file.read(reinterpret_cast<char*>(data), pageBytes(group));
+	return bool(file);
+}
+
+void ClusterStreamer::loaderLoop()
+{
+	std::ifstream file(filename, std::ios::binary);
+	std::unique_lock<std::mutex> lock(mutex);
+	while (true)
+	{
+		wake.wait(lock, [this] { return stopping || (!requests.empty() && loaded.size() < maxPendingPages && !ringFull); });
+		if (stopping)
+			return;
+
+		LoadedPage page;
+		page.group = requests.back();
+		if (!uploads->allocate(pageBytes(page.group), page.region))
+		{
+			ringFull = true;
+			continue;
+		}
+		requests.pop_back();
+		loading[page.group] = 1;
+
+		//the render thread keeps going while the disk is busy.
+		lock.unlock();
+		bool read = readPage(file, page.group, page.region.data);
+		lock.lock();
+
+		if (read)
+			loaded.push_back(page);
+		else
+		{
+			std::cout << "Failed to read cluster page " << page.group << " of " << filename << '\n';
+			uploads->release(page.region);
+			loading[page.group] = pageFailed;
+		}
+	}
+}
+
+bool ClusterStreamer::loadable(uint32_t group)
+{
+	for (uint32_t i = parentOffsets[group]; i < parentOffsets[group + 1]; ++i)
+		if (groupSlots[parents[i]] < 0)
+			return false;
+	return true;
+}
+
+bool ClusterStreamer::evictable(uint32_t group)
+{
+	const ClusterGroup& page = groups[group];
+	if (parentOffsets[group] == parentOffsets[group + 1])
+		return false;
+	for (uint32_t c = page.firstCluster; c < page.firstCluster + page.clusterCount; ++c)
+		if (clusters[c].childGroup >= 0 && groupSlots[clusters[c].childGroup] >= 0)
+			return false;
+	return true;
+}
+
+bool ClusterStreamer::upload(const LoadedPage& page)
+{
+	//what it would be drawn instead of got evicted while it was loading.
+	if (!loadable(page.group))
+	{
+		uploads->release(page.region);
+		return false;
+	}
+
+	//evict the least recently used group that wasn't drawn this or last frame, never one the new page needs.
+	if (freeSlots.empty())
+	{
+		const uint32_t* needed = parents.data() + parentOffsets[page.group];
+		const uint32_t* neededEnd = parents.data() + parentOffsets[page.group + 1];
+		int victim = -1;
+		for (size_t slot = 0; slot < slotGroups.size(); ++slot)
+		{
+			int group = slotGroups[slot];
+			if (group < 0 || lastUsed[group] + 1 >= frame || !evictable(uint32_t(group))
+				|| std::find(needed, neededEnd, uint32_t(group)) != neededEnd)
+				continue;
+			if (victim < 0 || lastUsed[group] < lastUsed[slotGroups[victim]])
+				victim = int(slot);
+		}
+		//everything resident is in use, the page gets requested again once something isn't.
+		if (victim < 0)
+		{
+			uploads->release(page.region);
+			return false;
+		}
+
+		groupSlots[slotGroups[victim]] = -1;
+		slotGroups[victim] = -1;
+		freeSlots.push_back(victim);
+	}
+
+	int slot = freeSlots.back();
+	freeSlots.pop_back();
+
+	const ClusterGroup& group = groups[page.group];
+	size_t vertexBytes = size_t(group.vertexCount) * layout.stride;
+	uploads->copyToBuffer(page.region, 0, vertexBytes, VBO, slot * slotVertices * layout.stride);
+	uploads->copyToBuffer(page.region, vertexBytes, size_t(group.indexCount) * sizeof(uint32_t), EBO, slot * slotIndices * sizeof(uint32_t));
+	uploads->release(page.region);
+
+	groupSlots[page.group] = slot;
+	slotGroups[slot] = int(page.group);
+	lastUsed[page.group] = frame;
+	return true;
+}
+
+float ClusterStreamer::projectedError(uint32_t group)
+{
+	const ClusterGroup& page = groups[group];
+	float distance = std::max(glm::length(glm::make_vec3(page.sphere) - cameraPosition) - page.sphere[3], 0.1f);
+	return page.error * pixelsPerUnit / distance;
+}
+
+bool ClusterStreamer::refined(uint32_t group)
+{
+	return groups[group].error == std::numeric_limits<float>::max() || projectedError(group) > pixelError;
+}
+
+void ClusterStreamer::draw(const glm::mat4& viewProjection, glm::vec3 cameraPosition, float pixelsPerUnit, float pixelError)
+{
+	if (groups.empty() || !rootsResident)
+		return;
+	++frame;
+
+	std::vector<LoadedPage> pages;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		while (!loaded.empty() && pages.size() < uploadsPerFrame)
+		{
+			pages.push_back(loaded.front());
+			loaded.pop_front();
+			loading[pages.back().group] = 0;
+		}
+		//the last submit may have freed ring space.
+		ringFull = false;
+	}
+	for (const LoadedPage& page : pages)
+		upload(page);
+
+	planes = util::frustumPlanes(viewProjection);
+	this->cameraPosition = cameraPosition;
+	this->pixelsPerUnit = pixelsPerUnit;
+	this->pixelError = pixelError;
+	wanted.clear();
+	drawCounts.clear();
+	drawOffsets.clear();
+	drawBaseVertices.clear();
+
+	//a cluster is drawn when its group is refined and the group it was simplified from isn't. errors
+	//and spheres only grow upwards and loading keeps every refined group's parents resident, so each
+	//spot of the surface is covered by exactly one level.
+	for (size_t slot = 0; slot < slotGroups.size(); ++slot)
+	{
+		int resident = slotGroups[slot];
+		if (resident < 0 || !refined(uint32_t(resident)))
+			continue;
+		const ClusterGroup& group = groups[resident];
+		if (!util::sphereInFrustum(planes, glm::make_vec3(group.sphere), group.sphere[3]))
+			continue;
+		lastUsed[resident] = frame;
+
+		for (uint32_t c = group.firstCluster; c < group.firstCluster + group.clusterCount; ++c)
+		{
+			const ClusterRecord& cluster = clusters[c];
+			bool visible = util::sphereInFrustum(planes, glm::make_vec3(cluster.sphere), cluster.sphere[3]);
+			int32_t child = cluster.childGroup;
+			if (child >= 0 && refined(uint32_t(child)))
+			{
+				//drawn finer from the child's own slot.
+				if (groupSlots[child] >= 0)
+					continue;
+				if (visible && loadable(uint32_t(child)))
+					wanted.push_back(std::make_pair(projectedError(uint32_t(child)), uint32_t(child)));
+			}
+			if (!visible)
+				continue;
+
+			drawCounts.push_back(int(cluster.indexCount));
+			drawOffsets.push_back(reinterpret_cast<const void*>((slot * slotIndices + cluster.firstIndex) * sizeof(uint32_t)));
+			drawBaseVertices.push_back(int(slot * slotVertices + cluster.firstVertex));
+		}
+	}
+
+	//replaces last frame's requests, pages nobody wants anymore are never read.
+	//sorted by error, the loader takes the worst one from the back first. a child shows up once per
+	//cluster simplified out of it.
+	std::sort(wanted.begin(), wanted.end());
+	wanted.erase(std::unique(wanted.begin(), wanted.end()), wanted.end());
+	size_t maxRequests = 4 * size_t(maxPendingPages);
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		requests.clear();
+		for (size_t i = wanted.size() > maxRequests ? wanted.size() - maxRequests : 0; i < wanted.size(); ++i)
+			if (!loading[wanted[i].second])
+				requests.push_back(wanted[i].second);
+	}
+	wake.notify_one();
+
+	if (drawCounts.empty())
+		return;
+	glBindVertexArray(VAO);
+	glMultiDrawElementsBaseVertex(GL_TRIANGLES, drawCounts.data(), GL_UNSIGNED_INT, drawOffsets.data(),
+		(int)drawCounts.size(), drawBaseVertices.data());
+}
@@ -0,0 +1,95 @@
+#pragma once
+#include "../config.h"
+#include "clusterHierarchy.h"
+#include "meshlet.h"
+#include "uploadRing.h"
+
+struct ClusterStreamerCreateInfo
+{
+	const char* filename;
+	//gpu memory for resident pages, split into slots that each fit the largest page.
+	size_t residentBytes;
+	//pages the loader thread may hold in ram before the render thread uploads them.
+	unsigned int maxPendingPages;
+	//bounds the hitch when the camera jumps somewhere nothing is resident.
+	unsigned int uploadsPerFrame;
+	//pages are read straight into it, the largest page has to fit.
+	UploadRing* uploads;
+};
+
+//draws a paged cluster hierarchy with a fixed memory footprint, only the group and cluster tables are
+//kept in ram. a page is a group. it's only loaded while the groups holding what it was simplified into
+//are resident and only evicted while none of the groups its clusters were simplified from are, so the
+//drawn cut never has holes or overlaps. pages are read on a loader thread, most visible error first,
+//and the least recently used get evicted.
+class ClusterStreamer
+{
+public:
+	unsigned int VBO, EBO, VAO;
+	VertexLayout layout;
+
+	ClusterStreamer(ClusterStreamerCreateInfo* createInfo);
+	~ClusterStreamer();
+
+	//uploads finished pages, then draws the finest resident cut whose error stays under pixelError
+	//and queues the pages it would rather have drawn. pixelsPerUnit is the size in pixels of one unit
+	//one unit away, clusters are in world space.
+	void draw(const glm::mat4& viewProjection, glm::vec3 cameraPosition, float pixelsPerUnit, float pixelError);
+
+private:
+	struct LoadedPage
+	{
+		uint32_t group;
+		UploadRegion region;
+	};
+
+	void loaderLoop();
+	size_t pageBytes(uint32_t group);
+	bool readPage(std::ifstream& file, uint32_t group, unsigned char* data);
+	bool upload(const LoadedPage& page);
+	//every group holding a cluster simplified out of this one is resident.
+	bool loadable(uint32_t group);
+	//none of the groups its clusters were simplified from is resident.
+	bool evictable(uint32_t group);
+	float projectedError(uint32_t group);
+	//the group's clusters are drawn rather than the coarser ones simplified out of it.
+	bool refined(uint32_t group);
+
+	std::string filename;
+	UploadRing* uploads;
+	std::vector<ClusterGroup> groups;
+	std::vector<ClusterRecord> clusters;
+	//groups holding the clusters simplified out of group g are parents[parentOffsets[g]] up to parentOffsets[g + 1].
+	std::vector<uint32_t> parentOffsets, parents;
+	bool rootsResident;
+	unsigned int uploadsPerFrame, maxPendingPages;
+
+	//slot of every resident group or -1, and the frame it was last drawn.
+	std::vector<int> groupSlots;
+	std::vector<uint64_t> lastUsed;
+	//group in every slot or -1.
+	std::vector<int> slotGroups;
+	std::vector<int> freeSlots;
+	size_t slotVertices, slotIndices;
+	uint64_t frame;
+
+	//per frame traversal state.
+	std::array<glm::vec4, 6> planes;
+	glm::vec3 cameraPosition;
+	float pixelsPerUnit, pixelError;
+	std::vector<std::pair<float, uint32_t>> wanted;
+	std::vector<int> drawCounts, drawBaseVertices;
+	std::vector<const void*> drawOffsets;
+
+	//shared with the loader, guarded by mutex. requests are sorted so the most wanted is at the back.
+	std::thread loader;
+	std::mutex mutex;
+	std::condition_variable wake;
+	std::vector<uint32_t> requests;
+	std::deque<LoadedPage> loaded;
+	//set from the moment the loader takes a request until the page gets uploaded.
+	std::vector<unsigned char> loading;
+	//set when the loader couldn't get ring space, it waits for the next frame to free some.
+	bool ringFull;
+	bool stopping;
+};
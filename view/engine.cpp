@@ -1,52 +1,73 @@
 #include "engine.h"
 
-Engine::Engine(int widht, int height)
+Engine::Engine(int widht, int height, size_t textureBudget, Scene* scene)
 {
-	shader = util::loadShader("shaders/vertex.txt", "shaders/fragment.txt");
-	glUseProgram(shader);
-	//allocating texture 0 to the texture.
-	glUniform1i(glGetUniformLocation(shader, "basicTexture"), 0);
+	//drivers without it, mesa's software one among them, get the texture array path.
+	bindless = BindlessMaterials::supported();
+	if (bindless)
+		baseDefines = "#define BINDLESS\n";
+	//variants compile while models and textures load, each is waited for once it's needed.
+	util::enableParallelShaderCompile();
+	variant = nullptr;
+	lightCount = (unsigned int)std::min<size_t>(scene->lights.size(), maxLights);
 
+	//only the normal encoding of a layout picks the variant. the cube is packed compact, the glb and
+	//the terrain clusters keep float vertices. which files are there is known without loading them.
+	VertexLayout floatLayout = util::floatVertexLayout();
+	VertexLayout compactLayout = floatLayout;
+	compactLayout.octahedralNormals = util::compactVertexFormat().normal == NormalFormat::OCTAHEDRAL_SNORM16;
+	requestVariant(compactLayout, false);
+	int64_t modifiedTime, size;
+	bool clusters = util::fileStamp("models/terrain.clusters", modifiedTime, size);
+	if (clusters || util::fileStamp("models/scene.glb", modifiedTime, size))
+		requestVariant(floatLayout, false);
+	if (clusters && util::fileStamp("textures/terrain.vtex", modifiedTime, size))
+		requestVariant(floatLayout, true);
 
 	float aspectRatio = (float)widht / (float)height;
+	screenHeight = height;
+	lodPixelError = 1.0f;
 
 	//setup frambuffer
 	glClearColor(0.0f, 0.0f, 0.0f, 1.0f); //what color to clear screen with.
 	glEnable(GL_DEPTH_TEST);
 	//setup perspective transform for the shader.
-	glm::mat4 projectionTransform = glm::perspective(45.f, aspectRatio, 0.1f, 10.0f);
-	//4floatvector matrix,sends projection data to shader.
-	glUniformMatrix4fv(glGetUniformLocation(shader, "projection"), 1, GL_FALSE, glm::value_ptr(projectionTransform));
+	projectionTransform = glm::perspective(45.f, aspectRatio, 0.1f, 10.0f);
 
+	//both blocks live in one buffer, the light block starts on the next offset a binding may start at.
+	int uniformAlignment = 256;
+	glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &uniformAlignment);
+	lightUniformOffset = (sizeof(FrameUniforms) + uniformAlignment - 1) / uniformAlignment * uniformAlignment;
+	frameUniformData.resize(lightUniformOffset + maxLights * sizeof(LightUniform));
+	glCreateBuffers(1, &frameUniformBuffer);
+	glNamedBufferStorage(frameUniformBuffer, frameUniformData.size(), nullptr, GL_DYNAMIC_STORAGE_BIT);
 
-	std::stringstream location;
-	for (int i = 0; i < 8; i++)
-	{
-		location.str("");
-		location << "lights[" << i << "].color";
-		lights.colorLoc[i] = glGetUniformLocation(shader, location.str().c_str());
-
-		location.str("");
-		location << "lights[" << i << "].position";
-		lights.positionLoc[i] = glGetUniformLocation(shader, location.str().c_str());
-
-		location.str("");
-		location << "lights[" << i << "].strength";
-		lights.strengthLoc[i] = glGetUniformLocation(shader, location.str().c_str());
-	}
-	
+	UploadRingCreateInfo uploadInfo;
+	uploadInfo.bytes = 64 << 20;
+	uploads = new UploadRing(&uploadInfo);
 
-	cameraPosLoc = glGetUniformLocation(shader, "cameraPosition");
+	TextureResidencyCreateInfo residencyInfo;
+	residencyInfo.budgetBytes = textureBudget;
+	residencyInfo.evictAfterFrames = 300;
+	residencyInfo.evictedSize = 16;
+	residencyInfo.maxPendingReloads = 4;
+	residencyInfo.uploads = uploads;
+	residency = new TextureResidency(&residencyInfo);
 
 	createModels();
 	createMaterials();	
+	resources.printStats();
 } 
 
 Engine::~Engine()
 {
-	delete cardboardMaterial;
-	delete cubeModel;
-	glDeleteProgram(shader);
+	delete terrainTexture;
+	delete terrain;
+	//gives its unapplied levels back to the ring.
+	delete residency;
+	delete uploads;
+	delete sceneModel;
+	glDeleteBuffers(1, &frameUniformBuffer);
 }
 
 void Engine::createModels()
@@ -54,46 +75,421 @@ void Engine::createModels()
 	MeshCreateInfo cubeInfo;
 	cubeInfo.filename = "models/cube.obj";
 	cubeInfo.preTransform = 0.2f * glm::mat4(1.0);
-	cubeModel = new ObjectMesh(&cubeInfo);
+	cubeInfo.optimize = true;
+	cubeInfo.format = util::compactVertexFormat();
+	cubeInfo.buildMeshlets = true;
+	cubeInfo.lodCount = 4;
+	cubeInfo.compress = true;
+	cubeModel = resources.mesh(&cubeInfo);
+
+	terrain = nullptr;
+	int64_t modifiedTime, size;
+	if (util::fileStamp("models/terrain.clusters", modifiedTime, size))
+	{
+		ClusterStreamerCreateInfo terrainInfo;
+		terrainInfo.filename = "models/terrain.clusters";
+		terrainInfo.residentBytes = 256 << 20;
+		terrainInfo.maxPendingPages = 32;
+		terrainInfo.uploadsPerFrame = 8;
+		terrainInfo.uploads = uploads;
+		terrain = new ClusterStreamer(&terrainInfo);
+	}
+
+	terrainTexture = nullptr;
+	if (terrain && util::fileStamp("textures/terrain.vtex", modifiedTime, size))
+	{
+		VirtualTextureCreateInfo textureInfo;
+		textureInfo.filename = "textures/terrain.vtex";
+		textureInfo.physicalPagesPerSide = 16;
+		textureInfo.maxPendingPages = 32;
+		textureInfo.uploadsPerFrame = 16;
+		textureInfo.uploads = uploads;
+		terrainTexture = new VirtualTexture(&textureInfo);
+	}
+
+	sceneModel = nullptr;
+	if (util::fileStamp("models/scene.glb", modifiedTime, size))
+	{
+		GltfModelCreateInfo sceneInfo;
+		sceneInfo.filename = "models/scene.glb";
+		sceneModel = new GltfModel(&sceneInfo);
+	}
+}
+
+void Engine::populateScene(Scene* scene)
+{
+	//the variants were requested by the constructor, before any asset loaded.
+	if (!sceneModel)
+		return;
+
+	for (const GltfInstance& instance : sceneModel->instances)
+	{
+		SceneNodeCreateInfo nodeInfo;
+		nodeInfo.modelTransform = instance.transform;
+		nodeInfo.mesh = instance.mesh;
+		scene->addNode(&nodeInfo);
+	}
 }
 
 void Engine::createMaterials()
 {
 	MaterialCreateInfo materialInfo;
-	materialInfo.filename = "textures/cardboard.jpg";
-	cardboardMaterial = new Material(&materialInfo);
+	materialInfo.filename = nullptr;
+	materialInfo.diffuse = glm::vec3(1.0f);
+	defaultMaterial = resources.material(&materialInfo);
+
+	cubeMaterials = createMeshMaterials(cubeModel.get());
+	buildMaterialTextures();
 }
 
-void Engine::render(Scene* scene)
+void Engine::buildMaterialTextures()
 {
-	//prepare shaders
-	glUniformMatrix4fv(glGetUniformLocation(shader, "view"), 1, GL_FALSE,
-		glm::value_ptr(scene->player->viewTransform)
-	);
+	materials = { defaultMaterial.get() };
+	for (const std::shared_ptr<Material>& material : cubeMaterials)
+		materials.push_back(material.get());
 
+	std::vector<Texture*> textures;
+	for (Material* material : materials)
+		textures.push_back(material->texture.get());
 
-	glUniformMatrix4fv(glGetUniformLocation(shader, "model"), 1, GL_FALSE,
-		glm::value_ptr(scene->cube->modelTransform)
-	);
+	if (bindless)
+	{
+		residency->track(textures, {});
+		bindlessMaterials.build(materials);
+		return;
+	}
 
-	glUniform3fv(cameraPosLoc, 1, glm::value_ptr(scene->player->position));
+	//the arrays hold the only copy, atlas textures keep the size they were packed at.
+	textureArrays.build(textures);
+	std::vector<Texture*> fixedSize;
+	for (Material* material : materials)
+	{
+		material->slot = textureArrays.slot(material->texture.get());
+		if (!textureArrays.resizable(material->texture.get()))
+			fixedSize.push_back(material->texture.get());
+	}
+	residency->track(textures, fixedSize);
+}
 
-	int i{ 0 };
-	for (Light* light : scene->lights)
+std::vector<std::shared_ptr<Material>> Engine::createMeshMaterials(const ObjectMesh* mesh)
+{
+	std::vector<std::shared_ptr<Material>> meshMaterials;
+	for (const MeshMaterial& meshMaterial : mesh->materials)
 	{
-		glUniform3fv(lights.colorLoc[i], 1, glm::value_ptr(light->color));
-		glUniform3fv(lights.positionLoc[i], 1, glm::value_ptr(light->position));
-		glUniform1f(lights.strengthLoc[i], light->strength);
-		++i;
+		MaterialCreateInfo materialInfo;
+		materialInfo.filename = meshMaterial.diffuseTexture[0] ? meshMaterial.diffuseTexture : nullptr;
+		materialInfo.diffuse = glm::make_vec3(meshMaterial.diffuse);
+		meshMaterials.push_back(resources.material(&materialInfo));
 	}
-	
+	return meshMaterials;
+}
 
+void Engine::render(Scene* scene)
+{
+	resources.pollShaders();
+
+	//textures that shrink or grow get new names, only their own handle or array layer follows.
+	//free layers and atlas space count against the budget too. advances the frame the variants
+	//and materials are stamped with.
+	size_t arrayBytes = bindless ? 0 : textureArrays.residentBytes();
+	size_t textureBytes = residency->residentBytes();
+	uint64_t releasedArrays = textureArrays.releasedArrays;
+	for (const TextureChange& change : residency->update(arrayBytes > textureBytes ? arrayBytes - textureBytes : 0))
+	{
+		if (bindless)
+		{
+			bindlessMaterials.release(change.texture);
+			change.texture->setFirstLevel(change.level, &change.region, uploads);
+			bindlessMaterials.update(change.texture, materials);
+			continue;
+		}
+
+		if (!textureArrays.setFirstLevel(change.texture, change.level, &change.region, uploads))
+		{
+			residency->block(change.texture);
+			continue;
+		}
+		for (Material* material : materials)
+			if (material->texture.get() == change.texture)
+				material->slot = textureArrays.slot(change.texture);
+	}
+	residency->finish();
+	//textures that found no unit for their new size get another try once an array went away.
+	if (textureArrays.releasedArrays != releasedArrays)
+		residency->unblock();
+	lightCount = (unsigned int)std::min<size_t>(scene->lights.size(), maxLights);
+
+	//every program reads the frame's uniforms from here, one update replaces a call per uniform per program.
+	FrameUniforms frameUniforms{};
+	frameUniforms.view = scene->player->viewTransform;
+	frameUniforms.projection = projectionTransform;
+	frameUniforms.cameraPosition = scene->player->position;
+	std::array<LightUniform, maxLights> lightUniforms{};
+	for (unsigned int i = 0; i < lightCount; ++i)
+	{
+		lightUniforms[i].position = scene->lights[i]->position;
+		lightUniforms[i].color = scene->lights[i]->color;
+		lightUniforms[i].strength = scene->lights[i]->strength;
+	}
+	memcpy(frameUniformData.data(), &frameUniforms, sizeof(frameUniforms));
+	memcpy(frameUniformData.data() + lightUniformOffset, lightUniforms.data(), sizeof(lightUniforms));
+	glNamedBufferSubData(frameUniformBuffer, 0, frameUniformData.size(), frameUniformData.data());
+	glBindBufferRange(GL_UNIFORM_BUFFER, frameUniformBinding, frameUniformBuffer, 0, sizeof(FrameUniforms));
+	glBindBufferRange(GL_UNIFORM_BUFFER, lightUniformBinding, frameUniformBuffer, lightUniformOffset, sizeof(lightUniforms));
 
 	//draw		
 	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT); //clear buffer.
+	if (bindless)
+		bindlessMaterials.bind();
+	else
+		textureArrays.bind();
+	queueMesh(cubeModel.get(), cubeMaterials, scene->cube->modelTransform, scene->player->viewTransform, scene->player->position, scene->cube->lod);
+	drawQueue();
+
+	//neither carries materials yet.
+	if (sceneModel)
+	{
+		useVariant(requestVariant(sceneModel->layout, false));
+		defaultMaterial->use(variant->material, residency->frame);
+		setVertexLayout(sceneModel->layout);
+		for (SceneNode* node : scene->nodes)
+		{
+			glUniformMatrix4fv(variant->model, 1, GL_FALSE, glm::value_ptr(node->modelTransform));
+			sceneModel->draw(node->mesh, util::frustumPlanes(projectionTransform * scene->player->viewTransform * node->modelTransform));
+		}
+	}
+
+	if (terrain)
+	{
+		useVariant(requestVariant(terrain->layout, terrainTexture != nullptr));
+		defaultMaterial->use(variant->material, residency->frame);
+		glUniformMatrix4fv(variant->model, 1, GL_FALSE, glm::value_ptr(glm::mat4(1.0f)));
+		setVertexLayout(terrain->layout);
+		if (terrainTexture)
+		{
+			terrainTexture->update();
+			terrainTexture->use(variant->virtualTexture);
+		}
+		terrain->draw(projectionTransform * scene->player->viewTransform, scene->player->position,
+			projectionTransform[1][1] * 0.5f * screenHeight, lodPixelError);
+		if (terrainTexture)
+			terrainTexture->finish(variant->virtualTexture);
+	}
+
+	//fences this frame's copies, regions of earlier frames the gpu is done with go back to the loaders.
+	uploads->submit();
+}
+
+void Engine::setVertexLayout(const VertexLayout& layout)
+{
+	glUniform3fv(variant->dequantize.positionOffset, 1, layout.positionOffset);
+	glUniform3fv(variant->dequantize.positionScale, 1, layout.positionScale);
+	glUniform2fv(variant->dequantize.texCoordOffset, 1, layout.texCoordOffset);
+	glUniform2fv(variant->dequantize.texCoordScale, 1, layout.texCoordScale);
+}
+
+ShaderVariant& Engine::requestVariant(const VertexLayout& layout, bool virtualTexture)
+{
+	ShaderVariantKey key;
+	key.lightCount = lightCount;
+	key.virtualTexture = virtualTexture;
+	key.octahedralNormals = layout.octahedralNormals != 0;
+	ShaderVariant& requested = variants[util::variantId(key)];
+	if (requested.shader)
+		return requested;
+
+	std::string defines = util::variantDefines(key, bindless ? baseDefines.c_str() : nullptr);
+	ShaderCreateInfo shaderInfo;
+	shaderInfo.vertexFilepath = "shaders/vertex.txt";
+	shaderInfo.fragmentFilepath = "shaders/fragment.txt";
+	shaderInfo.defines = defines.c_str();
+	//one module per feature set, the light count specializes it at load.
+	std::string vertexSpirv = util::variantSpirvFilepath("vertex", key, bindless);
+	std::string fragmentSpirv = util::variantSpirvFilepath("fragment", key, bindless);
+	shaderInfo.vertexSpirvFilepath = vertexSpirv.c_str();
+	shaderInfo.fragmentSpirvFilepath = fragmentSpirv.c_str();
+	shaderInfo.constantIds = { lightCountConstant };
+	shaderInfo.constantValues = { lightCount };
+	requested.shader = resources.shader(&shaderInfo);
+	requested.initialized = false;
+	return requested;
+}
+
+void Engine::useVariant(ShaderVariant& variant)
+{
+	unsigned int shader = variant.shader->program;
+	if (!variant.initialized)
+	{
+		variant.shader->wait();
+		const ProgramReflection& reflection = variant.shader->reflection;
+		//a mirror that drifted from the shader would feed it garbage without any gl error.
+		util::checkBlockLayout(reflection, frameUniformBinding, "FrameData", sizeof(FrameUniforms), {
+			{ "view", offsetof(FrameUniforms, view) },
+			{ "projection", offsetof(FrameUniforms, projection) },
+			{ "cameraPosition", offsetof(FrameUniforms, cameraPosition) } });
+		util::checkBlockLayout(reflection, lightUniformBinding, "LightData", maxLights * sizeof(LightUniform), {
+			{ "lights[0].position", offsetof(LightUniform, position) },
+			{ "lights[0].color", offsetof(LightUniform, color) },
+			{ "lights[0].strength", offsetof(LightUniform, strength) },
+			{ "lights[1].position", sizeof(LightUniform) + offsetof(LightUniform, position) } });
+
+		//samplers are bound to their units in the shader, texture array i to unit i.
+		variant.model = modelLocation;
+		variant.material.bindless = bindless;
+		variant.material.materialIndex = materialIndexLocation;
+		variant.material.diffuse = diffuseColorLocation;
+		variant.material.arrayIndex = textureArrayLocation;
+		variant.material.layer = textureLayerLocation;
+		variant.material.uvTransform = uvTransformLocation;
+		variant.material.atlasRegion = atlasRegionLocation;
+		variant.virtualTexture.enabled = virtualTexturedLocation;
+		variant.virtualTexture.size = virtualSizeLocation;
+		variant.virtualTexture.levelCount = virtualLevelCountLocation;
+		variant.virtualTexture.levelFirstPage = virtualLevelFirstPageLocation;
+		variant.dequantize.positionOffset = positionOffsetLocation;
+		variant.dequantize.positionScale = positionScaleLocation;
+		variant.dequantize.texCoordOffset = texCoordOffsetLocation;
+		variant.dequantize.texCoordScale = texCoordScaleLocation;
+		variant.initialized = true;
+	}
+
 	glUseProgram(shader); //setup shader program.
-	cardboardMaterial->use();
-	//binds to texture unit declared above with loaded texture.
-	glBindVertexArray(cubeModel->VAO);
-	glDrawArrays(GL_TRIANGLES, 0, cubeModel->vertexCount);
+	this->variant = &variant;
+}
+
+unsigned int Engine::selectLod(ObjectMesh* mesh, const glm::mat4& modelTransform, glm::vec3 cameraPosition, unsigned int currentLod)
+{
+	//world space bounding sphere, largest axis scale so scaled meshes stay conservative.
+	float scale = std::max(glm::length(glm::vec3(modelTransform[0])),
+		std::max(glm::length(glm::vec3(modelTransform[1])), glm::length(glm::vec3(modelTransform[2]))));
+	glm::vec3 center = glm::vec3(modelTransform * glm::vec4(0.5f * (mesh->boundsMin + mesh->boundsMax), 1.0f));
+	float radius = scale * 0.5f * glm::length(mesh->boundsMax - mesh->boundsMin);
+	float distance = std::max(glm::length(center - cameraPosition) - radius, 0.1f);
+
+	//projection[1][1] is 1 / tan(fov / 2), so this turns world size at distance into pixels.
+	float pixelsPerUnit = projectionTransform[1][1] * 0.5f * screenHeight / distance;
+	auto pixelError = [&](unsigned int lod) { return mesh->lods[lod].error * scale * pixelsPerUnit; };
+
+	unsigned int lod = std::min(currentLod, (unsigned int)mesh->lods.size() - 1);
+	while (lod > 0 && pixelError(lod) > lodPixelError)
+		--lod;
+	//only coarsen once comfortably under the limit, otherwise objects near the cutoff pop every frame.
+	const float hysteresis = 0.75f;
+	while (lod + 1 < mesh->lods.size() && pixelError(lod + 1) <= lodPixelError * hysteresis)
+		++lod;
+	return lod;
+}
+
+void Engine::queueMesh(ObjectMesh* mesh, const std::vector<std::shared_ptr<Material>>& meshMaterials, const glm::mat4& modelTransform,
+	const glm::mat4& viewTransform, glm::vec3 cameraPosition, unsigned int& lod)
+{
+	//culling happens in mesh space, the camera and frustum get moved there instead of every meshlet.
+	std::array<glm::vec4, 6> planes = util::frustumPlanes(projectionTransform * viewTransform * modelTransform);
+	glm::vec3 boundsCenter = 0.5f * (mesh->boundsMin + mesh->boundsMax);
+	if (!util::sphereInFrustum(planes, boundsCenter, 0.5f * glm::length(mesh->boundsMax - mesh->boundsMin)))
+		return;
+
+	lod = selectLod(mesh, modelTransform, cameraPosition, lod);
+
+	QueuedObject object;
+	object.mesh = mesh;
+	object.modelTransform = modelTransform;
+	object.planes = planes;
+	object.localCamera = glm::vec3(glm::inverse(modelTransform) * glm::vec4(cameraPosition, 1.0f));
+	object.lod = lod;
+	queuedObjects.push_back(object);
+
+	ShaderVariant& objectVariant = requestVariant(mesh->layout, false);
+	size_t materialCount = mesh->materials.size();
+	for (size_t m = 0; m < materialCount; ++m)
+	{
+		unsigned int submesh = (unsigned int)(lod * materialCount + m);
+		if (mesh->submeshes[submesh].indexCount > 0)
+			queuedDraws.push_back({ &objectVariant, meshMaterials[m].get(), (unsigned int)queuedObjects.size() - 1, submesh });
+	}
+}
+
+void Engine::drawQueue()
+{
+	//variant first, then material and mesh so programs, vertex arrays and layouts switch as rarely as possible.
+	std::sort(queuedDraws.begin(), queuedDraws.end(), [&](const SubmeshDraw& a, const SubmeshDraw& b)
+	{
+		if (a.variant != b.variant)
+			return a.variant < b.variant;
+		if (a.material != b.material)
+			return a.material < b.material;
+		if (queuedObjects[a.object].mesh != queuedObjects[b.object].mesh)
+			return queuedObjects[a.object].mesh < queuedObjects[b.object].mesh;
+		return a.object < b.object;
+	});
+
+	ShaderVariant* boundVariant = nullptr;
+	Material* boundMaterial = nullptr;
+	ObjectMesh* boundMesh = nullptr;
+	unsigned int boundObject = std::numeric_limits<unsigned int>::max();
+	for (const SubmeshDraw& draw : queuedDraws)
+	{
+		const QueuedObject& object = queuedObjects[draw.object];
+		ObjectMesh* mesh = object.mesh;
+		//uniforms are per program, everything gets set again on a new one.
+		if (draw.variant != boundVariant)
+		{
+			useVariant(*draw.variant);
+			boundVariant = draw.variant;
+			boundMaterial = nullptr;
+			boundMesh = nullptr;
+			boundObject = std::numeric_limits<unsigned int>::max();
+		}
+		if (draw.material != boundMaterial)
+		{
+			draw.material->use(variant->material, residency->frame);
+			boundMaterial = draw.material;
+		}
+		if (mesh != boundMesh)
+		{
+			glBindVertexArray(mesh->VAO);
+			setVertexLayout(mesh->layout);
+			boundMesh = mesh;
+		}
+		if (draw.object != boundObject)
+		{
+			glUniformMatrix4fv(variant->model, 1, GL_FALSE, glm::value_ptr(object.modelTransform));
+			boundObject = draw.object;
+		}
+
+		const MeshSubmesh& submesh = mesh->submeshes[draw.submesh];
+		size_t indexSize = mesh->indexType == GL_UNSIGNED_SHORT ? sizeof(unsigned short) : sizeof(unsigned int);
+		if (object.lod > 0 || submesh.meshletCount == 0)
+		{
+			glDrawElements(GL_TRIANGLES, submesh.indexCount, mesh->indexType, reinterpret_cast<const void*>(submesh.indexOffset * indexSize));
+			continue;
+		}
+
+		drawCounts.clear();
+		drawOffsets.clear();
+		for (uint32_t i = submesh.meshletOffset; i < submesh.meshletOffset + submesh.meshletCount; ++i)
+		{
+			const Meshlet& meshlet = mesh->meshlets[i];
+			if (!util::sphereInFrustum(object.planes, glm::make_vec3(meshlet.sphere), meshlet.sphere[3])
+				|| util::meshletBackfacing(meshlet, object.localCamera))
+				continue;
+
+			//neighbouring meshlets are neighbours in the index buffer too, merge them into one range.
+			const void* offset = reinterpret_cast<const void*>(meshlet.indexOffset * indexSize);
+			if (!drawCounts.empty()
+				&& reinterpret_cast<size_t>(drawOffsets.back()) + drawCounts.back() * indexSize == meshlet.indexOffset * indexSize)
+				drawCounts.back() += meshlet.indexCount;
+			else
+			{
+				drawCounts.push_back(meshlet.indexCount);
+				drawOffsets.push_back(offset);
+			}
+		}
+
+		if (!drawCounts.empty())
+			glMultiDrawElements(GL_TRIANGLES, drawCounts.data(), mesh->indexType, drawOffsets.data(), (int)drawCounts.size());
+	}
+
+	queuedObjects.clear();
+	queuedDraws.clear();
 }
@@ -5,25 +5,173 @@
 #include "rectangleModel.h"
 #include "objectMesh.h"
 #include "material.h"
+#include "textureArrays.h"
+#include "bindlessMaterials.h"
+#include "textureResidency.h"
+#include "resources.h"
+#include "clusterStreamer.h"
+#include "virtualTexture.h"
+#include "uploadRing.h"
+#include "gltfModel.h"
 
-struct LightLocation
+//lights the shader can take, more in the scene are ignored.
+const unsigned int maxLights = 8;
+//constant_id of LIGHT_COUNT in the SPIR-V fragment modules.
+const unsigned int lightCountConstant = 0;
+
+//uniform buffer bindings of the FrameData and LightData blocks.
+const unsigned int frameUniformBinding = 0;
+const unsigned int lightUniformBinding = 1;
+
+//layout (location) of the uniforms in vertex.txt and fragment.txt. SPIR-V programs don't have to
+//keep uniform names, so the engine never looks them up. virtualLevelFirstPage takes 16 in a row.
+const unsigned int modelLocation = 0;
+const unsigned int positionOffsetLocation = 1;
+const unsigned int positionScaleLocation = 2;
+const unsigned int texCoordOffsetLocation = 3;
+const unsigned int texCoordScaleLocation = 4;
+const unsigned int materialIndexLocation = 5;
+const unsigned int textureArrayLocation = 6;
+const unsigned int textureLayerLocation = 7;
+const unsigned int uvTransformLocation = 8;
+const unsigned int atlasRegionLocation = 9;
+const unsigned int diffuseColorLocation = 10;
+const unsigned int virtualTexturedLocation = 11;
+const unsigned int virtualSizeLocation = 12;
+const unsigned int virtualLevelCountLocation = 13;
+const unsigned int virtualLevelFirstPageLocation = 14;
+
+//FrameData in the shaders, std140.
+struct FrameUniforms
+{
+	glm::mat4 view, projection;
+	glm::vec3 cameraPosition;
+	float padding;
+};
+
+//PointLight in the shaders, std140 puts every vec3 on 16 bytes.
+struct LightUniform
+{
+	glm::vec3 position;
+	float padding;
+	glm::vec3 color;
+	float strength;
+};
+
+//vertex shader uniforms that undo the mesh vertex quantization.
+struct DequantizeLocation
+{
+	unsigned int positionOffset, positionScale, texCoordOffset, texCoordScale;
+};
+
+//one specialization of the main shader and where its uniforms are, every variant has its own.
+struct ShaderVariant
+{
+	std::shared_ptr<Shader> shader;
+	//false until the program was first needed, waited for and had its block layouts checked.
+	bool initialized;
+	DequantizeLocation dequantize;
+	MaterialLocation material;
+	VirtualTextureLocation virtualTexture;
+	unsigned int model;
+};
+
+//an object that passed frustum culling this frame, with what drawing its submeshes needs.
+struct QueuedObject
+{
+	ObjectMesh* mesh;
+	glm::mat4 modelTransform;
+	//mesh space, for meshlet culling.
+	std::array<glm::vec4, 6> planes;
+	glm::vec3 localCamera;
+	unsigned int lod;
+};
+
+//one submesh of a queued object, the queue is sorted by material so each is bound once a frame.
+struct SubmeshDraw
 {
-	std::array<unsigned int,8> colorLoc, positionLoc, strengthLoc;
+	ShaderVariant* variant;
+	Material* material;
+	unsigned int object, submesh;
 };
 
 class Engine
 {
 public:
-	Engine(int width, int height);
+	//textureBudget is the memory the material textures may take, in bytes. the variants for the
+	//scene's lights start compiling before anything loads.
+	Engine(int width, int height, size_t textureBudget, Scene* scene);
 	~Engine();
 
 	void createMaterials();
 	void createModels();
 	void render(Scene* scene);
+	//places the instances of the loaded glb in the scene.
+	void populateScene(Scene* scene);
+	//queues the submeshes of the lod with acceptable screen space error, materials are engine
+	//materials indexed like mesh->materials. lod is the object's pick from last frame.
+	void queueMesh(ObjectMesh* mesh, const std::vector<std::shared_ptr<Material>>& meshMaterials, const glm::mat4& modelTransform,
+		const glm::mat4& viewTransform, glm::vec3 cameraPosition, unsigned int& lod);
+	//draws and clears the queue sorted by variant and material, at full detail culling meshlets outside
+	//the frustum or facing away from the camera.
+	void drawQueue();
+	//one engine material per mesh material, meshes sharing a texture and color share the material.
+	std::vector<std::shared_ptr<Material>> createMeshMaterials(const ObjectMesh* mesh);
+	//makes the textures of every material resident for the bindless path, or copies them into
+	//textureArrays without it, and tells each material where its texture is.
+	void buildMaterialTextures();
+	//the variant for this frame's lights and the layout, compiling it in the background if it's new.
+	ShaderVariant& requestVariant(const VertexLayout& layout, bool virtualTexture);
+	//waits for the variant if it isn't ready and makes it current. material uniforms belong to the
+	//program, use materials again after switching.
+	void useVariant(ShaderVariant& variant);
+	unsigned int selectLod(ObjectMesh* mesh, const glm::mat4& modelTransform, glm::vec3 cameraPosition, unsigned int currentLod);
+	void setVertexLayout(const VertexLayout& layout);
 
-	unsigned int shader;
-	Material* cardboardMaterial;	 
-	ObjectMesh* cubeModel;
-	LightLocation lights;
-	unsigned int cameraPosLoc;
+	//declared first so it's still around while the handles below get released.
+	Resources resources;
+	//defines every variant starts with, the bindless ones.
+	std::string baseDefines;
+	//by util::variantId, compiled on demand and kept for the engine's lifetime.
+	std::unordered_map<uint32_t, ShaderVariant> variants;
+	//what useVariant last made current.
+	ShaderVariant* variant;
+	//lights of the scene being rendered, up to maxLights.
+	unsigned int lightCount;
+	//FrameData with LightData after it at lightUniformOffset, written once a frame. frameUniformData
+	//is what gets written, kept around to avoid reallocating.
+	unsigned int frameUniformBuffer;
+	size_t lightUniformOffset;
+	std::vector<unsigned char> frameUniformData;
+	//white and untextured, for meshes without materials of their own.
+	std::shared_ptr<Material> defaultMaterial;
+	//every material buildMaterialTextures placed, the default one first.
+	std::vector<Material*> materials;
+	std::shared_ptr<ObjectMesh> cubeModel;
+	std::vector<std::shared_ptr<Material>> cubeMaterials;
+	//ARB_bindless_texture is available, materials are drawn through bindlessMaterials then.
+	bool bindless;
+	BindlessMaterials bindlessMaterials;
+	//every material texture without bindless, bound once a frame.
+	TextureArrays textureArrays;
+	//shrinks and regrows the material textures to stay under the texture budget.
+	TextureResidency* residency;
+	//staging memory the streamers below read their pages into, submitted once a frame.
+	UploadRing* uploads;
+	//out of core mesh built with --build-clusters, nullptr when there's no cluster file.
+	ClusterStreamer* terrain;
+	//textures/terrain.vtex built with --build-virtual-texture, nullptr when there's no terrain or no file.
+	VirtualTexture* terrainTexture;
+	//models/scene.glb, nullptr when there is none.
+	GltfModel* sceneModel;
+	glm::mat4 projectionTransform;
+	int screenHeight;
+	//how many pixels a lod may be off before a finer one is drawn.
+	float lodPixelError;
+	//visible meshlet ranges for glMultiDrawElements, kept around to avoid reallocating every frame.
+	std::vector<int> drawCounts;
+	std::vector<const void*> drawOffsets;
+	//this frame's objects and their submeshes, kept around like the ranges above.
+	std::vector<QueuedObject> queuedObjects;
+	std::vector<SubmeshDraw> queuedDraws;
 };
\ No newline at end of file
@@ -0,0 +1,735 @@
+#include "gltfLoader.h"
+
+namespace
+{
+	const uint32_t glbMagic = 0x46546C67;
+	const uint32_t glbChunkJson = 0x4E4F534A;
+	const uint32_t glbChunkBinary = 0x004E4942;
+
+	//just enough json for gltf, objects keep their keys in file order.
+	struct JsonValue
+	{
+		enum Type { NONE, BOOLEAN, NUMBER, STRING, ARRAY, OBJECT };
+
+		Type type = NONE;
+		bool boolean = false;
+		double number = 0.0;
+		std::string string;
+		std::vector<JsonValue> array;
+		std::vector<std::pair<std::string, JsonValue>> object;
+
+		//missing keys and indices give a NONE value, so lookups can be chained.
+		const JsonValue& operator[](const char* key) const
+		{
+			static const JsonValue none;
+			for (const auto& member : object)
+				if (member.first == key)
+					return member.second;
+			return none;
+		}
+
+		const JsonValue& operator[](size_t index) const
+		{
+			static const JsonValue none;
+			return index < array.size() ? array[index] : none;
+		}
+
+		const JsonValue& operator[](int index) const
+		{
+			return (*this)[size_t(index)];
+		}
+
+		size_t size() const
+		{
+			return array.size();
+		}
+
+		int asInt(int fallback) const
+		{
+			return type == NUMBER ? int(number) : fallback;
+		}
+
+		float asFloat(float fallback) const
+		{
+			return type == NUMBER ? float(number) : fallback;
+		}
+	};
+
+	class JsonParser
+	{
+	public:
+		JsonParser(const char* cursor, const char* end) : cursor(cursor), end(end), failed(false) {}
+
+		bool parse(JsonValue& value)
+		{
+			parseValue(value, 0);
+			skipSpaces();
+			return !failed && cursor == end;
+		}
+
+	private:
+		void skipSpaces()
+		{
+			while (cursor < end && (*cursor == ' ' || *cursor == '\t' || *cursor == '\n' || *cursor == '\r'))
+				++cursor;
+		}
+
+		bool consume(char expected)
+		{
+			skipSpaces();
+			if (cursor < end && *cursor == expected)
+			{
+				++cursor;
+				return true;
+			}
+			return false;
+		}
+
+		bool consumeWord(const char* word)
+		{
+			size_t length = strlen(word);
+			if (size_t(end - cursor) < length || memcmp(cursor, word, length) != 0)
+				return false;
+			cursor += length;
+			return true;
+		}
+
+		void appendUtf8(std::string& out, uint32_t codepoint)
+		{
+			if (codepoint < 0x80)
+				out += char(codepoint);
+			else if (codepoint < 0x800)
+			{
+				out += char(0xC0 | (codepoint >> 6));
+				out += char(0x80 | (codepoint & 0x3F));
+			}
+			else
+			{
+				out += char(0xE0 | (codepoint >> 12));
+				out += char(0x80 | ((codepoint >> 6) & 0x3F));
+				out += char(0x80 | (codepoint & 0x3F));
+			}
+		}
+
+		void parseString(std::string& out)
+		{
+			if (!consume('"'))
+			{
+				failed = true;
+				return;
+			}
+
+			while (cursor < end && *cursor != '"')
+			{
+				if (*cursor != '\\')
+				{
+					out += *cursor++;
+					continue;
+				}
+
+				if (++cursor >= end)
+					break;
+				char escape = *cursor++;
+				switch (escape)
+				{
+				case 'b': out += '\b'; break;
+				case 'f': out += '\f'; break;
+				case 'n': out += '\n'; break;
+				case 'r': out += '\r'; break;
+				case 't': out += '\t'; break;
+				case 'u':
+				{
+					uint32_t codepoint = 0;
+					for (int i = 0; i < 4 && cursor < end; ++i, ++cursor)
+					{
+						char digit = *cursor;
+						codepoint = codepoint * 16 + (digit >= 'a' ? digit - 'a' + 10 : digit >= 'A' ? digit - 'A' + 10 : digit - '0');
+					}
+					appendUtf8(out, codepoint);
+					break;
+				}
+				default: out += escape; break;
+				}
+			}
+
+			if (cursor >= end)
+				failed = true;
+			else
+				++cursor;
+		}
+
+		void parseValue(JsonValue& value, int depth)
+		{
+			skipSpaces();
+			if (cursor >= end || depth > 64)
+			{
+				failed = true;
+				return;
+			}
+
+			if (*cursor == '{')
+			{
+				++cursor;
+				value.type = JsonValue::OBJECT;
+				if (consume('}'))
+					return;
+				do
+				{
+					value.object.emplace_back();
+					parseString(value.object.back().first);
+					if (!consume(':'))
+					{
+						failed = true;
+						return;
+					}
+					parseValue(value.object.back().second, depth + 1);
+				} while (!failed && consume(','));
+				if (!consume('}'))
+					failed = true;
+			}
+			else if (*cursor == '[')
+			{
+				++cursor;
+				value.type = JsonValue::ARRAY;
+				if (consume(']'))
+					return;
+				do
+				{
+					value.array.emplace_back();
+					parseValue(value.array.back(), depth + 1);
+				} while (!failed && consume(','));
+				if (!consume(']'))
+					failed = true;
+			}
+			else if (*cursor == '"')
+			{
+				value.type = JsonValue::STRING;
+				parseString(value.string);
+			}
+			else if (consumeWord("true") || consumeWord("false"))
+			{
+				value.type = JsonValue::BOOLEAN;
+				value.boolean = cursor[-1] == 'e' && cursor[-2] == 'u';
+			}
+			else if (consumeWord("null"))
+				value.type = JsonValue::NONE;
+			else
+			{
+				//the json chunk isn't null terminated, so copy the number out for strtod.
+				const char* start = cursor;
+				while (cursor < end && (strchr("+-.eE", *cursor) || (*cursor >= '0' && *cursor <= '9')))
+					++cursor;
+				if (cursor == start)
+				{
+					failed = true;
+					return;
+				}
+				value.type = JsonValue::NUMBER;
+				value.number = strtod(std::string(start, cursor).c_str(), nullptr);
+			}
+		}
+
+		const char* cursor;
+		const char* end;
+		bool failed;
+	};
+
+	uint32_t componentCount(const std::string& type)
+	{
+		if (type == "SCALAR")
+			return 1;
+		if (type == "VEC2")
+			return 2;
+		if (type == "VEC3")
+			return 3;
+		if (type == "VEC4" || type == "MAT2")
+			return 4;
+		if (type == "MAT3")
+			return 9;
+		if (type == "MAT4")
+			return 16;
+		return 0;
+	}
+
+	uint32_t componentSize(uint32_t componentType)
+	{
+		switch (componentType)
+		{
+		case GL_BYTE:
+		case GL_UNSIGNED_BYTE:
+			return 1;
+		case GL_SHORT:
+		case GL_UNSIGNED_SHORT:
+			return 2;
+		default:
+			return 4;
+		}
+	}
+
+	float readComponent(const unsigned char* data, uint32_t componentType, bool normalized)
+	{
+		switch (componentType)
+		{
+		case GL_BYTE:
+		{
+			int8_t value = int8_t(*data);
+			return normalized ? std::max(value / 127.0f, -1.0f) : float(value);
+		}
+		case GL_UNSIGNED_BYTE:
+			return normalized ? *data / 255.0f : float(*data);
+		case GL_SHORT:
+		{
+			int16_t value;
+			memcpy(&value, data, sizeof(value));
+			return normalized ? std::max(value / 32767.0f, -1.0f) : float(value);
+		}
+		case GL_UNSIGNED_SHORT:
+		{
+			uint16_t value;
+			memcpy(&value, data, sizeof(value));
+			return normalized ? value / 65535.0f : float(value);
+		}
+		case GL_UNSIGNED_INT:
+		{
+			uint32_t value;
+			memcpy(&value, data, sizeof(value));
+			return float(value);
+		}
+		default:
+		{
+			float value;
+			memcpy(&value, data, sizeof(value));
+			return value;
+		}
+		}
+	}
+
+	uint32_t readIndex(const unsigned char* data, uint32_t componentType, size_t index)
+	{
+		switch (componentType)
+		{
+		case GL_UNSIGNED_BYTE:
+			return data[index];
+		case GL_UNSIGNED_SHORT:
+		{
+			uint16_t value;
+			memcpy(&value, data + 2 * index, sizeof(value));
+			return value;
+		}
+		default:
+		{
+			uint32_t value;
+			memcpy(&value, data + 4 * index, sizeof(value));
+			return value;
+		}
+		}
+	}
+
+	//every element as floats with the sparse substitutions applied.
+	std::vector<float> readAccessor(const GltfAccessor& accessor)
+	{
+		std::vector<float> values(size_t(accessor.count) * accessor.components, 0.0f);
+		uint32_t size = componentSize(accessor.componentType);
+
+		if (accessor.data)
+			for (uint32_t i = 0; i < accessor.count; ++i)
+				for (uint32_t c = 0; c < accessor.components; ++c)
+					values[size_t(i) * accessor.components + c] =
+						readComponent(accessor.data + i * accessor.stride + c * size, accessor.componentType, accessor.normalized != 0);
+
+		for (uint32_t k = 0; k < accessor.sparseCount; ++k)
+		{
+			uint32_t element = readIndex(accessor.sparseIndices, accessor.sparseIndexType, k);
+			if (element >= accessor.count)
+				continue;
+			for (uint32_t c = 0; c < accessor.components; ++c)
+				values[size_t(element) * accessor.components + c] = readComponent(
+					accessor.sparseValues + (size_t(k) * accessor.components + c) * size, accessor.componentType, accessor.normalized != 0);
+		}
+
+		return values;
+	}
+
+	//indices stay integers, 32 bit ones don't survive a trip through float.
+	std::vector<unsigned int> readIndices(const GltfAccessor& accessor, uint32_t vertexCount)
+	{
+		std::vector<unsigned int> indices(accessor.count, 0);
+		if (accessor.data)
+			for (uint32_t i = 0; i < accessor.count; ++i)
+				indices[i] = readIndex(accessor.data + i * accessor.stride, accessor.componentType, 0);
+		for (uint32_t k = 0; k < accessor.sparseCount; ++k)
+		{
+			uint32_t element = readIndex(accessor.sparseIndices, accessor.sparseIndexType, k);
+			if (element < accessor.count)
+				indices[element] = readIndex(accessor.sparseValues, accessor.componentType, k);
+		}
+
+		//out of range indices would read past the vertex buffer on the gpu.
+		for (unsigned int& index : indices)
+			index = std::min(index, vertexCount - 1);
+		return indices;
+	}
+
+	class GltfReader
+	{
+	public:
+		GltfReader(const JsonValue& root, GltfAsset& asset, const char* filename) : root(root), asset(asset), filename(filename) {}
+
+		//resolves a view relative range, false if it doesn't fit in the view.
+		bool viewRange(int view, size_t offset, size_t bytes, const unsigned char*& data)
+		{
+			if (view < 0 || size_t(view) >= asset.bufferViews.size() || offset + bytes > asset.bufferViews[view].size)
+				return false;
+			data = asset.bufferViews[view].data + offset;
+			return true;
+		}
+
+		bool readAccessor(int index, GltfAccessor& accessor)
+		{
+			accessor = GltfAccessor{};
+			accessor.bufferView = -1;
+			const JsonValue& json = root["accessors"][size_t(index)];
+			if (json.type != JsonValue::OBJECT)
+				return false;
+
+			accessor.count = uint32_t(json["count"].asInt(0));
+			accessor.components = componentCount(json["type"].string);
+			accessor.componentType = uint32_t(json["componentType"].asInt(GL_FLOAT));
+			accessor.normalized = json["normalized"].boolean;
+			uint32_t elementSize = accessor.components * componentSize(accessor.componentType);
+
+			const JsonValue& viewIndex = json["bufferView"];
+			if (viewIndex.type == JsonValue::NUMBER)
+			{
+				accessor.bufferView = viewIndex.asInt(-1);
+				accessor.byteOffset = size_t(json["byteOffset"].asInt(0));
+				accessor.stride = size_t(root["bufferViews"][size_t(accessor.bufferView)]["byteStride"].asInt(0));
+				if (accessor.stride == 0)
+					accessor.stride = elementSize;
+				size_t bytes = accessor.count == 0 ? 0 : (accessor.count - 1) * accessor.stride + elementSize;
+				if (!viewRange(accessor.bufferView, accessor.byteOffset, bytes, accessor.data))
+				{
+					std::cout << "Glb " << filename << " accessor " << index << " reads past its buffer view\n";
+					return false;
+				}
+			}
+			else
+				accessor.stride = elementSize;
+
+			const JsonValue& sparse = json["sparse"];
+			if (sparse.type == JsonValue::OBJECT)
+			{
+				accessor.sparseCount = uint32_t(sparse["count"].asInt(0));
+				accessor.sparseIndexType = uint32_t(sparse["indices"]["componentType"].asInt(GL_UNSIGNED_INT));
+				size_t indexBytes = size_t(accessor.sparseCount) * componentSize(accessor.sparseIndexType);
+				size_t valueBytes = size_t(accessor.sparseCount) * elementSize;
+				if (!viewRange(sparse["indices"]["bufferView"].asInt(-1), size_t(sparse["indices"]["byteOffset"].asInt(0)), indexBytes, accessor.sparseIndices)
+					|| !viewRange(sparse["values"]["bufferView"].asInt(-1), size_t(sparse["values"]["byteOffset"].asInt(0)), valueBytes, accessor.sparseValues))
+				{
+					std::cout << "Glb " << filename << " sparse accessor " << index << " reads past its buffer view\n";
+					return false;
+				}
+			}
+
+			return true;
+		}
+
+		bool readMeshes()
+		{
+			static const char* attributeNames[3] = { "POSITION", "TEXCOORD_0", "NORMAL" };
+
+			const JsonValue& meshes = root["meshes"];
+			asset.meshes.resize(meshes.size());
+			for (size_t m = 0; m < meshes.size(); ++m)
+			{
+				const JsonValue& primitives = meshes[m]["primitives"];
+				for (size_t p = 0; p < primitives.size(); ++p)
+				{
+					const JsonValue& json = primitives[p];
+					GltfPrimitive primitive{};
+					primitive.mode = uint32_t(json["mode"].asInt(GL_TRIANGLES));
+					primitive.material = json["material"].asInt(-1);
+
+					for (int i = 0; i < 3; ++i)
+					{
+						const JsonValue& attribute = json["attributes"][attributeNames[i]];
+						if (attribute.type == JsonValue::NUMBER && !readAccessor(attribute.asInt(-1), primitive.attributes[i]))
+							return false;
+					}
+					if (json["indices"].type == JsonValue::NUMBER && !readAccessor(json["indices"].asInt(-1), primitive.indices))
+						return false;
+
+					if (primitive.attributes[0].count == 0)
+					{
+						std::cout << "Glb " << filename << " mesh " << m << " has a primitive without positions, skipped\n";
+						continue;
+					}
+
+					//gltf requires position min and max, so bounds come for free.
+					const JsonValue& accessor = root["accessors"][size_t(json["attributes"]["POSITION"].asInt(-1))];
+					for (int axis = 0; axis < 3; ++axis)
+					{
+						primitive.boundsMin[axis] = accessor["min"][axis].asFloat(-std::numeric_limits<float>::max());
+						primitive.boundsMax[axis] = accessor["max"][axis].asFloat(std::numeric_limits<float>::max());
+					}
+					asset.meshes[m].primitives.push_back(primitive);
+				}
+			}
+			return true;
+		}
+
+		glm::mat4 localTransform(const JsonValue& node)
+		{
+			const JsonValue& matrix = node["matrix"];
+			if (matrix.size() == 16)
+			{
+				float values[16];
+				for (size_t i = 0; i < 16; ++i)
+					values[i] = matrix[i].asFloat(0.0f);
+				return glm::make_mat4(values);
+			}
+
+			const JsonValue& t = node["translation"];
+			const JsonValue& r = node["rotation"];
+			const JsonValue& s = node["scale"];
+			glm::vec3 translation(t[0].asFloat(0.0f), t[1].asFloat(0.0f), t[2].asFloat(0.0f));
+			glm::quat rotation(r[3].asFloat(1.0f), r[0].asFloat(0.0f), r[1].asFloat(0.0f), r[2].asFloat(0.0f));
+			glm::vec3 scale(s[0].asFloat(1.0f), s[1].asFloat(1.0f), s[2].asFloat(1.0f));
+			return glm::translate(glm::mat4(1.0f), translation) * glm::mat4_cast(rotation) * glm::scale(glm::mat4(1.0f), scale);
+		}
+
+		void readNode(int index, const glm::mat4& parent, size_t depth)
+		{
+			const JsonValue& node = root["nodes"][size_t(index)];
+			//a valid gltf is a forest, the depth check only stops malformed cycles.
+			if (node.type != JsonValue::OBJECT || depth > root["nodes"].size())
+				return;
+
+			glm::mat4 transform = parent * localTransform(node);
+			int mesh = node["mesh"].asInt(-1);
+			if (mesh >= 0 && size_t(mesh) < asset.meshes.size())
+				asset.instances.push_back({ uint32_t(mesh), transform });
+
+			const JsonValue& children = node["children"];
+			for (size_t i = 0; i < children.size(); ++i)
+				readNode(children[i].asInt(-1), transform, depth + 1);
+		}
+
+		void readScene()
+		{
+			//gltf is y up, the engine is z up.
+			glm::mat4 zUp = glm::rotate(glm::mat4(1.0f), glm::radians(90.0f), glm::vec3(1.0f, 0.0f, 0.0f));
+
+			const JsonValue& scene = root["scenes"][size_t(root["scene"].asInt(0))];
+			if (scene.type == JsonValue::OBJECT)
+			{
+				const JsonValue& nodes = scene["nodes"];
+				for (size_t i = 0; i < nodes.size(); ++i)
+					readNode(nodes[i].asInt(-1), zUp, 0);
+				return;
+			}
+
+			//no scene, every mesh gets drawn once at the origin.
+			for (size_t m = 0; m < asset.meshes.size(); ++m)
+				asset.instances.push_back({ uint32_t(m), zUp });
+		}
+
+	private:
+		const JsonValue& root;
+		GltfAsset& asset;
+		const char* filename;
+	};
+}
+
+bool util::gltfLoadFromFile(const char* filename, GltfAsset& asset)
+{
+	asset = GltfAsset();
+	asset.file = mapFile(filename);
+	const unsigned char* data = asset.file.data;
+	size_t size = asset.file.size;
+	if (!data)
+	{
+		std::cout << "Failed to open glb " << filename << '\n';
+		return false;
+	}
+
+	//12 byte header, then a json chunk and an optional binary chunk.
+	uint32_t header[3] = {};
+	if (size >= 20)
+		memcpy(header, data, sizeof(header));
+	if (header[0] != glbMagic || header[1] != 2)
+	{
+		std::cout << filename << " is not a gltf 2.0 glb\n";
+		gltfRelease(asset);
+		return false;
+	}
+
+	const char* json = nullptr;
+	size_t jsonSize = 0;
+	const unsigned char* binary = nullptr;
+	size_t binarySize = 0;
+	for (size_t offset = 12; offset + 8 <= size;)
+	{
+		uint32_t chunk[2];
+		memcpy(chunk, data + offset, sizeof(chunk));
+		if (offset + 8 + chunk[0] > size)
+			break;
+		if (chunk[1] == glbChunkJson && !json)
+		{
+			json = reinterpret_cast<const char*>(data + offset + 8);
+			jsonSize = chunk[0];
+		}
+		else if (chunk[1] == glbChunkBinary && !binary)
+		{
+			binary = data + offset + 8;
+			binarySize = chunk[0];
+		}
+		offset += 8 + ((chunk[0] + 3) & ~size_t(3));
+	}
+
+	JsonValue root;
+	if (!json || !JsonParser(json, json + jsonSize).parse(root))
+	{
+		std::cout << "Glb " << filename << " has no readable json chunk\n";
+		gltfRelease(asset);
+		return false;
+	}
+
+	//only the embedded buffer is mapped, a view into anything else stays empty.
+	const JsonValue& buffers = root["buffers"];
+	const JsonValue& views = root["bufferViews"];
+	for (size_t v = 0; v < views.size(); ++v)
+	{
+		GltfBufferView view = { nullptr, 0 };
+		size_t offset = size_t(views[v]["byteOffset"].asInt(0));
+		size_t length = size_t(views[v]["byteLength"].asInt(0));
+		int buffer = views[v]["buffer"].asInt(-1);
+		if (buffer == 0 && buffers[0]["uri"].type == JsonValue::NONE && binary && offset + length <= binarySize)
+			view = { binary + offset, length };
+		else
+			std::cout << "Glb " << filename << " buffer view " << v << " isn't in the binary chunk, external buffers aren't supported\n";
+		asset.bufferViews.push_back(view);
+	}
+
+	GltfReader reader(root, asset, filename);
+	if (!reader.readMeshes())
+	{
+		gltfRelease(asset);
+		return false;
+	}
+	reader.readScene();
+	return true;
+}
+
+void util::gltfRelease(GltfAsset& asset)
+{
+	unmapFile(asset.file);
+	asset = GltfAsset();
+}
+
+bool util::gltfDirectLayout(const GltfPrimitive& primitive)
+{
+	//normals are generated by the converter, texcoords may be missing.
+	if (primitive.attributes[2].count == 0)
+		return false;
+
+	for (const GltfAccessor& attribute : primitive.attributes)
+	{
+		if (attribute.count == 0)
+			continue;
+		if (!attribute.data || attribute.sparseCount > 0 || attribute.components > 4
+			|| reinterpret_cast<size_t>(attribute.data) % 4 != 0 || attribute.stride % 4 != 0 || attribute.stride > 2048)
+			return false;
+	}
+
+	const GltfAccessor& indices = primitive.indices;
+	if (indices.count == 0)
+		return true;
+	//byte indices work but are slow on most hardware.
+	return indices.data && indices.sparseCount == 0
+		&& (indices.componentType == GL_UNSIGNED_SHORT || indices.componentType == GL_UNSIGNED_INT)
+		&& reinterpret_cast<size_t>(indices.data) % componentSize(indices.componentType) == 0;
+}
+
+MeshData util::gltfConvertPrimitive(const GltfPrimitive& primitive)
+{
+	MeshData mesh;
+	mesh.layout = floatVertexLayout();
+	mesh.vertexCount = 0;
+	mesh.indexType = GL_UNSIGNED_SHORT;
+	mesh.boundsMin = mesh.boundsMax = glm::vec3(0.0f);
+
+	if (primitive.mode != GL_TRIANGLES && primitive.mode != GL_TRIANGLE_STRIP && primitive.mode != GL_TRIANGLE_FAN)
+	{
+		std::cout << "Glb primitive mode " << primitive.mode << " can't be converted, only triangles are\n";
+		return mesh;
+	}
+
+	uint32_t vertexCount = primitive.attributes[0].count;
+	std::vector<float> positions = readAccessor(primitive.attributes[0]);
+	std::vector<float> texCoords = readAccessor(primitive.attributes[1]);
+	std::vector<float> normals = readAccessor(primitive.attributes[2]);
+
+	std::vector<unsigned int> corners;
+	if (primitive.indices.count > 0)
+		corners = readIndices(primitive.indices, vertexCount);
+	else
+		for (uint32_t v = 0; v < vertexCount; ++v)
+			corners.push_back(v);
+
+	//odd strip triangles swap their first two corners to keep the winding, fans share corner 0.
+	if (primitive.mode == GL_TRIANGLES)
+		mesh.indices.assign(corners.begin(), corners.begin() + corners.size() / 3 * 3);
+	else
+		for (size_t i = 2; i < corners.size(); ++i)
+		{
+			unsigned int triangle[3] = { corners[i - 2], corners[i - 1], corners[i] };
+			if (primitive.mode == GL_TRIANGLE_FAN)
+				triangle[0] = corners[0];
+			else if (i % 2 == 1)
+				std::swap(triangle[0], triangle[1]);
+			mesh.indices.insert(mesh.indices.end(), triangle, triangle + 3);
+		}
+
+	//smooth normals weighted by triangle area when the asset has none.
+	bool hasNormals = primitive.attributes[2].count == vertexCount && primitive.attributes[2].components == 3;
+	if (!hasNormals)
+	{
+		normals.assign(3 * size_t(vertexCount), 0.0f);
+		for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3)
+		{
+			glm::vec3 a = glm::make_vec3(&positions[3 * mesh.indices[i]]);
+			glm::vec3 b = glm::make_vec3(&positions[3 * mesh.indices[i + 1]]);
+			glm::vec3 c = glm::make_vec3(&positions[3 * mesh.indices[i + 2]]);
+			glm::vec3 faceNormal = glm::cross(b - a, c - a);
+			for (int corner = 0; corner < 3; ++corner)
+				for (int axis = 0; axis < 3; ++axis)
+					normals[3 * mesh.indices[i + corner] + axis] += faceNormal[axis];
+		}
+	}
+
+	bool hasTexCoords = primitive.attributes[1].count == vertexCount && primitive.attributes[1].components == 2;
+	mesh.vertexCount = vertexCount;
+	mesh.vertices.resize(8 * size_t(vertexCount));
+	mesh.boundsMin = glm::vec3(std::numeric_limits<float>::max());
+	mesh.boundsMax = glm::vec3(-std::numeric_limits<float>::max());
+	for (uint32_t v = 0; v < vertexCount; ++v)
+	{
+		float* vertex = &mesh.vertices[8 * size_t(v)];
+		glm::vec3 position = glm::make_vec3(&positions[3 * size_t(v)]);
+		glm::vec3 normal = glm::make_vec3(&normals[3 * size_t(v)]);
+		normal = glm::dot(normal, normal) > 0.0f ? glm::normalize(normal) : glm::vec3(0.0f, 0.0f, 1.0f);
+
+		memcpy(vertex, glm::value_ptr(position), 3 * sizeof(float));
+		vertex[3] = hasTexCoords ? texCoords[2 * size_t(v)] : 0.0f;
+		vertex[4] = hasTexCoords ? texCoords[2 * size_t(v) + 1] : 0.0f;
+		memcpy(vertex + 5, glm::value_ptr(normal), 3 * sizeof(float));
+		mesh.boundsMin = glm::min(mesh.boundsMin, position);
+		mesh.boundsMax = glm::max(mesh.boundsMax, position);
+	}
+
+	if (vertexCount == 0)
+		mesh.boundsMin = mesh.boundsMax = glm::vec3(0.0f);
+	mesh.indexType = vertexCount <= 65536 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+	return mesh;
+}
@@ -0,0 +1,73 @@
+#pragma once
+#include "../config.h"
+#include "objectLoader.h"
+#include "mappedFile.h"
+
+//an accessor resolved down to bytes in the mapped file, component types are the gl enums.
+struct GltfAccessor
+{
+	//first element, nullptr when the accessor has no buffer view (all zero unless sparse).
+	const unsigned char* data;
+	//buffer view the elements live in and where inside it they start, -1 without one.
+	int bufferView;
+	size_t byteOffset, stride;
+	uint32_t count, components, componentType, normalized;
+	//sparse substitutions, only the converter applies them.
+	uint32_t sparseCount, sparseIndexType;
+	const unsigned char* sparseIndices;
+	const unsigned char* sparseValues;
+};
+
+struct GltfPrimitive
+{
+	//position, texcoord 0 and normal, same slots as the shader locations. count is 0 when missing.
+	GltfAccessor attributes[3];
+	//count is 0 for primitives drawn without indices.
+	GltfAccessor indices;
+	//the gltf modes are the gl primitive enums.
+	uint32_t mode;
+	int material;
+	glm::vec3 boundsMin, boundsMax;
+};
+
+struct GltfMeshPrimitives
+{
+	std::vector<GltfPrimitive> primitives;
+};
+
+//a node that draws a mesh, its transform multiplied down the hierarchy and turned z up.
+struct GltfInstance
+{
+	uint32_t mesh;
+	glm::mat4 transform;
+};
+
+struct GltfBufferView
+{
+	const unsigned char* data;
+	size_t size;
+};
+
+//a parsed glb, every pointer points into file.
+struct GltfAsset
+{
+	mappedFile file;
+	std::vector<GltfBufferView> bufferViews;
+	std::vector<GltfMeshPrimitives> meshes;
+	std::vector<GltfInstance> instances;
+};
+
+namespace util
+{
+	//maps the glb and resolves every accessor of the default scene, the data stays mapped until gltfRelease.
+	bool gltfLoadFromFile(const char* filename, GltfAsset& asset);
+
+	void gltfRelease(GltfAsset& asset);
+
+	//true when gl can fetch the primitive straight out of its buffer views.
+	bool gltfDirectLayout(const GltfPrimitive& primitive);
+
+	//fallback for everything else: sparse accessors, byte indices, missing normals, unaligned data.
+	//strips and fans become lists, the result has the float layout objLoadFromFile produces.
+	MeshData gltfConvertPrimitive(const GltfPrimitive& primitive);
+}
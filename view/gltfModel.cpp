@@ -0,0 +1,147 @@
+#include "gltfModel.h"
+#include "bakedMesh.h"
+#include "meshlet.h"
+
+namespace
+{
+	size_t alignOffset(size_t offset)
+	{
+		return (offset + 15) & ~size_t(15);
+	}
+}
+
+GltfModel::GltfModel(GltfModelCreateInfo* createInfo)
+{
+	viewBuffer = 0;
+	layout = util::floatVertexLayout();
+
+	GltfAsset asset;
+	if (!util::gltfLoadFromFile(createInfo->filename, asset))
+		return;
+	instances = asset.instances;
+
+	//buffer views used by primitives gl can read as they are get packed into one buffer.
+	std::vector<size_t> viewOffsets(asset.bufferViews.size(), SIZE_MAX);
+	size_t viewBytes = 0;
+	for (const GltfMeshPrimitives& mesh : asset.meshes)
+		for (const GltfPrimitive& primitive : mesh.primitives)
+		{
+			if (!util::gltfDirectLayout(primitive))
+				continue;
+			for (const GltfAccessor* accessor : { &primitive.attributes[0], &primitive.attributes[1], &primitive.attributes[2], &primitive.indices })
+				if (accessor->count > 0 && viewOffsets[accessor->bufferView] == SIZE_MAX)
+				{
+					viewOffsets[accessor->bufferView] = viewBytes;
+					viewBytes = alignOffset(viewBytes + asset.bufferViews[accessor->bufferView].size);
+				}
+		}
+
+	if (viewBytes > 0)
+	{
+		//straight from the mapping into the buffer, no per vertex work on the cpu.
+		glCreateBuffers(1, &viewBuffer);
+		glNamedBufferStorage(viewBuffer, viewBytes, nullptr, GL_DYNAMIC_STORAGE_BIT);
+		for (size_t view = 0; view < viewOffsets.size(); ++view)
+			if (viewOffsets[view] != SIZE_MAX)
+				glNamedBufferSubData(viewBuffer, viewOffsets[view], asset.bufferViews[view].size, asset.bufferViews[view].data);
+	}
+
+	size_t converted = 0;
+	meshes.resize(asset.meshes.size());
+	for (size_t m = 0; m < asset.meshes.size(); ++m)
+		for (const GltfPrimitive& primitive : asset.meshes[m].primitives)
+		{
+			GltfDraw draw{};
+			glCreateVertexArrays(1, &draw.VAO);
+			draw.boundsMin = primitive.boundsMin;
+			draw.boundsMax = primitive.boundsMax;
+
+			if (util::gltfDirectLayout(primitive))
+			{
+				//every attribute gets its own binding, so views can be interleaved or not and have any stride.
+				for (unsigned int i = 0; i < 3; ++i)
+				{
+					const GltfAccessor& attribute = primitive.attributes[i];
+					if (attribute.count == 0)
+						continue;
+					glVertexArrayVertexBuffer(draw.VAO, i, viewBuffer, viewOffsets[attribute.bufferView] + attribute.byteOffset, int(attribute.stride));
+					glEnableVertexArrayAttrib(draw.VAO, i);
+					glVertexArrayAttribFormat(draw.VAO, i, attribute.components, attribute.componentType, attribute.normalized, 0);
+					glVertexArrayAttribBinding(draw.VAO, i, i);
+				}
+
+				draw.mode = primitive.mode;
+				draw.indexed = primitive.indices.count > 0;
+				draw.count = draw.indexed ? primitive.indices.count : primitive.attributes[0].count;
+				if (draw.indexed)
+				{
+					glVertexArrayElementBuffer(draw.VAO, viewBuffer);
+					draw.indexType = primitive.indices.componentType;
+					draw.indexOffset = viewOffsets[primitive.indices.bufferView] + primitive.indices.byteOffset;
+				}
+			}
+			else
+			{
+				MeshData mesh = util::gltfConvertPrimitive(primitive);
+				std::vector<unsigned char> indices = util::packIndices(mesh);
+				++converted;
+
+				glCreateBuffers(1, &draw.VBO);
+				glCreateBuffers(1, &draw.EBO);
+				glNamedBufferStorage(draw.VBO, std::max<size_t>(mesh.vertices.size() * sizeof(float), 1), mesh.vertices.data(), 0);
+				glNamedBufferStorage(draw.EBO, std::max<size_t>(indices.size(), 1), indices.data(), 0);
+				glVertexArrayVertexBuffer(draw.VAO, 0, draw.VBO, 0, mesh.layout.stride);
+				glVertexArrayElementBuffer(draw.VAO, draw.EBO);
+				for (unsigned int i = 0; i < 3; ++i)
+				{
+					const VertexAttribute& attribute = mesh.layout.attributes[i];
+					glEnableVertexArrayAttrib(draw.VAO, i);
+					glVertexArrayAttribFormat(draw.VAO, i, attribute.components, attribute.type, attribute.normalized, attribute.offset);
+					glVertexArrayAttribBinding(draw.VAO, i, 0);
+				}
+
+				draw.mode = GL_TRIANGLES;
+				draw.indexed = true;
+				draw.count = (unsigned int)mesh.indices.size();
+				draw.indexType = mesh.indexType;
+				draw.indexOffset = 0;
+			}
+
+			meshes[m].push_back(draw);
+		}
+
+	std::cout << "Loaded " << createInfo->filename << ": " << asset.meshes.size() << " meshes, "
+		<< instances.size() << " instances, " << converted << " primitives converted\n";
+	util::gltfRelease(asset);
+}
+
+GltfModel::~GltfModel()
+{
+	for (std::vector<GltfDraw>& mesh : meshes)
+		for (GltfDraw& draw : mesh)
+		{
+			glDeleteVertexArrays(1, &draw.VAO);
+			glDeleteBuffers(1, &draw.VBO);
+			glDeleteBuffers(1, &draw.EBO);
+		}
+	glDeleteBuffers(1, &viewBuffer);
+}
+
+void GltfModel::draw(unsigned int mesh, const std::array<glm::vec4, 6>& planes)
+{
+	if (mesh >= meshes.size())
+		return;
+
+	for (const GltfDraw& draw : meshes[mesh])
+	{
+		glm::vec3 center = 0.5f * (draw.boundsMin + draw.boundsMax);
+		if (!util::sphereInFrustum(planes, center, 0.5f * glm::length(draw.boundsMax - draw.boundsMin)))
+			continue;
+
+		glBindVertexArray(draw.VAO);
+		if (draw.indexed)
+			glDrawElements(draw.mode, draw.count, draw.indexType, reinterpret_cast<const void*>(draw.indexOffset));
+		else
+			glDrawArrays(draw.mode, 0, draw.count);
+	}
+}
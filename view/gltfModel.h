@@ -0,0 +1,39 @@
+#pragma once
+#include "../config.h"
+#include "gltfLoader.h"
+
+struct GltfModelCreateInfo
+{
+	const char* filename;
+};
+
+//one primitive, drawn straight out of the shared view buffer or out of its own converted buffers.
+struct GltfDraw
+{
+	unsigned int VAO, mode, count, indexType;
+	//bytes into the element buffer, unused without indices.
+	size_t indexOffset;
+	bool indexed;
+	//only set for converted primitives.
+	unsigned int VBO, EBO;
+	glm::vec3 boundsMin, boundsMax;
+};
+
+class GltfModel
+{
+public:
+	//every buffer view a directly drawn primitive reads from, copied in once from the mapped file.
+	unsigned int viewBuffer;
+	//draws of every gltf mesh, indexed like the meshes in the file.
+	std::vector<std::vector<GltfDraw>> meshes;
+	//where the file's nodes place the meshes, Scene turns these into SceneNodes.
+	std::vector<GltfInstance> instances;
+	//identity dequantization, normalized attributes are expanded by the vertex fetch.
+	VertexLayout layout;
+
+	GltfModel(GltfModelCreateInfo* createInfo);
+	~GltfModel();
+
+	//draws the primitives of a mesh whose bounds are inside the mesh space frustum planes.
+	void draw(unsigned int mesh, const std::array<glm::vec4, 6>& planes);
+};
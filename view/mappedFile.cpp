@@ -0,0 +1,114 @@
+#include "mappedFile.h"
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+mappedFile util::mapFile(const char* filename)
+{
+	mappedFile result{ nullptr, 0, nullptr, nullptr };
+
+#ifdef _WIN32
+	HANDLE file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if (file == INVALID_HANDLE_VALUE)
+		return result;
+
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0)
+	{
+		CloseHandle(file);
+		return result;
+	}
+
+	HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (!mapping)
+	{
+		CloseHandle(file);
+		return result;
+	}
+
+	result.data = static_cast<const unsigned char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+	if (!result.data)
+	{
+		CloseHandle(mapping);
+		CloseHandle(file);
+		return result;
+	}
+	result.size = size_t(fileSize.QuadPart);
+	result.fileHandle = file;
+	result.mappingHandle = mapping;
+#else
+	int file = open(filename, O_RDONLY);
+	if (file < 0)
+		return result;
+
+	struct stat fileInfo;
+	if (fstat(file, &fileInfo) != 0 || fileInfo.st_size == 0)
+	{
+		close(file);
+		return result;
+	}
+
+	void* data = mmap(nullptr, size_t(fileInfo.st_size), PROT_READ, MAP_PRIVATE, file, 0);
+	//the mapping keeps its own reference to the file.
+	close(file);
+	if (data == MAP_FAILED)
+		return result;
+
+	result.data = static_cast<const unsigned char*>(data);
+	result.size = size_t(fileInfo.st_size);
+#endif
+
+	return result;
+}
+
+void util::unmapFile(mappedFile garbageFile)
+{
+	if (!garbageFile.data)
+		return;
+
+#ifdef _WIN32
+	UnmapViewOfFile(garbageFile.data);
+	CloseHandle(garbageFile.mappingHandle);
+	CloseHandle(garbageFile.fileHandle);
+#else
+	munmap(const_cast<unsigned char*>(garbageFile.data), garbageFile.size);
+#endif
+}
+
+bool util::fileStamp(const char* filename, int64_t& modifiedTime, int64_t& size)
+{
+#ifdef _WIN32
+	struct _stat64 fileInfo;
+	if (_stat64(filename, &fileInfo) != 0)
+		return false;
+#else
+	struct stat fileInfo;
+	if (stat(filename, &fileInfo) != 0)
+		return false;
+#endif
+
+	modifiedTime = int64_t(fileInfo.st_mtime);
+	size = int64_t(fileInfo.st_size);
+	return true;
+}
+
+bool util::replaceFile(const char* temporaryFilename, const char* filename)
+{
+#ifdef _WIN32
+	bool replaced = MoveFileExA(temporaryFilename, filename, MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+#else
+	bool replaced = std::rename(temporaryFilename, filename) == 0;
+#endif
+	if (!replaced)
+		std::remove(temporaryFilename);
+	return replaced;
+}
\ No newline at end of file
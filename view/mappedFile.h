@@ -0,0 +1,26 @@
+#pragma once
+#include "../config.h"
+
+//read only view of a whole file, the os pages it in on demand.
+struct mappedFile
+{
+	const unsigned char* data;
+	size_t size;
+	void* fileHandle;
+	void* mappingHandle;
+};
+
+namespace util
+{
+	//data is nullptr if the file doesn't exist or couldn't be mapped.
+	mappedFile mapFile(const char* filename);
+
+	void unmapFile(mappedFile garbageFile);
+
+	//modification time and size, used to tell if a file baked from this one is outdated.
+	bool fileStamp(const char* filename, int64_t& modifiedTime, int64_t& size);
+
+	//moves a fully written temporary over filename in one step, readers see the old file or the new
+	//one but never half of it. the temporary is removed if that fails.
+	bool replaceFile(const char* temporaryFilename, const char* filename);
+}
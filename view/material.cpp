@@ -1,30 +1,25 @@
 #include "material.h"
 
-Material::Material(MaterialCreateInfo* createInfo)
+Material::Material(MaterialCreateInfo* createInfo, std::shared_ptr<Texture> texture)
 {
-	//load image from project, get image details and set rgb+alpha.
-	int texWidth, texHeight;
-	material = util::loadFromFile(createInfo->filename);
-	unsigned char* data = material.pixels;
-	texWidth = material.width;
-	texHeight = material.height;	
-	//create and store texture as 2d.
-	glCreateTextures(GL_TEXTURE_2D, 1, &texture);
-	glTextureStorage2D(texture, 1, GL_RGBA8, texWidth, texHeight);
-	glTextureSubImage2D(texture, 0, 0, 0, texWidth, texHeight, GL_RGBA, GL_UNSIGNED_BYTE, data);
-	glTextureParameteri(texture, GL_TEXTURE_WRAP_S, GL_REPEAT); //if out of bound, repeate texture.
-	glTextureParameteri(texture, GL_TEXTURE_WRAP_T, GL_REPEAT);
-	glTextureParameteri(texture, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR); //if texture is far away, shrink using nearest.
-	glTextureParameteri(texture, GL_TEXTURE_MAG_FILTER, GL_LINEAR); //if texture is far away, grow using linear.
-	util::freeImgMem(material);
+	this->texture = texture;
+	diffuse = createInfo->diffuse;
+	slot = { 0, 0.0f, glm::vec4(1.0f, 1.0f, 0.0f, 0.0f), false };
+	id = 0;
 }
 
-Material::~Material()
+void Material::use(const MaterialLocation& location, uint64_t frame)
 {
-	glDeleteTextures(1, &texture);
-}
+	texture->lastUsed = frame;
+	if (location.bindless)
+	{
+		glUniform1i(location.materialIndex, int(id));
+		return;
+	}
 
-void Material::use()
-{
-	glBindTextureUnit(0, texture);
+	glUniform3fv(location.diffuse, 1, glm::value_ptr(diffuse));
+	glUniform1i(location.arrayIndex, int(slot.array));
+	glUniform1f(location.layer, slot.layer);
+	glUniform4fv(location.uvTransform, 1, glm::value_ptr(slot.uvTransform));
+	glUniform1i(location.atlasRegion, slot.atlasRegion);
 }
@@ -1,19 +1,40 @@
 #pragma once
 #include "../config.h"
-#include "image.h" 
+#include "texture.h"
+#include "textureArrays.h"
 
 struct MaterialCreateInfo
 {
+	//nullptr for an untextured material, it samples a 1x1 white texture instead.
 	const char* filename;
+	//multiplies the texture, Kd in the mtl.
+	glm::vec3 diffuse;
+};
+
+//fragment shader uniforms a material sets.
+struct MaterialLocation
+{
+	//the bindless shader only takes materialIndex, the rest belong to the texture array one.
+	bool bindless;
+	unsigned int materialIndex;
+	unsigned int diffuse, arrayIndex, layer, uvTransform, atlasRegion;
 };
 
 class Material
 {
 public:
-	unsigned int texture;
-	image material;
+	//shared with every other material using the same file.
+	std::shared_ptr<Texture> texture;
+	glm::vec3 diffuse;
+	//where TextureArrays put the texture, set once the engine has built them.
+	TextureSlot slot;
+	//record in BindlessMaterials, set once the engine has built them.
+	unsigned int id;
 
-	Material(MaterialCreateInfo* createInfo); 
-	~Material();
-	void use();
+	//texture is the one the cache loaded for createInfo->filename.
+	Material(MaterialCreateInfo* createInfo, std::shared_ptr<Texture> texture); 
+	//points the shader at the material's record, or at the texture's array layer and sets the
+	//diffuse color. nothing gets bound, the arrays stay on their units for the whole frame.
+	//stamps the texture with frame, TextureResidency's frame, so it knows what's still drawn.
+	void use(const MaterialLocation& location, uint64_t frame);
 };
\ No newline at end of file
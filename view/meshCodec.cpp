@@ -0,0 +1,487 @@
+#include "meshCodec.h"
+
+//same detection as vertexTransform.cpp, sse2 is all the decoder needs.
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define MESH_CODEC_SSE
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+	const size_t vertexBlockSize = 16;
+	//bit widths a byte plane can be packed at, a lane's control byte holds the code of
+	//its low byte plane in bits 0-1 and of its high byte plane in bits 2-3.
+	const unsigned int packWidths[] = { 0, 2, 4, 8 };
+
+	const unsigned int edgeFifoSize = 16;
+	const unsigned int vertexFifoSize = 16;
+	//vertex fifo slots reachable from an edge code, 1-13 in the high nibble.
+	const unsigned int vertexFifoCodes = 13;
+	const unsigned char codeExplicit = 0xE0;
+	const unsigned char codeTriangle = 0xF0;
+
+	uint16_t zigzag16(uint16_t value)
+	{
+		return uint16_t((value << 1) ^ uint16_t(-int(value >> 15)));
+	}
+
+	uint32_t zigzag32(int32_t value)
+	{
+		return (uint32_t(value) << 1) ^ uint32_t(value >> 31);
+	}
+
+	int32_t unzigzag32(uint32_t value)
+	{
+		return int32_t(value >> 1) ^ -int32_t(value & 1);
+	}
+
+	void writeVarint(std::vector<unsigned char>& out, uint32_t value)
+	{
+		while (value >= 0x80)
+		{
+			out.push_back((unsigned char)(value | 0x80));
+			value >>= 7;
+		}
+		out.push_back((unsigned char)value);
+	}
+
+	bool readVarint(const unsigned char*& cursor, const unsigned char* end, uint32_t& value)
+	{
+		value = 0;
+		for (int shift = 0; shift < 35 && cursor < end; shift += 7)
+		{
+			unsigned char byte = *cursor++;
+			value |= uint32_t(byte & 0x7F) << shift;
+			if (byte < 0x80)
+				return true;
+		}
+		return false;
+	}
+
+	unsigned char widthCode(unsigned char widest)
+	{
+		unsigned char code = 0;
+		while (widest >= (1u << packWidths[code]) && code < 3)
+			++code;
+		return code;
+	}
+
+	void packPlane(const unsigned char* values, unsigned int width, std::vector<unsigned char>& out)
+	{
+		if (width == 0)
+			return;
+		unsigned int perByte = 8 / width;
+		for (size_t i = 0; i < vertexBlockSize; i += perByte)
+		{
+			unsigned char byte = 0;
+			for (unsigned int j = 0; j < perByte; ++j)
+				byte |= (unsigned char)(values[i + j] << (j * width));
+			out.push_back(byte);
+		}
+	}
+
+	size_t packedBytes(unsigned int width)
+	{
+		return vertexBlockSize * width / 8;
+	}
+
+#ifdef MESH_CODEC_SSE
+	//16 byte plane values in order, one per byte.
+	__m128i unpackPlane(const unsigned char* data, unsigned int width)
+	{
+		switch (width)
+		{
+		case 0:
+			return _mm_setzero_si128();
+		case 8:
+			return _mm_loadu_si128(reinterpret_cast<const __m128i*>(data));
+		case 4:
+		{
+			__m128i packed = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(data));
+			__m128i mask = _mm_set1_epi8(0x0F);
+			return _mm_unpacklo_epi8(_mm_and_si128(packed, mask), _mm_and_si128(_mm_srli_epi16(packed, 4), mask));
+		}
+		default:
+		{
+			int word;
+			memcpy(&word, data, sizeof(word));
+			__m128i packed = _mm_cvtsi32_si128(word);
+			__m128i mask = _mm_set1_epi8(0x03);
+			//the 16 bit shifts pull bits over from the next byte, the mask drops them again.
+			__m128i pair01 = _mm_unpacklo_epi8(_mm_and_si128(packed, mask), _mm_and_si128(_mm_srli_epi16(packed, 2), mask));
+			__m128i pair23 = _mm_unpacklo_epi8(_mm_and_si128(_mm_srli_epi16(packed, 4), mask), _mm_and_si128(_mm_srli_epi16(packed, 6), mask));
+			return _mm_unpacklo_epi16(pair01, pair23);
+		}
+		}
+	}
+
+	//undoes zigzag and delta for 8 values, previous holds the last decoded value in every lane.
+	__m128i decodeDeltas(__m128i values, __m128i& previous)
+	{
+		__m128i one = _mm_set1_epi16(1);
+		__m128i deltas = _mm_xor_si128(_mm_srli_epi16(values, 1), _mm_sub_epi16(_mm_setzero_si128(), _mm_and_si128(values, one)));
+		deltas = _mm_add_epi16(deltas, _mm_slli_si128(deltas, 2));
+		deltas = _mm_add_epi16(deltas, _mm_slli_si128(deltas, 4));
+		deltas = _mm_add_epi16(deltas, _mm_slli_si128(deltas, 8));
+		__m128i result = _mm_add_epi16(deltas, previous);
+		previous = _mm_shufflelo_epi16(_mm_unpackhi_epi64(result, result), 0xFF);
+		previous = _mm_unpacklo_epi64(previous, previous);
+		return result;
+	}
+
+	//8 values of one lane, wrapped so it can go in a vector.
+	struct Row
+	{
+		__m128i values = _mm_setzero_si128();
+	};
+
+	//8 lanes of 8 vertices into 8 vertices of 8 lanes, rows are lanes on the way in.
+	void transpose8(const Row* rows, unsigned char* output, size_t stride, size_t vertexCount)
+	{
+		__m128i a0 = _mm_unpacklo_epi16(rows[0].values, rows[1].values), a1 = _mm_unpackhi_epi16(rows[0].values, rows[1].values);
+		__m128i a2 = _mm_unpacklo_epi16(rows[2].values, rows[3].values), a3 = _mm_unpackhi_epi16(rows[2].values, rows[3].values);
+		__m128i a4 = _mm_unpacklo_epi16(rows[4].values, rows[5].values), a5 = _mm_unpackhi_epi16(rows[4].values, rows[5].values);
+		__m128i a6 = _mm_unpacklo_epi16(rows[6].values, rows[7].values), a7 = _mm_unpackhi_epi16(rows[6].values, rows[7].values);
+
+		__m128i b0 = _mm_unpacklo_epi32(a0, a2), b1 = _mm_unpackhi_epi32(a0, a2);
+		__m128i b2 = _mm_unpacklo_epi32(a1, a3), b3 = _mm_unpackhi_epi32(a1, a3);
+		__m128i b4 = _mm_unpacklo_epi32(a4, a6), b5 = _mm_unpackhi_epi32(a4, a6);
+		__m128i b6 = _mm_unpacklo_epi32(a5, a7), b7 = _mm_unpackhi_epi32(a5, a7);
+
+		__m128i vertices[8] = {
+			_mm_unpacklo_epi64(b0, b4), _mm_unpackhi_epi64(b0, b4), _mm_unpacklo_epi64(b1, b5), _mm_unpackhi_epi64(b1, b5),
+			_mm_unpacklo_epi64(b2, b6), _mm_unpackhi_epi64(b2, b6), _mm_unpacklo_epi64(b3, b7), _mm_unpackhi_epi64(b3, b7) };
+		for (size_t i = 0; i < vertexCount; ++i)
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(output + i * stride), vertices[i]);
+	}
+#else
+	void unpackPlane(const unsigned char* data, unsigned int width, unsigned char* values)
+	{
+		for (size_t i = 0; i < vertexBlockSize; ++i)
+		{
+			unsigned int perByte = width == 0 ? 1 : 8 / width;
+			values[i] = width == 0 ? 0 : (unsigned char)((data[i / perByte] >> ((i % perByte) * width)) & ((1u << width) - 1));
+		}
+	}
+#endif
+
+	struct Edge
+	{
+		unsigned int a, b;
+	};
+
+	//state both sides of the index codec step through identically.
+	struct IndexFifos
+	{
+		Edge edges[edgeFifoSize];
+		unsigned int vertices[vertexFifoSize];
+		unsigned int edgeHead, vertexHead;
+		unsigned int next, last;
+
+		IndexFifos() : edgeHead(0), vertexHead(0), next(0), last(0)
+		{
+			for (Edge& edge : edges)
+				edge = { ~0u, ~0u };
+			for (unsigned int& vertex : vertices)
+				vertex = ~0u;
+		}
+
+		//0 is the most recent entry.
+		const Edge& edge(unsigned int age) const
+		{
+			return edges[(edgeHead - 1 - age) & (edgeFifoSize - 1)];
+		}
+
+		int findVertex(unsigned int vertex, unsigned int limit) const
+		{
+			for (unsigned int age = 0; age < limit; ++age)
+				if (vertices[(vertexHead - 1 - age) & (vertexFifoSize - 1)] == vertex)
+					return int(age);
+			return -1;
+		}
+
+		unsigned int vertex(unsigned int age) const
+		{
+			return vertices[(vertexHead - 1 - age) & (vertexFifoSize - 1)];
+		}
+
+		//no duplicate check, a repeated vertex only costs a slot and keeps the decoder cheap.
+		void pushVertex(unsigned int vertex)
+		{
+			vertices[vertexHead++ & (vertexFifoSize - 1)] = vertex;
+		}
+
+		//stored reversed, the way the triangle on the other side of the edge walks it.
+		void pushTriangle(unsigned int a, unsigned int b, unsigned int c)
+		{
+			edges[edgeHead++ & (edgeFifoSize - 1)] = { b, a };
+			edges[edgeHead++ & (edgeFifoSize - 1)] = { c, b };
+			edges[edgeHead++ & (edgeFifoSize - 1)] = { a, c };
+		}
+	};
+
+	//one instantiation per index type keeps the store out of the per triangle branches.
+	template <typename Index>
+	bool decodeTriangles(Index* indices, size_t triangleCount, unsigned int vertexCount,
+		const unsigned char* codes, const unsigned char* extra, const unsigned char* end)
+	{
+		IndexFifos fifos;
+		for (size_t triangle = 0; triangle < triangleCount; ++triangle)
+		{
+			unsigned char code = codes[triangle];
+			unsigned int a, b, c;
+
+			if (code == codeTriangle)
+			{
+				unsigned int corners[3];
+				for (unsigned int& vertex : corners)
+				{
+					uint32_t delta;
+					if (!readVarint(extra, end, delta))
+						return false;
+					vertex = fifos.last + unzigzag32(delta);
+					fifos.last = vertex;
+					if (vertex == fifos.next)
+						++fifos.next;
+					fifos.pushVertex(vertex);
+				}
+				a = corners[0];
+				b = corners[1];
+				c = corners[2];
+			}
+			else
+			{
+				const Edge& edge = fifos.edge(code & 0x0F);
+				a = edge.a;
+				b = edge.b;
+				unsigned char kind = code & 0xF0;
+				if (kind == 0)
+				{
+					c = fifos.next++;
+					fifos.pushVertex(c);
+				}
+				else if (kind == codeExplicit)
+				{
+					uint32_t delta;
+					if (!readVarint(extra, end, delta))
+						return false;
+					c = fifos.last + unzigzag32(delta);
+					fifos.pushVertex(c);
+				}
+				else if (kind == codeTriangle)
+					return false;
+				else
+					c = fifos.vertex((kind >> 4) - 1);
+				fifos.last = c;
+			}
+
+			//a corrupt stream must never index past the vertex buffer.
+			if (a >= vertexCount || b >= vertexCount || c >= vertexCount)
+				return false;
+
+			fifos.pushTriangle(a, b, c);
+			indices[3 * triangle] = Index(a);
+			indices[3 * triangle + 1] = Index(b);
+			indices[3 * triangle + 2] = Index(c);
+		}
+		return extra == end;
+	}
+}
+
+std::vector<unsigned char> util::encodeVertices(const unsigned char* vertices, size_t vertexCount, size_t stride)
+{
+	std::vector<unsigned char> encoded;
+	size_t lanes = stride / 2;
+	std::vector<uint16_t> previous(lanes, 0);
+	unsigned char lowBytes[vertexBlockSize], highBytes[vertexBlockSize];
+
+	for (size_t first = 0; first < vertexCount; first += vertexBlockSize)
+	{
+		for (size_t lane = 0; lane < lanes; ++lane)
+		{
+			//a short last block repeats its last vertex, which packs to nothing.
+			unsigned char lowWidest = 0, highWidest = 0;
+			uint16_t last = previous[lane];
+			for (size_t i = 0; i < vertexBlockSize; ++i)
+			{
+				uint16_t value = last;
+				if (first + i < vertexCount)
+					memcpy(&value, vertices + (first + i) * stride + 2 * lane, sizeof(value));
+				uint16_t delta = zigzag16(uint16_t(value - last));
+				lowBytes[i] = (unsigned char)(delta & 0xFF);
+				highBytes[i] = (unsigned char)(delta >> 8);
+				lowWidest |= lowBytes[i];
+				highWidest |= highBytes[i];
+				last = value;
+			}
+			previous[lane] = last;
+
+			//small deltas leave the high bytes zero, so they usually pack to nothing.
+			unsigned char lowCode = widthCode(lowWidest), highCode = widthCode(highWidest);
+			encoded.push_back((unsigned char)(lowCode | (highCode << 2)));
+			packPlane(lowBytes, packWidths[lowCode], encoded);
+			packPlane(highBytes, packWidths[highCode], encoded);
+		}
+	}
+
+	return encoded;
+}
+
+bool util::decodeVertices(unsigned char* vertices, size_t vertexCount, size_t stride, const unsigned char* data, size_t size)
+{
+	const unsigned char* end = data + size;
+	size_t lanes = stride / 2;
+	if (stride % 2 != 0)
+		return false;
+
+#ifdef MESH_CODEC_SSE
+	//two registers of 8 decoded values per lane for the current block.
+	std::vector<Row> previous(lanes);
+	std::vector<Row> rows(2 * ((lanes + 7) / 8 * 8));
+#else
+	std::vector<uint16_t> previous(lanes, 0);
+	std::vector<uint16_t> block(lanes * vertexBlockSize);
+#endif
+
+	for (size_t first = 0; first < vertexCount; first += vertexBlockSize)
+	{
+		size_t blockVertices = std::min(vertexBlockSize, vertexCount - first);
+
+		for (size_t lane = 0; lane < lanes; ++lane)
+		{
+			if (data >= end || *data > 0x0F)
+				return false;
+			unsigned int lowWidth = packWidths[*data & 3], highWidth = packWidths[*data >> 2];
+			++data;
+			//every width is loaded with exactly its packed size, nothing past the end gets touched.
+			if (size_t(end - data) < packedBytes(lowWidth) + packedBytes(highWidth))
+				return false;
+			const unsigned char* lowPlane = data;
+			const unsigned char* highPlane = data + packedBytes(lowWidth);
+			data = highPlane + packedBytes(highWidth);
+
+#ifdef MESH_CODEC_SSE
+			__m128i lowBytes = unpackPlane(lowPlane, lowWidth);
+			__m128i highBytes = unpackPlane(highPlane, highWidth);
+			rows[lane].values = decodeDeltas(_mm_unpacklo_epi8(lowBytes, highBytes), previous[lane].values);
+			rows[rows.size() / 2 + lane].values = decodeDeltas(_mm_unpackhi_epi8(lowBytes, highBytes), previous[lane].values);
+#else
+			unsigned char lowBytes[vertexBlockSize], highBytes[vertexBlockSize];
+			unpackPlane(lowPlane, lowWidth, lowBytes);
+			unpackPlane(highPlane, highWidth, highBytes);
+			uint16_t* values = &block[lane * vertexBlockSize];
+			for (size_t i = 0; i < vertexBlockSize; ++i)
+			{
+				uint16_t zigzagged = uint16_t(lowBytes[i] | (highBytes[i] << 8));
+				uint16_t delta = uint16_t((zigzagged >> 1) ^ uint16_t(-int(zigzagged & 1)));
+				previous[lane] = values[i] = uint16_t(previous[lane] + delta);
+			}
+#endif
+		}
+
+		unsigned char* output = vertices + first * stride;
+#ifdef MESH_CODEC_SSE
+		size_t half = rows.size() / 2;
+		if (lanes % 8 == 0)
+			for (size_t group = 0; group < lanes; group += 8)
+			{
+				transpose8(&rows[group], output + 2 * group, stride, std::min<size_t>(blockVertices, 8));
+				if (blockVertices > 8)
+					transpose8(&rows[half + group], output + 8 * stride + 2 * group, stride, blockVertices - 8);
+			}
+		else
+			for (size_t lane = 0; lane < lanes; ++lane)
+			{
+				alignas(16) uint16_t values[vertexBlockSize];
+				_mm_store_si128(reinterpret_cast<__m128i*>(values), rows[lane].values);
+				_mm_store_si128(reinterpret_cast<__m128i*>(values + 8), rows[half + lane].values);
+				for (size_t i = 0; i < blockVertices; ++i)
+					memcpy(output + i * stride + 2 * lane, &values[i], sizeof(uint16_t));
+			}
+#else
+		for (size_t i = 0; i < blockVertices; ++i)
+			for (size_t lane = 0; lane < lanes; ++lane)
+				memcpy(output + i * stride + 2 * lane, &block[lane * vertexBlockSize + i], sizeof(uint16_t));
+#endif
+	}
+
+	return data == end;
+}
+
+std::vector<unsigned char> util::encodeIndices(const std::vector<unsigned int>& indices)
+{
+	//codes first, one byte per triangle, then the varints the codes refer to.
+	std::vector<unsigned char> codes, extra;
+	codes.reserve(indices.size() / 3);
+	IndexFifos fifos;
+
+	for (size_t i = 0; i + 2 < indices.size(); i += 3)
+	{
+		unsigned int triangle[3] = { indices[i], indices[i + 1], indices[i + 2] };
+
+		int edgeAge = -1, rotation = 0;
+		for (unsigned int age = 0; age < edgeFifoSize && edgeAge < 0; ++age)
+			for (int r = 0; r < 3; ++r)
+				if (fifos.edge(age).a == triangle[r] && fifos.edge(age).b == triangle[(r + 1) % 3])
+				{
+					edgeAge = int(age);
+					rotation = r;
+					break;
+				}
+
+		if (edgeAge >= 0)
+		{
+			unsigned int a = triangle[rotation], b = triangle[(rotation + 1) % 3], c = triangle[(rotation + 2) % 3];
+			int fifoAge = fifos.findVertex(c, vertexFifoCodes);
+			if (c == fifos.next)
+			{
+				codes.push_back((unsigned char)edgeAge);
+				++fifos.next;
+				fifos.pushVertex(c);
+			}
+			else if (fifoAge >= 0)
+				codes.push_back((unsigned char)(((fifoAge + 1) << 4) | edgeAge));
+			else
+			{
+				codes.push_back((unsigned char)(codeExplicit | edgeAge));
+				writeVarint(extra, zigzag32(int32_t(c - fifos.last)));
+				fifos.pushVertex(c);
+			}
+			fifos.last = c;
+			fifos.pushTriangle(a, b, c);
+			continue;
+		}
+
+		codes.push_back(codeTriangle);
+		for (unsigned int vertex : triangle)
+		{
+			writeVarint(extra, zigzag32(int32_t(vertex - fifos.last)));
+			fifos.last = vertex;
+			if (vertex == fifos.next)
+				++fifos.next;
+			fifos.pushVertex(vertex);
+		}
+		fifos.pushTriangle(triangle[0], triangle[1], triangle[2]);
+	}
+
+	std::vector<unsigned char> encoded;
+	writeVarint(encoded, uint32_t(codes.size()));
+	encoded.insert(encoded.end(), codes.begin(), codes.end());
+	encoded.insert(encoded.end(), extra.begin(), extra.end());
+	return encoded;
+}
+
+bool util::decodeIndices(void* indices, size_t indexCount, unsigned int indexType, unsigned int vertexCount,
+	const unsigned char* data, size_t size)
+{
+	const unsigned char* end = data + size;
+	uint32_t codeCount;
+	if (!readVarint(data, end, codeCount) || codeCount != indexCount / 3 || indexCount % 3 != 0 || size_t(end - data) < codeCount)
+		return false;
+
+	const unsigned char* codes = data;
+	const unsigned char* extra = data + codeCount;
+	if (indexType == GL_UNSIGNED_SHORT)
+		return decodeTriangles(static_cast<uint16_t*>(indices), codeCount, vertexCount, codes, extra, end);
+	return decodeTriangles(static_cast<uint32_t*>(indices), codeCount, vertexCount, codes, extra, end);
+}
@@ -0,0 +1,22 @@
+#pragma once
+#include "../config.h"
+
+namespace util
+{
+	//lossless. vertices are split into 16 bit lanes, every lane is delta and zigzag coded against the
+	//previous vertex. 16 vertices at a time, the low and high bytes of a lane are bit packed
+	//separately at 0, 2, 4 or 8 bits, whichever fits.
+	//works best on quantized vertices in fetch order, stride has to be a multiple of 2.
+	std::vector<unsigned char> encodeVertices(const unsigned char* vertices, size_t vertexCount, size_t stride);
+
+	//false if data is malformed or doesn't hold exactly vertexCount vertices.
+	bool decodeVertices(unsigned char* vertices, size_t vertexCount, size_t stride, const unsigned char* data, size_t size);
+
+	//triangle lists as about a byte per triangle: a recently seen edge plus a new vertex, a vertex
+	//from a small fifo or an explicit delta. corners can come out rotated, the winding is kept.
+	std::vector<unsigned char> encodeIndices(const std::vector<unsigned int>& indices);
+
+	//writes 16 or 32 bit indices depending on indexType, false if any would reach past vertexCount.
+	bool decodeIndices(void* indices, size_t indexCount, unsigned int indexType, unsigned int vertexCount,
+		const unsigned char* data, size_t size);
+}
@@ -0,0 +1,287 @@
+#include "meshOptimizer.h"
+
+namespace
+{
+	//triangles using each vertex, stored as one flat array with per vertex offsets.
+	struct TriangleAdjacency
+	{
+		std::vector<unsigned int> offsets, counts, triangles;
+	};
+
+	TriangleAdjacency buildAdjacency(const std::vector<unsigned int>& indices, unsigned int vertexCount)
+	{
+		TriangleAdjacency adjacency;
+		adjacency.counts.assign(vertexCount, 0);
+		adjacency.offsets.assign(vertexCount, 0);
+		adjacency.triangles.resize(indices.size());
+
+		for (unsigned int index : indices)
+			++adjacency.counts[index];
+
+		unsigned int offset = 0;
+		for (unsigned int v = 0; v < vertexCount; ++v)
+		{
+			adjacency.offsets[v] = offset;
+			offset += adjacency.counts[v];
+		}
+
+		std::vector<unsigned int> fill(adjacency.offsets);
+		for (size_t i = 0; i < indices.size(); ++i)
+			adjacency.triangles[fill[indices[i]]++] = (unsigned int)(i / 3);
+
+		return adjacency;
+	}
+
+	glm::vec3 vertexPosition(const MeshData& mesh, unsigned int index)
+	{
+		return glm::make_vec3(&mesh.vertices[8 * index]);
+	}
+}
+
+VertexCacheStats util::analyzeVertexCache(const std::vector<unsigned int>& indices, unsigned int vertexCount, unsigned int cacheSize)
+{
+	VertexCacheStats stats{ 0.0f, 0.0f };
+	if (indices.empty())
+		return stats;
+
+	//a vertex is in the fifo while fewer than cacheSize misses happened since it was loaded.
+	std::vector<unsigned int> loadedAt(vertexCount, 0);
+	std::vector<bool> referenced(vertexCount, false);
+	unsigned int misses = 0, unique = 0;
+
+	for (unsigned int index : indices)
+	{
+		if (!referenced[index])
+		{
+			referenced[index] = true;
+			++unique;
+		}
+		if (loadedAt[index] == 0 || misses - loadedAt[index] >= cacheSize)
+		{
+			++misses;
+			loadedAt[index] = misses;
+		}
+	}
+
+	stats.acmr = float(misses) / float(indices.size() / 3);
+	stats.atvr = float(misses) / float(unique);
+	return stats;
+}
+
+void util::optimizeVertexCache(std::vector<unsigned int>& indices, unsigned int vertexCount, unsigned int cacheSize)
+{
+	if (indices.empty())
+		return;
+
+	size_t triangleCount = indices.size() / 3;
+	TriangleAdjacency adjacency = buildAdjacency(indices, vertexCount);
+
+	//triangles still waiting to be emitted per vertex.
+	std::vector<unsigned int> live(adjacency.counts);
+	std::vector<unsigned int> cacheTime(vertexCount, 0);
+	std::vector<bool> emitted(triangleCount, false);
+	std::vector<unsigned int> deadEnd, candidates;
+	std::vector<unsigned int> result;
+	result.reserve(indices.size());
+
+	//timestamps start past the cache size so nothing counts as cached yet.
+	unsigned int timestamp = cacheSize + 1;
+	unsigned int cursor = 1;
+	int fanning = 0;
+
+	while (fanning >= 0)
+	{
+		candidates.clear();
+
+		unsigned int begin = adjacency.offsets[fanning];
+		unsigned int end = begin + adjacency.counts[fanning];
+		for (unsigned int i = begin; i < end; ++i)
+		{
+			unsigned int triangle = adjacency.triangles[i];
+			if (emitted[triangle])
+				continue;
+
+			for (unsigned int corner = 0; corner < 3; ++corner)
+			{
+				unsigned int v = indices[3 * triangle + corner];
+				result.push_back(v);
+				deadEnd.push_back(v);
+				candidates.push_back(v);
+				--live[v];
+				if (timestamp - cacheTime[v] > cacheSize)
+					cacheTime[v] = timestamp++;
+			}
+			emitted[triangle] = true;
+		}
+
+		//prefer a candidate that stays in cache while its remaining triangles get emitted.
+		int best = -1;
+		int bestPriority = -1;
+		for (unsigned int v : candidates)
+		{
+			if (live[v] == 0)
+				continue;
+
+			int priority = 0;
+			if (timestamp - cacheTime[v] + 2 * live[v] <= cacheSize)
+				priority = int(timestamp - cacheTime[v]);
+			if (priority > bestPriority)
+			{
+				bestPriority = priority;
+				best = int(v);
+			}
+		}
+
+		//dead end, back up through recently used vertices, then scan forward for anything left.
+		while (best == -1 && !deadEnd.empty())
+		{
+			unsigned int v = deadEnd.back();
+			deadEnd.pop_back();
+			if (live[v] > 0)
+				best = int(v);
+		}
+		while (best == -1 && cursor < vertexCount)
+		{
+			if (live[cursor] > 0)
+				best = int(cursor);
+			++cursor;
+		}
+
+		fanning = best;
+	}
+
+	indices.swap(result);
+}
+
+void util::optimizeOverdraw(std::vector<unsigned int>& indices, const MeshData& mesh, float threshold, unsigned int cacheSize)
+{
+	size_t triangleCount = indices.size() / 3;
+	if (triangleCount == 0)
+		return;
+
+	float meshAcmr = analyzeVertexCache(indices, mesh.vertexCount, cacheSize).acmr;
+
+	//hard boundaries where every corner misses the cache, those are where tipsify restarted.
+	//soft boundaries once a cluster, simulated from a cold cache, is at most threshold times worse
+	//than the whole mesh. cutting there gives the sort more freedom without hurting the cache much.
+	std::vector<size_t> clusterStarts;
+	std::vector<unsigned int> loadedAt(mesh.vertexCount, 0), clusterLoadedAt(mesh.vertexCount, 0);
+	unsigned int misses = 0, clusterMisses = 0, coldClock = 0;
+	size_t clusterStart = 0;
+
+	for (size_t t = 0; t < triangleCount; ++t)
+	{
+		bool softBoundary = t > clusterStart && float(clusterMisses) / float(t - clusterStart) <= meshAcmr * threshold;
+
+		unsigned int triangleMisses = 0;
+		for (unsigned int corner = 0; corner < 3; ++corner)
+		{
+			unsigned int v = indices[3 * t + corner];
+			if (loadedAt[v] == 0 || misses - loadedAt[v] >= cacheSize)
+			{
+				++misses;
+				++triangleMisses;
+				loadedAt[v] = misses;
+			}
+		}
+
+		if (t == 0 || triangleMisses == 3 || softBoundary)
+		{
+			clusterStarts.push_back(t);
+			clusterStart = t;
+			clusterMisses = 0;
+			//jumping the clock a whole cache ahead ages out everything the last cluster loaded.
+			coldClock += cacheSize;
+		}
+
+		for (unsigned int corner = 0; corner < 3; ++corner)
+		{
+			unsigned int v = indices[3 * t + corner];
+			if (clusterLoadedAt[v] == 0 || coldClock - clusterLoadedAt[v] >= cacheSize)
+			{
+				++clusterMisses;
+				clusterLoadedAt[v] = ++coldClock;
+			}
+		}
+	}
+	clusterStarts.push_back(triangleCount);
+
+	//clusters facing away from the mesh center are likely in front, draw them first.
+	glm::vec3 meshCenter = 0.5f * (mesh.boundsMin + mesh.boundsMax);
+	size_t clusterCount = clusterStarts.size() - 1;
+	std::vector<float> sortKeys(clusterCount);
+	for (size_t c = 0; c < clusterCount; ++c)
+	{
+		glm::vec3 centroid(0.0f), normal(0.0f);
+		float area = 0.0f;
+		for (size_t t = clusterStarts[c]; t < clusterStarts[c + 1]; ++t)
+		{
+			glm::vec3 a = vertexPosition(mesh, indices[3 * t]);
+			glm::vec3 b = vertexPosition(mesh, indices[3 * t + 1]);
+			glm::vec3 d = vertexPosition(mesh, indices[3 * t + 2]);
+			//cross product length is twice the area, the factor cancels out.
+			glm::vec3 areaNormal = glm::cross(b - a, d - a);
+			float triangleArea = glm::length(areaNormal);
+			centroid += triangleArea * (a + b + d) / 3.0f;
+			normal += areaNormal;
+			area += triangleArea;
+		}
+		if (area > 0.0f)
+			centroid /= area;
+		sortKeys[c] = glm::dot(centroid - meshCenter, normal);
+	}
+
+	std::vector<size_t> order(clusterCount);
+	for (size_t c = 0; c < clusterCount; ++c)
+		order[c] = c;
+	std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) { return sortKeys[a] > sortKeys[b]; });
+
+	std::vector<unsigned int> result;
+	result.reserve(indices.size());
+	for (size_t c : order)
+		result.insert(result.end(), indices.begin() + 3 * clusterStarts[c], indices.begin() + 3 * clusterStarts[c + 1]);
+	indices.swap(result);
+}
+
+void util::optimizeVertexFetch(MeshData& mesh)
+{
+	const unsigned int unused = std::numeric_limits<unsigned int>::max();
+	std::vector<unsigned int> remap(mesh.vertexCount, unused);
+	std::vector<float> vertices;
+	vertices.reserve(mesh.vertices.size());
+	unsigned int vertexCount = 0;
+
+	for (unsigned int& index : mesh.indices)
+	{
+		if (remap[index] == unused)
+		{
+			remap[index] = vertexCount++;
+			vertices.insert(vertices.end(), mesh.vertices.begin() + 8 * index, mesh.vertices.begin() + 8 * (index + 1));
+		}
+		index = remap[index];
+	}
+
+	mesh.vertices.swap(vertices);
+	mesh.vertexCount = vertexCount;
+	mesh.indexType = vertexCount <= 65536 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+}
+
+void util::optimizeMesh(MeshData& mesh, const char* name)
+{
+	VertexCacheStats before = analyzeVertexCache(mesh.indices, mesh.vertexCount);
+
+	//submeshes are drawn separately, so each one is ordered on its own.
+	for (const MeshSubmesh& submesh : mesh.submeshes)
+	{
+		std::vector<unsigned int> indices(mesh.indices.begin() + submesh.indexOffset,
+			mesh.indices.begin() + submesh.indexOffset + submesh.indexCount);
+		optimizeVertexCache(indices, mesh.vertexCount);
+		optimizeOverdraw(indices, mesh);
+		std::copy(indices.begin(), indices.end(), mesh.indices.begin() + submesh.indexOffset);
+	}
+	optimizeVertexFetch(mesh);
+
+	VertexCacheStats after = analyzeVertexCache(mesh.indices, mesh.vertexCount);
+	std::cout << name << " vertex cache ACMR " << before.acmr << " -> " << after.acmr
+		<< ", ATVR " << before.atvr << " -> " << after.atvr << '\n';
+}
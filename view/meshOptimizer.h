@@ -0,0 +1,29 @@
+#pragma once
+#include "../config.h"
+#include "objectLoader.h"
+
+//acmr: transformed vertices per triangle, atvr: transformed vertices per referenced vertex.
+//1.0 atvr means every vertex runs the vertex shader exactly once.
+struct VertexCacheStats
+{
+	float acmr, atvr;
+};
+
+namespace util
+{
+	//simulates a fifo post transform cache over the index buffer.
+	VertexCacheStats analyzeVertexCache(const std::vector<unsigned int>& indices, unsigned int vertexCount, unsigned int cacheSize = 16);
+
+	//tipsify (sander et al. 2007) triangle order for post transform cache hits.
+	void optimizeVertexCache(std::vector<unsigned int>& indices, unsigned int vertexCount, unsigned int cacheSize = 16);
+
+	//splits the cache ordered triangles into clusters and draws the outward facing ones first.
+	//threshold is how much worse than the whole mesh a cluster's acmr may get.
+	void optimizeOverdraw(std::vector<unsigned int>& indices, const MeshData& mesh, float threshold = 1.05f, unsigned int cacheSize = 16);
+
+	//renumbers vertices by first use so fetches walk the vertex buffer forwards, unused vertices are dropped.
+	void optimizeVertexFetch(MeshData& mesh);
+
+	//runs all three passes in order, the first two per submesh, and prints the cache stats before and after.
+	void optimizeMesh(MeshData& mesh, const char* name);
+}
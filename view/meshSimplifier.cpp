@@ -0,0 +1,322 @@
+#include "meshSimplifier.h"
+#include "meshOptimizer.h"
+#include <queue>
+
+namespace
+{
+	//symmetric 4x4 sum of squared plane distances, weight is the triangle area it was built from.
+	struct Quadric
+	{
+		double a00, a01, a02, a03, a11, a12, a13, a22, a23, a33;
+		double weight;
+	};
+
+	void addPlane(Quadric& q, glm::dvec3 normal, double distance, double weight)
+	{
+		q.a00 += weight * normal.x * normal.x;
+		q.a01 += weight * normal.x * normal.y;
+		q.a02 += weight * normal.x * normal.z;
+		q.a03 += weight * normal.x * distance;
+		q.a11 += weight * normal.y * normal.y;
+		q.a12 += weight * normal.y * normal.z;
+		q.a13 += weight * normal.y * distance;
+		q.a22 += weight * normal.z * normal.z;
+		q.a23 += weight * normal.z * distance;
+		q.a33 += weight * distance * distance;
+		q.weight += weight;
+	}
+
+	void addQuadric(Quadric& q, const Quadric& other)
+	{
+		q.a00 += other.a00; q.a01 += other.a01; q.a02 += other.a02; q.a03 += other.a03;
+		q.a11 += other.a11; q.a12 += other.a12; q.a13 += other.a13;
+		q.a22 += other.a22; q.a23 += other.a23;
+		q.a33 += other.a33;
+		q.weight += other.weight;
+	}
+
+	//mean squared distance from p to the planes the quadric holds.
+	double evaluate(const Quadric& q, glm::dvec3 p)
+	{
+		double sum = q.a00 * p.x * p.x + 2.0 * q.a01 * p.x * p.y + 2.0 * q.a02 * p.x * p.z + 2.0 * q.a03 * p.x
+			+ q.a11 * p.y * p.y + 2.0 * q.a12 * p.y * p.z + 2.0 * q.a13 * p.y
+			+ q.a22 * p.z * p.z + 2.0 * q.a23 * p.z
+			+ q.a33;
+		return q.weight > 0.0 ? std::max(sum, 0.0) / q.weight : 0.0;
+	}
+
+	//collapse of welded vertex from onto to, versions tell if either changed since it was queued.
+	struct Collapse
+	{
+		double cost;
+		unsigned int from, to, fromVersion, toVersion;
+
+		bool operator>(const Collapse& other) const
+		{
+			return cost > other.cost;
+		}
+	};
+
+	struct PositionHash
+	{
+		size_t operator()(const glm::vec3& position) const
+		{
+			uint32_t bits[3];
+			memcpy(bits, glm::value_ptr(position), sizeof(bits));
+			return (bits[0] * 73856093u) ^ (bits[1] * 19349663u) ^ (bits[2] * 83492791u);
+		}
+	};
+}
+
+std::vector<unsigned int> util::simplifyMesh(const MeshData& mesh, const std::vector<unsigned int>& indices,
+	size_t targetIndexCount, float& error)
+{
+	error = 0.0f;
+	size_t triangleCount = indices.size() / 3;
+
+	//vertices split only by uv or normal share one welded vertex, so collapses see the real surface.
+	std::unordered_map<glm::vec3, unsigned int, PositionHash> weldedByPosition;
+	std::vector<unsigned int> weld(mesh.vertexCount, 0);
+	std::vector<unsigned int> representative, wedgeCount;
+	std::vector<glm::dvec3> positions;
+	std::vector<bool> referenced(mesh.vertexCount, false);
+	for (unsigned int index : indices)
+	{
+		if (referenced[index])
+			continue;
+		referenced[index] = true;
+
+		glm::vec3 position = glm::make_vec3(&mesh.vertices[8 * index]);
+		auto inserted = weldedByPosition.emplace(position, (unsigned int)positions.size());
+		if (inserted.second)
+		{
+			positions.push_back(glm::dvec3(position));
+			representative.push_back(index);
+			wedgeCount.push_back(0);
+		}
+		weld[index] = inserted.first->second;
+		++wedgeCount[inserted.first->second];
+	}
+	size_t weldedCount = positions.size();
+
+	std::vector<unsigned int> triangles(indices.size());
+	std::vector<unsigned int> corners(indices);
+	for (size_t i = 0; i < indices.size(); ++i)
+		triangles[i] = weld[indices[i]];
+
+	//an edge used by anything but exactly two triangles is an open border or non manifold.
+	std::unordered_map<uint64_t, unsigned int> edgeUse;
+	for (size_t t = 0; t < triangleCount; ++t)
+	{
+		for (unsigned int e = 0; e < 3; ++e)
+		{
+			uint64_t a = triangles[3 * t + e], b = triangles[3 * t + (e + 1) % 3];
+			++edgeUse[std::min(a, b) << 32 | std::max(a, b)];
+		}
+	}
+
+	//seams have several wedges, moving them would tear uvs or normals apart.
+	std::vector<bool> seam(weldedCount), locked(weldedCount);
+	for (size_t w = 0; w < weldedCount; ++w)
+		seam[w] = locked[w] = wedgeCount[w] > 1;
+	for (const auto& edge : edgeUse)
+	{
+		if (edge.second != 2)
+		{
+			locked[edge.first >> 32] = true;
+			locked[edge.first & 0xffffffffu] = true;
+		}
+	}
+
+	std::vector<Quadric> quadrics(weldedCount, Quadric{});
+	std::vector<std::vector<unsigned int>> adjacency(weldedCount);
+	for (size_t t = 0; t < triangleCount; ++t)
+	{
+		glm::dvec3 a = positions[triangles[3 * t]];
+		glm::dvec3 b = positions[triangles[3 * t + 1]];
+		glm::dvec3 c = positions[triangles[3 * t + 2]];
+		glm::dvec3 normal = glm::cross(b - a, c - a);
+		double area = glm::length(normal);
+		if (area > 0.0)
+		{
+			normal /= area;
+			for (unsigned int corner = 0; corner < 3; ++corner)
+				addPlane(quadrics[triangles[3 * t + corner]], normal, -glm::dot(normal, a), 0.5 * area);
+		}
+		for (unsigned int corner = 0; corner < 3; ++corner)
+			adjacency[triangles[3 * t + corner]].push_back((unsigned int)t);
+	}
+
+	std::vector<unsigned int> version(weldedCount, 0);
+	std::vector<bool> removed(weldedCount, false), deadTriangle(triangleCount, false);
+	std::priority_queue<Collapse, std::vector<Collapse>, std::greater<Collapse>> queue;
+
+	auto pushCollapse = [&](unsigned int from, unsigned int to)
+	{
+		if (locked[from] || seam[to])
+			return;
+		Quadric combined = quadrics[from];
+		addQuadric(combined, quadrics[to]);
+		queue.push({ evaluate(combined, positions[to]), from, to, version[from], version[to] });
+	};
+
+	for (size_t t = 0; t < triangleCount; ++t)
+	{
+		for (unsigned int e = 0; e < 3; ++e)
+		{
+			unsigned int a = triangles[3 * t + e], b = triangles[3 * t + (e + 1) % 3];
+			pushCollapse(a, b);
+			pushCollapse(b, a);
+		}
+	}
+
+	size_t liveTriangles = triangleCount;
+	double worstCost = 0.0;
+	while (liveTriangles * 3 > targetIndexCount && !queue.empty())
+	{
+		Collapse collapse = queue.top();
+		queue.pop();
+		unsigned int from = collapse.from, to = collapse.to;
+		if (removed[from] || removed[to] || version[from] != collapse.fromVersion || version[to] != collapse.toVersion)
+			continue;
+
+		//the edge must still exist and no remaining triangle around from may flip over.
+		bool adjacent = false, flips = false;
+		for (unsigned int t : adjacency[from])
+		{
+			if (deadTriangle[t])
+				continue;
+
+			unsigned int* triangle = &triangles[3 * t];
+			if (triangle[0] == to || triangle[1] == to || triangle[2] == to)
+			{
+				adjacent = true;
+				continue;
+			}
+
+			glm::dvec3 before[3], after[3];
+			for (unsigned int corner = 0; corner < 3; ++corner)
+			{
+				before[corner] = positions[triangle[corner]];
+				after[corner] = triangle[corner] == from ? positions[to] : before[corner];
+			}
+			glm::dvec3 normalBefore = glm::cross(before[1] - before[0], before[2] - before[0]);
+			glm::dvec3 normalAfter = glm::cross(after[1] - after[0], after[2] - after[0]);
+			if (glm::dot(normalBefore, normalAfter) <= 0.0)
+			{
+				flips = true;
+				break;
+			}
+		}
+		if (!adjacent || flips)
+			continue;
+
+		for (unsigned int t : adjacency[from])
+		{
+			if (deadTriangle[t])
+				continue;
+
+			unsigned int* triangle = &triangles[3 * t];
+			if (triangle[0] == to || triangle[1] == to || triangle[2] == to)
+			{
+				deadTriangle[t] = true;
+				--liveTriangles;
+				continue;
+			}
+			for (unsigned int corner = 0; corner < 3; ++corner)
+			{
+				if (triangle[corner] == from)
+				{
+					triangle[corner] = to;
+					//targets are never seams, so the single wedge there carries the right attributes.
+					corners[3 * t + corner] = representative[to];
+				}
+			}
+			adjacency[to].push_back(t);
+		}
+
+		addQuadric(quadrics[to], quadrics[from]);
+		removed[from] = true;
+		adjacency[from].clear();
+		++version[to];
+		worstCost = std::max(worstCost, collapse.cost);
+
+		//everything touching to has new costs now.
+		for (unsigned int t : adjacency[to])
+		{
+			if (deadTriangle[t])
+				continue;
+			for (unsigned int corner = 0; corner < 3; ++corner)
+			{
+				unsigned int neighbour = triangles[3 * t + corner];
+				if (neighbour != to)
+				{
+					pushCollapse(neighbour, to);
+					pushCollapse(to, neighbour);
+				}
+			}
+		}
+	}
+
+	std::vector<unsigned int> result;
+	result.reserve(liveTriangles * 3);
+	for (size_t t = 0; t < triangleCount; ++t)
+	{
+		if (!deadTriangle[t])
+			result.insert(result.end(), corners.begin() + 3 * t, corners.begin() + 3 * (t + 1));
+	}
+
+	error = float(std::sqrt(worstCost));
+	return result;
+}
+
+void util::generateLods(MeshData& mesh, unsigned int lodCount)
+{
+	mesh.lods.clear();
+	mesh.lods.push_back({ 0, (uint32_t)mesh.indices.size(), 0.0f, 0 });
+	size_t materialCount = mesh.materials.size();
+	mesh.submeshes.resize(materialCount);
+
+	//every level simplifies the full submesh, so its error is measured against the real surface.
+	std::vector<std::vector<unsigned int>> full(materialCount), previous(materialCount);
+	for (size_t m = 0; m < materialCount; ++m)
+	{
+		const MeshSubmesh& submesh = mesh.submeshes[m];
+		full[m].assign(mesh.indices.begin() + submesh.indexOffset, mesh.indices.begin() + submesh.indexOffset + submesh.indexCount);
+		previous[m] = full[m];
+	}
+
+	size_t previousSize = mesh.indices.size();
+	for (unsigned int lod = 1; lod < lodCount; ++lod)
+	{
+		std::vector<std::vector<unsigned int>> simplified(materialCount);
+		//levels never get more accurate, also when a submesh sits this one out.
+		float lodError = mesh.lods.back().error;
+		size_t size = 0;
+		for (size_t m = 0; m < materialCount; ++m)
+		{
+			float error;
+			simplified[m] = simplifyMesh(mesh, full[m], previous[m].size() / 6 * 3, error);
+			//a small submesh can't lose half its triangles without vanishing, it keeps its last level.
+			if (simplified[m].empty())
+				simplified[m] = previous[m];
+			else
+				lodError = std::max(lodError, error);
+			size += simplified[m].size();
+		}
+
+		//locked seams and borders stall simplification, a level that barely shrinks isn't worth drawing.
+		if (size == 0 || size * 10 > previousSize * 9)
+			break;
+
+		mesh.lods.push_back({ (uint32_t)mesh.indices.size(), (uint32_t)size, lodError, 0 });
+		for (size_t m = 0; m < materialCount; ++m)
+		{
+			optimizeVertexCache(simplified[m], mesh.vertexCount);
+			mesh.submeshes.push_back({ (uint32_t)mesh.indices.size(), (uint32_t)simplified[m].size(), (uint32_t)m, 0, 0 });
+			mesh.indices.insert(mesh.indices.end(), simplified[m].begin(), simplified[m].end());
+			previous[m].swap(simplified[m]);
+		}
+		previousSize = size;
+	}
+}
@@ -0,0 +1,17 @@
+#pragma once
+#include "../config.h"
+#include "objectLoader.h"
+
+namespace util
+{
+	//quadric error metric edge collapse (garland & heckbert) onto existing vertices, so the
+	//result indexes the same vertex buffer. uv/normal seams and open borders stay locked.
+	//error gets the largest collapse error as a distance in mesh units.
+	std::vector<unsigned int> simplifyMesh(const MeshData& mesh, const std::vector<unsigned int>& indices,
+		size_t targetIndexCount, float& error);
+
+	//appends up to lodCount - 1 coarser index buffers after mesh.indices, halving triangles each step,
+	//and fills mesh.lods and their submeshes. every submesh is simplified on its own, so material
+	//borders stay where they are. stops early once simplification stalls.
+	void generateLods(MeshData& mesh, unsigned int lodCount);
+}
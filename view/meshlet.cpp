@@ -0,0 +1,149 @@
+#include "meshlet.h"
+
+namespace
+{
+	glm::vec3 vertexPosition(const MeshData& mesh, unsigned int index)
+	{
+		return glm::make_vec3(&mesh.vertices[8 * index]);
+	}
+
+	void computeBounds(const MeshData& mesh, Meshlet& meshlet)
+	{
+		glm::vec3 boundsMin(std::numeric_limits<float>::max()), boundsMax(-std::numeric_limits<float>::max());
+		glm::vec3 axis(0.0f);
+		std::vector<glm::vec3> normals;
+
+		for (unsigned int i = meshlet.indexOffset; i < meshlet.indexOffset + meshlet.indexCount; i += 3)
+		{
+			glm::vec3 a = vertexPosition(mesh, mesh.indices[i]);
+			glm::vec3 b = vertexPosition(mesh, mesh.indices[i + 1]);
+			glm::vec3 c = vertexPosition(mesh, mesh.indices[i + 2]);
+			boundsMin = glm::min(boundsMin, glm::min(a, glm::min(b, c)));
+			boundsMax = glm::max(boundsMax, glm::max(a, glm::max(b, c)));
+
+			glm::vec3 normal = glm::cross(b - a, c - a);
+			float length = glm::length(normal);
+			//degenerate triangles can't be seen from any side.
+			if (length > 0.0f)
+			{
+				normals.push_back(normal / length);
+				axis += normals.back();
+			}
+		}
+
+		glm::vec3 center = 0.5f * (boundsMin + boundsMax);
+		float radius = 0.0f;
+		for (unsigned int i = meshlet.indexOffset; i < meshlet.indexOffset + meshlet.indexCount; ++i)
+			radius = std::max(radius, glm::length(vertexPosition(mesh, mesh.indices[i]) - center));
+
+		meshlet.sphere[0] = center.x;
+		meshlet.sphere[1] = center.y;
+		meshlet.sphere[2] = center.z;
+		meshlet.sphere[3] = radius;
+
+		float axisLength = glm::length(axis);
+		axis = axisLength > 0.0f ? axis / axisLength : glm::vec3(0.0f, 0.0f, 1.0f);
+		float minDot = 1.0f;
+		for (const glm::vec3& normal : normals)
+			minDot = std::min(minDot, glm::dot(normal, axis));
+
+		meshlet.cone[0] = axis.x;
+		meshlet.cone[1] = axis.y;
+		meshlet.cone[2] = axis.z;
+		//normals spread close to a hemisphere or more, the cone can never cull.
+		//otherwise the backfacing region is the normal cone widened by 90 degrees, sin of its half angle.
+		meshlet.cone[3] = minDot <= 0.1f ? 1.0f : std::sqrt(1.0f - minDot * minDot);
+	}
+
+	//greedy split of the triangles in [begin, end), usedBy has to be shared across calls.
+	void appendMeshlets(const MeshData& mesh, size_t begin, size_t end, std::vector<unsigned int>& usedBy, std::vector<Meshlet>& meshlets)
+	{
+		Meshlet current{};
+		current.indexOffset = (uint32_t)begin;
+		for (size_t i = begin; i + 2 < end; i += 3)
+		{
+			unsigned int newVertices = 0;
+			for (size_t corner = 0; corner < 3; ++corner)
+				newVertices += usedBy[mesh.indices[i + corner]] != meshlets.size() + 1;
+			//a triangle may repeat a vertex, overcounting only closes the meshlet a bit early.
+
+			if (current.vertexCount + newVertices > meshletMaxVertices || current.indexCount / 3 + 1 > meshletMaxTriangles)
+			{
+				computeBounds(mesh, current);
+				meshlets.push_back(current);
+				current = Meshlet{};
+				current.indexOffset = (uint32_t)i;
+			}
+
+			for (size_t corner = 0; corner < 3; ++corner)
+			{
+				unsigned int& stamp = usedBy[mesh.indices[i + corner]];
+				if (stamp != meshlets.size() + 1)
+				{
+					stamp = (unsigned int)meshlets.size() + 1;
+					++current.vertexCount;
+				}
+			}
+			current.indexCount += 3;
+		}
+
+		if (current.indexCount > 0)
+		{
+			computeBounds(mesh, current);
+			meshlets.push_back(current);
+		}
+	}
+}
+
+std::vector<Meshlet> util::buildMeshlets(MeshData& mesh)
+{
+	std::vector<Meshlet> meshlets;
+
+	//marks which vertices the open meshlet already uses, stamped with meshlet number + 1.
+	std::vector<unsigned int> usedBy(mesh.vertexCount, 0);
+
+	//coarser lods are drawn whole, only the full mesh is worth splitting.
+	for (size_t m = 0; m < mesh.materials.size(); ++m)
+	{
+		MeshSubmesh& submesh = mesh.submeshes[m];
+		submesh.meshletOffset = (uint32_t)meshlets.size();
+		appendMeshlets(mesh, submesh.indexOffset, submesh.indexOffset + submesh.indexCount, usedBy, meshlets);
+		submesh.meshletCount = (uint32_t)meshlets.size() - submesh.meshletOffset;
+	}
+
+	return meshlets;
+}
+
+bool util::meshletBackfacing(const Meshlet& meshlet, glm::vec3 cameraPosition)
+{
+	glm::vec3 center = glm::make_vec3(meshlet.sphere);
+	glm::vec3 axis = glm::make_vec3(meshlet.cone);
+	glm::vec3 toCenter = center - cameraPosition;
+	return glm::dot(toCenter, axis) >= meshlet.cone[3] * glm::length(toCenter) + meshlet.sphere[3];
+}
+
+std::array<glm::vec4, 6> util::frustumPlanes(const glm::mat4& transform)
+{
+	//gribb/hartmann, rows of the clip matrix added to and subtracted from the w row.
+	glm::mat4 rows = glm::transpose(transform);
+	std::array<glm::vec4, 6> planes =
+	{
+		rows[3] + rows[0], rows[3] - rows[0],
+		rows[3] + rows[1], rows[3] - rows[1],
+		rows[3] + rows[2], rows[3] - rows[2]
+	};
+
+	for (glm::vec4& plane : planes)
+		plane /= glm::length(glm::vec3(plane));
+	return planes;
+}
+
+bool util::sphereInFrustum(const std::array<glm::vec4, 6>& planes, glm::vec3 center, float radius)
+{
+	for (const glm::vec4& plane : planes)
+	{
+		if (glm::dot(glm::vec3(plane), center) + plane.w < -radius)
+			return false;
+	}
+	return true;
+}
@@ -0,0 +1,35 @@
+#pragma once
+#include "../config.h"
+#include "objectLoader.h"
+
+//limits that suit mesh shader hardware, also keep cpu culling granular enough.
+const unsigned int meshletMaxVertices = 64;
+const unsigned int meshletMaxTriangles = 124;
+
+//a run of triangles in the index buffer with bounds for culling.
+//laid out as four vec4, kept for a future gpu culling pass to read the array as is.
+struct Meshlet
+{
+	//center xyz, radius w.
+	float sphere[4];
+	//axis xyz, cutoff w. the meshlet is backfacing for every camera with
+	//dot(center - camera, axis) >= cutoff * length(center - camera) + radius.
+	float cone[4];
+	uint32_t indexOffset, indexCount, vertexCount, padding;
+	float padding2[4];
+};
+
+namespace util
+{
+	//splits the lod 0 submeshes in their current triangle order, so run it after optimizeMesh.
+	//records the run of meshlets every lod 0 submesh got in mesh.submeshes.
+	std::vector<Meshlet> buildMeshlets(MeshData& mesh);
+
+	//true if no triangle of the meshlet can face a camera at this position, all in mesh space.
+	bool meshletBackfacing(const Meshlet& meshlet, glm::vec3 cameraPosition);
+
+	//normalized planes of projection * view * model, so the tests run in mesh space.
+	std::array<glm::vec4, 6> frustumPlanes(const glm::mat4& transform);
+
+	bool sphereInFrustum(const std::array<glm::vec4, 6>& planes, glm::vec3 center, float radius);
+}
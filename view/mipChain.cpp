@@ -0,0 +1,263 @@
+#include "mipChain.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define MIP_CHAIN_SSE
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+	const int linearSteps = 4096;
+
+	struct GammaTables
+	{
+		float toLinear[256];
+		unsigned char toSrgb[linearSteps];
+
+		GammaTables()
+		{
+			for (int i = 0; i < 256; ++i)
+			{
+				float c = i / 255.0f;
+				toLinear[i] = c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+			}
+			for (int i = 0; i < linearSteps; ++i)
+			{
+				float c = i / float(linearSteps - 1);
+				float srgb = c <= 0.0031308f ? c * 12.92f : 1.055f * std::pow(c, 1.0f / 2.4f) - 0.055f;
+				toSrgb[i] = (unsigned char)(srgb * 255.0f + 0.5f);
+			}
+		}
+	};
+
+	const GammaTables& gammaTables()
+	{
+		static const GammaTables tables;
+		return tables;
+	}
+
+	//source texels and weights of one destination texel along one axis, 2 taps or 3 for odd sizes.
+	struct Taps
+	{
+		int index[3];
+		float weight[3];
+		int count;
+	};
+
+	std::vector<Taps> axisTaps(int sourceSize, int size)
+	{
+		std::vector<Taps> taps(size);
+		for (int i = 0; i < size; ++i)
+		{
+			Taps& tap = taps[i];
+			if (sourceSize == 1)
+				tap = { { 0, 0, 0 }, { 1.0f, 0.0f, 0.0f }, 1 };
+			else if (sourceSize % 2 == 0)
+				tap = { { 2 * i, 2 * i + 1, 0 }, { 0.5f, 0.5f, 0.0f }, 2 };
+			else
+			{
+				//destination texel i covers source [i * w / n, (i + 1) * w / n) with w = 2n + 1.
+				float w = float(sourceSize);
+				tap = { { 2 * i, 2 * i + 1, 2 * i + 2 }, { (size - i) / w, size / w, (i + 1) / w }, 3 };
+			}
+		}
+		return taps;
+	}
+
+	//calls work(begin, end) on disjoint row ranges, side by side once there are enough rows.
+	template <typename Work>
+	void parallelRows(int rows, int rowTexels, Work work)
+	{
+		//small levels aren't worth the thread startup.
+		const int minTexelsPerThread = 1 << 16;
+		int threadCount = int(std::max(1u, std::thread::hardware_concurrency()));
+		threadCount = std::min(threadCount, std::max(1, rows * rowTexels / minTexelsPerThread));
+		threadCount = std::min(threadCount, rows);
+
+		std::vector<std::thread> workers;
+		for (int i = 1; i < threadCount; ++i)
+			workers.emplace_back(work, rows * i / threadCount, rows * (i + 1) / threadCount);
+		work(0, rows / threadCount);
+		for (std::thread& worker : workers)
+			worker.join();
+	}
+
+	//linear rgb and alpha back to rgba8.
+	void encodeTexel(const float* linear, unsigned char* texel)
+	{
+		const GammaTables& tables = gammaTables();
+		for (int c = 0; c < 3; ++c)
+		{
+			float value = std::min(std::max(linear[c], 0.0f), 1.0f);
+			texel[c] = tables.toSrgb[int(value * (linearSteps - 1) + 0.5f)];
+		}
+		texel[3] = (unsigned char)(std::min(std::max(linear[3], 0.0f), 1.0f) * 255.0f + 0.5f);
+	}
+
+#ifdef MIP_CHAIN_SSE
+	void encodeTexel(__m128 linear, unsigned char* texel)
+	{
+		const GammaTables& tables = gammaTables();
+		__m128 clamped = _mm_min_ps(_mm_max_ps(linear, _mm_setzero_ps()), _mm_set1_ps(1.0f));
+		//rgb index the srgb table, alpha is scaled straight to 8 bits.
+		__m128i steps = _mm_cvtps_epi32(_mm_mul_ps(clamped, _mm_setr_ps(linearSteps - 1, linearSteps - 1, linearSteps - 1, 255.0f)));
+		alignas(16) int32_t values[4];
+		_mm_store_si128(reinterpret_cast<__m128i*>(values), steps);
+		texel[0] = tables.toSrgb[values[0]];
+		texel[1] = tables.toSrgb[values[1]];
+		texel[2] = tables.toSrgb[values[2]];
+		texel[3] = (unsigned char)values[3];
+	}
+#endif
+
+	//the common case of even sizes, every destination texel is the plain average of a 2x2 block.
+	void halveRows(const std::vector<float>& source, int sourceWidth, std::vector<float>& destination, MipLevel& level, int begin, int end)
+	{
+		for (int y = begin; y < end; ++y)
+		{
+			const float* row0 = &source[4 * size_t(2 * y) * sourceWidth];
+			const float* row1 = row0 + 4 * size_t(sourceWidth);
+			float* out = &destination[4 * size_t(y) * level.width];
+			unsigned char* texel = &level.pixels[4 * size_t(y) * level.width];
+			for (int x = 0; x < level.width; ++x, row0 += 8, row1 += 8, out += 4, texel += 4)
+			{
+#ifdef MIP_CHAIN_SSE
+				__m128 sum = _mm_add_ps(_mm_add_ps(_mm_loadu_ps(row0), _mm_loadu_ps(row0 + 4)),
+					_mm_add_ps(_mm_loadu_ps(row1), _mm_loadu_ps(row1 + 4)));
+				sum = _mm_mul_ps(sum, _mm_set1_ps(0.25f));
+				_mm_storeu_ps(out, sum);
+				encodeTexel(sum, texel);
+#else
+				for (int c = 0; c < 4; ++c)
+					out[c] = 0.25f * (row0[c] + row0[4 + c] + row1[c] + row1[4 + c]);
+				encodeTexel(out, texel);
+#endif
+			}
+		}
+	}
+
+	//halveRows for level 1 of an even sized image, reading the 8 bit source so it never has to be
+	//expanded to floats as a whole.
+	void halveSourceRows(const unsigned char* source, int sourceWidth, std::vector<float>& destination, MipLevel& level, int begin, int end)
+	{
+		const GammaTables& tables = gammaTables();
+		for (int y = begin; y < end; ++y)
+		{
+			const unsigned char* row0 = &source[4 * size_t(2 * y) * sourceWidth];
+			const unsigned char* row1 = row0 + 4 * size_t(sourceWidth);
+			float* out = &destination[4 * size_t(y) * level.width];
+			unsigned char* texel = &level.pixels[4 * size_t(y) * level.width];
+			for (int x = 0; x < level.width; ++x, row0 += 8, row1 += 8, out += 4, texel += 4)
+			{
+				for (int c = 0; c < 3; ++c)
+					out[c] = 0.25f * (tables.toLinear[row0[c]] + tables.toLinear[row0[4 + c]] + tables.toLinear[row1[c]] + tables.toLinear[row1[4 + c]]);
+				out[3] = (row0[3] + row0[7] + row1[3] + row1[7]) / (4.0f * 255.0f);
+				encodeTexel(out, texel);
+			}
+		}
+	}
+
+	//filters source (4 floats per texel) into destination and its rgba8 encoding.
+	void filterRows(const std::vector<float>& source, int sourceWidth, const std::vector<Taps>& tapsX, const std::vector<Taps>& tapsY,
+		std::vector<float>& destination, MipLevel& level, int begin, int end)
+	{
+		for (int y = begin; y < end; ++y)
+		{
+			const Taps& tapY = tapsY[y];
+			for (int x = 0; x < level.width; ++x)
+			{
+				const Taps& tapX = tapsX[x];
+				float* out = &destination[4 * (size_t(y) * level.width + x)];
+#ifdef MIP_CHAIN_SSE
+				__m128 sum = _mm_setzero_ps();
+				for (int j = 0; j < tapY.count; ++j)
+				{
+					const float* row = &source[4 * size_t(tapY.index[j]) * sourceWidth];
+					__m128 rowSum = _mm_setzero_ps();
+					for (int i = 0; i < tapX.count; ++i)
+						rowSum = _mm_add_ps(rowSum, _mm_mul_ps(_mm_loadu_ps(row + 4 * tapX.index[i]), _mm_set1_ps(tapX.weight[i])));
+					sum = _mm_add_ps(sum, _mm_mul_ps(rowSum, _mm_set1_ps(tapY.weight[j])));
+				}
+				_mm_storeu_ps(out, sum);
+				encodeTexel(sum, &level.pixels[4 * (size_t(y) * level.width + x)]);
+#else
+				out[0] = out[1] = out[2] = out[3] = 0.0f;
+				for (int j = 0; j < tapY.count; ++j)
+				{
+					const float* row = &source[4 * size_t(tapY.index[j]) * sourceWidth];
+					for (int i = 0; i < tapX.count; ++i)
+					{
+						float weight = tapX.weight[i] * tapY.weight[j];
+						for (int c = 0; c < 4; ++c)
+							out[c] += weight * row[4 * tapX.index[i] + c];
+					}
+				}
+				encodeTexel(out, &level.pixels[4 * (size_t(y) * level.width + x)]);
+#endif
+			}
+		}
+	}
+}
+
+int util::mipLevelCount(int width, int height)
+{
+	int levels = 1;
+	while (width > 1 || height > 1)
+	{
+		width = std::max(1, width / 2);
+		height = std::max(1, height / 2);
+		++levels;
+	}
+	return levels;
+}
+
+std::vector<MipLevel> util::buildMipChain(const unsigned char* pixels, int width, int height)
+{
+	std::vector<MipLevel> chain(mipLevelCount(width, height));
+	chain[0].width = width;
+	chain[0].height = height;
+	chain[0].pixels.assign(pixels, pixels + 4 * size_t(width) * height);
+
+	//filtering runs on linear floats, every level is only rounded to 8 bits for its own output.
+	//even sized images decode level 0 on the fly, odd ones need it as floats for the wider taps.
+	const GammaTables& tables = gammaTables();
+	bool evenSource = width % 2 == 0 && height % 2 == 0;
+	std::vector<float> source, destination;
+	if (!evenSource)
+	{
+		source.resize(4 * size_t(width) * height);
+		for (size_t i = 0; i < source.size(); i += 4)
+		{
+			source[i] = tables.toLinear[pixels[i]];
+			source[i + 1] = tables.toLinear[pixels[i + 1]];
+			source[i + 2] = tables.toLinear[pixels[i + 2]];
+			source[i + 3] = pixels[i + 3] / 255.0f;
+		}
+	}
+
+	for (size_t l = 1; l < chain.size(); ++l)
+	{
+		const MipLevel& previous = chain[l - 1];
+		MipLevel& level = chain[l];
+		level.width = std::max(1, previous.width / 2);
+		level.height = std::max(1, previous.height / 2);
+		level.pixels.resize(4 * size_t(level.width) * level.height);
+		destination.resize(4 * size_t(level.width) * level.height);
+
+		std::vector<Taps> tapsX = axisTaps(previous.width, level.width);
+		std::vector<Taps> tapsY = axisTaps(previous.height, level.height);
+		bool even = previous.width % 2 == 0 && previous.height % 2 == 0;
+		parallelRows(level.height, level.width, [&](int begin, int end)
+		{
+			if (l == 1 && evenSource)
+				halveSourceRows(pixels, previous.width, destination, level, begin, end);
+			else if (even)
+				halveRows(source, previous.width, destination, level, begin, end);
+			else
+				filterRows(source, previous.width, tapsX, tapsY, destination, level, begin, end);
+		});
+		source.swap(destination);
+	}
+
+	return chain;
+}
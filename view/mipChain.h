@@ -0,0 +1,20 @@
+#pragma once
+#include "../config.h"
+
+//one rgba8 level of a mip chain, level 0 is the source image.
+struct MipLevel
+{
+	int width, height;
+	std::vector<unsigned char> pixels;
+};
+
+namespace util
+{
+	//levels down to 1x1 for a width x height image.
+	int mipLevelCount(int width, int height);
+
+	//full chain, level 0 included. rgb is treated as srgb and filtered in linear space, alpha as is.
+	//each level halves the previous one with a box filter, odd sizes get 3 tap polyphase weights so
+	//no source texel is dropped. rows of a level are split across all cores.
+	std::vector<MipLevel> buildMipChain(const unsigned char* pixels, int width, int height);
+}
@@ -1,61 +1,491 @@
 #include "objectLoader.h"
+#include "mappedFile.h"
+#include "vertexTransform.h"
 
-std::vector<float> util::objLoadFromFile(const char* filename, glm::mat4 preTransform)
+namespace
 {
-	std::vector<float> vertices;
+	//obj data is plain ascii, so unlike strtof this never looks at the locale.
+	const char* parseFloat(const char* cursor, const char* end, float& value)
+	{
+		bool negative = false;
+		if (cursor < end && (*cursor == '-' || *cursor == '+'))
+			negative = *cursor++ == '-';
+
+		double mantissa = 0.0;
+		while (cursor < end && *cursor >= '0' && *cursor <= '9')
+			mantissa = mantissa * 10.0 + (*cursor++ - '0');
+
+		int exponent = 0;
+		if (cursor < end && *cursor == '.')
+		{
+			++cursor;
+			while (cursor < end && *cursor >= '0' && *cursor <= '9')
+			{
+				mantissa = mantissa * 10.0 + (*cursor++ - '0');
+				--exponent;
+			}
+		}
 
-	tinyobj::attrib_t attributes;
-	std::vector<tinyobj::shape_t> shapes; //vector of all obj shapes.
-	std::vector<tinyobj::material_t> materials; //vector of all material info.
-	std::string warning, error;
+		if (cursor < end && (*cursor == 'e' || *cursor == 'E'))
+		{
+			++cursor;
+			bool negativeExponent = false;
+			if (cursor < end && (*cursor == '-' || *cursor == '+'))
+				negativeExponent = *cursor++ == '-';
+			int written = 0;
+			while (cursor < end && *cursor >= '0' && *cursor <= '9')
+				written = written * 10 + (*cursor++ - '0');
+			exponent += negativeExponent ? -written : written;
+		}
+
+		static const double powers[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9,
+			1e10, 1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+		if (exponent < 0)
+			mantissa = exponent >= -22 ? mantissa / powers[-exponent] : mantissa * std::pow(10.0, exponent);
+		else if (exponent > 0)
+			mantissa = exponent <= 22 ? mantissa * powers[exponent] : mantissa * std::pow(10.0, exponent);
+
+		value = float(negative ? -mantissa : mantissa);
+		return cursor;
+	}
+
+	const char* parseInt(const char* cursor, const char* end, int& value)
+	{
+		bool negative = false;
+		if (cursor < end && (*cursor == '-' || *cursor == '+'))
+			negative = *cursor++ == '-';
+
+		value = 0;
+		while (cursor < end && *cursor >= '0' && *cursor <= '9')
+			value = value * 10 + (*cursor++ - '0');
+		if (negative)
+			value = -value;
+		return cursor;
+	}
+
+	const char* skipSpaces(const char* cursor, const char* end)
+	{
+		while (cursor < end && (*cursor == ' ' || *cursor == '\t'))
+			++cursor;
+		return cursor;
+	}
+
+	const char* skipLine(const char* cursor, const char* end)
+	{
+		while (cursor < end && *cursor != '\n')
+			++cursor;
+		return cursor < end ? cursor + 1 : end;
+	}
+
+	//rest of the line without surrounding whitespace, material names may contain spaces.
+	std::string parseRestOfLine(const char* cursor, const char* end)
+	{
+		cursor = skipSpaces(cursor, end);
+		const char* last = cursor;
+		while (last < end && *last != '\n')
+			++last;
+		while (last > cursor && (last[-1] == ' ' || last[-1] == '\t' || last[-1] == '\r'))
+			--last;
+		return std::string(cursor, last);
+	}
+
+	bool startsWith(const char* cursor, const char* end, const char* keyword)
+	{
+		size_t length = strlen(keyword);
+		return size_t(end - cursor) > length && memcmp(cursor, keyword, length) == 0
+			&& (cursor[length] == ' ' || cursor[length] == '\t');
+	}
+
+	const char* parseFloats(const char* cursor, const char* end, std::vector<float>& out, int count)
+	{
+		for (int i = 0; i < count; ++i)
+		{
+			float value;
+			cursor = parseFloat(skipSpaces(cursor, end), end, value);
+			out.push_back(value);
+		}
+		return cursor;
+	}
 
-	if (!tinyobj::LoadObj(&attributes, &shapes, &materials, &warning, &error, filename))
-		std::cout << warning << error << '\n'; //prints error if attributes failes to get all its data.
+	//turns a 1 based obj index into 0 based, negative ones count back from the current element.
+	int resolveIndex(int index, size_t localCount, unsigned char bit, unsigned char& relative)
+	{
+		if (index > 0)
+			return index - 1;
+		if (index < 0)
+		{
+			relative |= bit;
+			return int(localCount) + index;
+		}
+		return -1;
+	}
 
-	for (const auto& shape : shapes)
+	void parseChunk(const char* cursor, const char* end, ObjChunk& chunk)
 	{
-		for (const auto& index : shape.mesh.indices)
+		std::vector<ObjCorner> polygon;
+		std::vector<unsigned char> polygonRelative;
+
+		while (cursor < end)
 		{
-			//vec4 4by4 transfomation from vec3 of vertices to get the translation aswell.
-			glm::vec4 pos =
+			cursor = skipSpaces(cursor, end);
+			if (cursor + 1 >= end)
+				break;
+
+			if (cursor[0] == 'v' && (cursor[1] == ' ' || cursor[1] == '\t'))
+				cursor = parseFloats(cursor + 1, end, chunk.positions, 3);
+			else if (cursor[0] == 'v' && cursor[1] == 't')
+				cursor = parseFloats(cursor + 2, end, chunk.texCoords, 2);
+			else if (cursor[0] == 'v' && cursor[1] == 'n')
+				cursor = parseFloats(cursor + 2, end, chunk.normals, 3);
+			else if (cursor[0] == 'f' && (cursor[1] == ' ' || cursor[1] == '\t'))
 			{
-				attributes.vertices[3 * index.vertex_index],
-				attributes.vertices[3 * index.vertex_index + 1],
-				attributes.vertices[3 * index.vertex_index + 2],
-				1 
-			};
+				polygon.clear();
+				polygonRelative.clear();
+				cursor = skipSpaces(cursor + 1, end);
+				//corners are v, v/vt, v//vn or v/vt/vn.
+				while (cursor < end && *cursor != '\n' && *cursor != '\r')
+				{
+					int position = 0, texCoord = 0, normal = 0;
+					cursor = parseInt(cursor, end, position);
+					if (cursor < end && *cursor == '/')
+					{
+						++cursor;
+						if (cursor < end && *cursor != '/')
+							cursor = parseInt(cursor, end, texCoord);
+						if (cursor < end && *cursor == '/')
+							cursor = parseInt(cursor + 1, end, normal);
+					}
+
+					unsigned char relative = 0;
+					ObjCorner corner;
+					corner.position = resolveIndex(position, chunk.positions.size() / 3, 1, relative);
+					corner.texCoord = resolveIndex(texCoord, chunk.texCoords.size() / 2, 2, relative);
+					corner.normal = resolveIndex(normal, chunk.normals.size() / 3, 4, relative);
+					polygon.push_back(corner);
+					polygonRelative.push_back(relative);
 
-			pos = preTransform * pos;
+					cursor = skipSpaces(cursor, end);
+					//anything that isn't an index ends the face.
+					if (cursor < end && !(*cursor == '-' || (*cursor >= '0' && *cursor <= '9')))
+						break;
+				}
 
-			//normal we only need 3by3 since we are just interested in scaling and rotation normals.
-			glm::vec3 normal =
+				for (size_t i = 2; i < polygon.size(); ++i)
+				{
+					size_t fan[3] = { 0, i - 1, i };
+					for (size_t corner : fan)
+					{
+						chunk.corners.push_back(polygon[corner]);
+						chunk.relative.push_back(polygonRelative[corner]);
+					}
+				}
+			}
+			else if (startsWith(cursor, end, "usemtl"))
+				chunk.materialRuns.emplace_back(chunk.corners.size() / 3, parseRestOfLine(cursor + 6, end));
+			else if (startsWith(cursor, end, "mtllib"))
 			{
-				attributes.normals[3 * index.normal_index],
-				attributes.normals[3 * index.normal_index + 1],
-				attributes.normals[3 * index.normal_index + 2]				
-			};
-			//normalize to allow scaling etc without throwing lighting.
-			normal = glm::normalize(glm::mat3(preTransform) * normal); 
+				std::istringstream names(parseRestOfLine(cursor + 6, end));
+				std::string name;
+				while (names >> name)
+					chunk.materialLibraries.push_back(name);
+			}
 
+			cursor = skipLine(cursor, end);
+		}
+	}
+
+	//copies into a fixed size field, false if it had to be cut short.
+	template <size_t size>
+	bool copyName(char (&field)[size], const std::string& name)
+	{
+		size_t length = std::min(name.size(), size - 1);
+		memcpy(field, name.data(), length);
+		field[length] = '\0';
+		return length == name.size();
+	}
 
-			glm::vec2 texCoord =
+	//stable counting sort of the triangles by material, one lod 0 submesh per material.
+	void groupByMaterial(MeshData& mesh, const std::vector<uint32_t>& triangleMaterials)
+	{
+		mesh.submeshes.assign(mesh.materials.size(), MeshSubmesh{});
+		for (uint32_t material : triangleMaterials)
+			mesh.submeshes[material].indexCount += 3;
+
+		uint32_t offset = 0;
+		for (uint32_t m = 0; m < mesh.submeshes.size(); ++m)
+		{
+			mesh.submeshes[m].indexOffset = offset;
+			mesh.submeshes[m].material = m;
+			offset += mesh.submeshes[m].indexCount;
+		}
+
+		std::vector<unsigned int> grouped(mesh.indices.size());
+		std::vector<uint32_t> next(mesh.submeshes.size());
+		for (uint32_t m = 0; m < mesh.submeshes.size(); ++m)
+			next[m] = mesh.submeshes[m].indexOffset;
+		for (size_t t = 0; t < triangleMaterials.size(); ++t)
+		{
+			uint32_t& cursor = next[triangleMaterials[t]];
+			memcpy(&grouped[cursor], &mesh.indices[3 * t], 3 * sizeof(unsigned int));
+			cursor += 3;
+		}
+		mesh.indices.swap(grouped);
+	}
+
+	//fills in the used materials from the mtl libraries, names they don't define stay white.
+	void loadMaterials(const char* filename, const std::vector<std::string>& libraries, MeshData& mesh)
+	{
+		//mtl and texture paths are relative to the obj.
+		std::string path(filename);
+		std::string directory = path.substr(0, path.find_last_of("/\\") + 1);
+
+		std::map<std::string, int> materialIds;
+		std::vector<tinyobj::material_t> materials;
+		for (const std::string& library : libraries)
+		{
+			std::string libraryPath = directory + library;
+			std::ifstream stream(libraryPath);
+			if (!stream)
 			{
-				attributes.texcoords[2 * index.texcoord_index],
-				attributes.texcoords[2 * index.texcoord_index + 1]			
-			};
+				std::cout << "Failed to open mtl " << libraryPath << '\n';
+				continue;
+			}
+			std::string warning, error;
+			tinyobj::LoadMtl(&materialIds, &materials, &stream, &warning, &error);
+			mesh.materialLibraries.push_back(libraryPath);
+		}
 
-			vertices.push_back(pos.x);
-			vertices.push_back(pos.y);
-			vertices.push_back(pos.z);
-			vertices.push_back(texCoord.x);
-			vertices.push_back(texCoord.y);
-			vertices.push_back(normal.x);
-			vertices.push_back(normal.x);
-			vertices.push_back(normal.x);
+		for (MeshMaterial& material : mesh.materials)
+		{
+			auto found = materialIds.find(material.name);
+			if (found == materialIds.end())
+			{
+				if (material.name[0])
+					std::cout << "Obj " << filename << " uses undefined material " << material.name << '\n';
+				continue;
+			}
+
+			const tinyobj::material_t& source = materials[found->second];
+			for (int i = 0; i < 3; ++i)
+				material.diffuse[i] = source.diffuse[i];
+			if (!source.diffuse_texname.empty() && !copyName(material.diffuseTexture, directory + source.diffuse_texname))
+			{
+				std::cout << "Texture path of material " << material.name << " is too long\n";
+				material.diffuseTexture[0] = '\0';
+			}
 		}
 	}
 
-	return vertices;
+	//splits the file at line starts into one slice per core and parses them side by side.
+	void parseObj(const char* data, size_t size, ObjChunk& merged)
+	{
+		size_t threadCount = std::max(1u, std::thread::hardware_concurrency());
+		//small files aren't worth the thread startup.
+		const size_t minChunkSize = 1 << 20;
+		threadCount = std::min(threadCount, std::max<size_t>(1, size / minChunkSize));
+
+		std::vector<const char*> starts(threadCount + 1);
+		starts[0] = data;
+		starts[threadCount] = data + size;
+		for (size_t i = 1; i < threadCount; ++i)
+		{
+			const char* cursor = std::max(starts[i - 1], data + size * i / threadCount);
+			if (cursor > data && cursor[-1] != '\n')
+				cursor = skipLine(cursor, data + size);
+			starts[i] = cursor;
+		}
+
+		std::vector<ObjChunk> chunks(threadCount);
+		std::vector<std::thread> workers;
+		for (size_t i = 1; i < threadCount; ++i)
+			workers.emplace_back(parseChunk, starts[i], starts[i + 1], std::ref(chunks[i]));
+		parseChunk(starts[0], starts[1], chunks[0]);
+		for (std::thread& worker : workers)
+			worker.join();
+
+		size_t positionCount = 0, texCoordCount = 0, normalCount = 0, cornerCount = 0;
+		for (const ObjChunk& chunk : chunks)
+		{
+			positionCount += chunk.positions.size();
+			texCoordCount += chunk.texCoords.size();
+			normalCount += chunk.normals.size();
+			cornerCount += chunk.corners.size();
+		}
+		merged.positions.reserve(positionCount);
+		merged.texCoords.reserve(texCoordCount);
+		merged.normals.reserve(normalCount);
+		merged.corners.reserve(cornerCount);
+
+		for (ObjChunk& chunk : chunks)
+		{
+			//elements of all earlier chunks, the base for relative indices.
+			int positionBase = int(merged.positions.size() / 3);
+			int texCoordBase = int(merged.texCoords.size() / 2);
+			int normalBase = int(merged.normals.size() / 3);
+
+			for (const std::pair<size_t, std::string>& run : chunk.materialRuns)
+				merged.materialRuns.emplace_back(run.first + merged.corners.size() / 3, run.second);
+			merged.materialLibraries.insert(merged.materialLibraries.end(), chunk.materialLibraries.begin(), chunk.materialLibraries.end());
+
+			for (size_t i = 0; i < chunk.corners.size(); ++i)
+			{
+				ObjCorner corner = chunk.corners[i];
+				if (chunk.relative[i] & 1)
+					corner.position += positionBase;
+				if (chunk.relative[i] & 2)
+					corner.texCoord += texCoordBase;
+				if (chunk.relative[i] & 4)
+					corner.normal += normalBase;
+				merged.corners.push_back(corner);
+			}
+
+			merged.positions.insert(merged.positions.end(), chunk.positions.begin(), chunk.positions.end());
+			merged.texCoords.insert(merged.texCoords.end(), chunk.texCoords.begin(), chunk.texCoords.end());
+			merged.normals.insert(merged.normals.end(), chunk.normals.begin(), chunk.normals.end());
+			chunk = ObjChunk();
+		}
+	}
+}
+
+void util::objParseChunk(const char* begin, const char* end, ObjChunk& chunk)
+{
+	parseChunk(begin, end, chunk);
 }
 
+const char* util::objNextLine(const char* cursor, const char* end)
+{
+	return skipLine(cursor, end);
+}
+
+MeshData util::objLoadFromFile(const char* filename, glm::mat4 preTransform)
+{
+	MeshData mesh;
+	mesh.vertexCount = 0;
+	mesh.layout = floatVertexLayout();
+	mesh.boundsMin = glm::vec3(std::numeric_limits<float>::max());
+	mesh.boundsMax = glm::vec3(-std::numeric_limits<float>::max());
+
+	ObjChunk obj;
+	mappedFile file = mapFile(filename);
+	if (!file.data)
+		std::cout << "Failed to open obj " << filename << '\n';
+	else
+		parseObj(reinterpret_cast<const char*>(file.data), file.size, obj);
+	util::unmapFile(file);
+
+	int positionCount = int(obj.positions.size() / 3);
+	int texCoordCount = int(obj.texCoords.size() / 2);
+	int normalCount = int(obj.normals.size() / 3);
+
+	//every obj position and normal is transformed once, before corners get to share them.
+	util::transformPositions(obj.positions.data(), positionCount, preTransform);
+	util::transformNormals(obj.normals.data(), normalCount, preTransform);
+	glm::vec3 defaultNormal = glm::normalize(glm::mat3(preTransform) * glm::vec3(0.0f, 0.0f, 1.0f));
 
+	//maps every unique index triple to its slot in the vertex buffer.
+	std::unordered_map<ObjCorner, unsigned int, CornerHash, CornerEqual> uniqueVertices;
+	std::vector<ObjCorner> vertexCorners;
+	mesh.indices.reserve(obj.corners.size());
+
+	for (const ObjCorner& corner : obj.corners)
+	{
+		if (corner.position < 0 || corner.position >= positionCount)
+		{
+			std::cout << "Obj " << filename << " references missing vertex " << corner.position + 1 << '\n';
+			mesh.indices.push_back(0);
+			continue;
+		}
+
+		auto inserted = uniqueVertices.emplace(corner, (unsigned int)vertexCorners.size());
+		if (inserted.second)
+			vertexCorners.push_back(corner);
+		mesh.indices.push_back(inserted.first->second);
+	}
+
+	//output is sized up front, each vertex is a straight copy of already transformed data.
+	mesh.vertexCount = (unsigned int)vertexCorners.size();
+	mesh.vertices.resize(8 * vertexCorners.size());
+	for (size_t v = 0; v < vertexCorners.size(); ++v)
+	{
+		const ObjCorner& corner = vertexCorners[v];
+		float* vertex = &mesh.vertices[8 * v];
+
+		const float* position = &obj.positions[3 * corner.position];
+		vertex[0] = position[0];
+		vertex[1] = position[1];
+		vertex[2] = position[2];
+		mesh.boundsMin = glm::min(mesh.boundsMin, glm::make_vec3(position));
+		mesh.boundsMax = glm::max(mesh.boundsMax, glm::make_vec3(position));
+
+		bool hasTexCoord = corner.texCoord >= 0 && corner.texCoord < texCoordCount;
+		vertex[3] = hasTexCoord ? obj.texCoords[2 * corner.texCoord] : 0.0f;
+		vertex[4] = hasTexCoord ? obj.texCoords[2 * corner.texCoord + 1] : 0.0f;
+
+		const float* normal = corner.normal >= 0 && corner.normal < normalCount
+			? &obj.normals[3 * corner.normal] : glm::value_ptr(defaultNormal);
+		vertex[5] = normal[0];
+		vertex[6] = normal[1];
+		vertex[7] = normal[2];
+	}
+
+	//an index to a missing vertex still has to point somewhere valid.
+	if (mesh.vertexCount == 0)
+		mesh.indices.clear();
+
+	//material ids go by first use, triangles before the first usemtl get the unnamed material.
+	std::vector<uint32_t> triangleMaterials(mesh.indices.size() / 3);
+	std::unordered_map<std::string, uint32_t> materialIds;
+	const std::string unnamed;
+	const std::string* name = &unnamed;
+	const std::string* lastName = nullptr;
+	uint32_t material = 0;
+	size_t run = 0;
+	for (size_t t = 0; t < triangleMaterials.size(); ++t)
+	{
+		while (run < obj.materialRuns.size() && obj.materialRuns[run].first <= t)
+			name = &obj.materialRuns[run++].second;
+		if (name != lastName)
+		{
+			auto inserted = materialIds.emplace(*name, uint32_t(mesh.materials.size()));
+			if (inserted.second)
+			{
+				MeshMaterial created{};
+				if (!copyName(created.name, *name))
+					std::cout << "Material name " << *name << " is too long\n";
+				created.diffuse[0] = created.diffuse[1] = created.diffuse[2] = 1.0f;
+				mesh.materials.push_back(created);
+			}
+			material = inserted.first->second;
+			lastName = name;
+		}
+		triangleMaterials[t] = material;
+	}
+	if (mesh.materials.empty())
+	{
+		MeshMaterial created{};
+		created.diffuse[0] = created.diffuse[1] = created.diffuse[2] = 1.0f;
+		mesh.materials.push_back(created);
+	}
+
+	groupByMaterial(mesh, triangleMaterials);
+	loadMaterials(filename, obj.materialLibraries, mesh);
+
+	mesh.indexType = mesh.vertexCount <= 65536 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+	if (mesh.vertexCount == 0)
+		mesh.boundsMin = mesh.boundsMax = glm::vec3(0.0f);
+
+	return mesh;
+}
+
+VertexLayout util::floatVertexLayout()
+{
+	VertexLayout layout{};
+	layout.stride = 8 * sizeof(float);
+	layout.attributes[0] = { 3, GL_FLOAT, GL_FALSE, 0 };
+	layout.attributes[1] = { 2, GL_FLOAT, GL_FALSE, 3 * sizeof(float) };
+	layout.attributes[2] = { 3, GL_FLOAT, GL_FALSE, 5 * sizeof(float) };
+	for (int i = 0; i < 3; ++i)
+		layout.positionScale[i] = 1.0f;
+	layout.texCoordScale[0] = layout.texCoordScale[1] = 1.0f;
+	return layout;
+}
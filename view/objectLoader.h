@@ -1,8 +1,123 @@
 #pragma once
 #include "../config.h"
 
+//where one attribute lives inside an interleaved vertex, matches glVertexArrayAttribFormat.
+struct VertexAttribute
+{
+	uint32_t components, type, normalized, offset;
+};
+
+//attribute 0 is position, 1 texcoord, 2 normal; same as the shader locations.
+//quantized attributes are decoded in the vertex shader as offset + scale * value.
+struct VertexLayout
+{
+	uint32_t stride;
+	VertexAttribute attributes[3];
+	float positionOffset[3], positionScale[3];
+	float texCoordOffset[2], texCoordScale[2];
+	uint32_t octahedralNormals;
+};
+
+//one level of detail, a range of the shared index buffer.
+//error is the simplification error in mesh units, 0 for the full resolution mesh.
+struct MeshLod
+{
+	uint32_t indexOffset, indexCount;
+	float error;
+	uint32_t padding;
+};
+
+//what a submesh is drawn with, from the obj's mtllib. fixed size so it can be baked as is.
+struct MeshMaterial
+{
+	char name[64];
+	//relative to the working directory, empty without a map_Kd.
+	char diffuseTexture[192];
+	float diffuse[3];
+};
+
+//the triangles of one lod that use one material, a range of the shared index buffer.
+//meshlets only exist for lod 0 and never cross submeshes, meshletCount is 0 for coarser lods.
+struct MeshSubmesh
+{
+	uint32_t indexOffset, indexCount, material, meshletOffset, meshletCount;
+};
+
+//deduplicated mesh, vertices are interleaved pos(3), texcoord(2), normal(3).
+struct MeshData
+{
+	std::vector<float> vertices;
+	std::vector<unsigned int> indices;
+	unsigned int vertexCount;
+	//GL_UNSIGNED_SHORT when every index fits in 16 bits, otherwise GL_UNSIGNED_INT.
+	unsigned int indexType;
+	VertexLayout layout;
+	glm::vec3 boundsMin, boundsMax;
+	//empty until generateLods, lod 0 always starts at index 0.
+	std::vector<MeshLod> lods;
+	//at least one, triangles without a usemtl get a white untextured material.
+	std::vector<MeshMaterial> materials;
+	//grouped by lod, then by material: submeshes[lod * materials.size() + material].
+	//optimizeMesh, generateLods and buildMeshlets keep every triangle inside its submesh.
+	std::vector<MeshSubmesh> submeshes;
+	//the .mtl files materials were read from, a bake made from them is stale once they change.
+	std::vector<std::string> materialLibraries;
+};
+
+//one face corner, indices are 0 based and -1 when the attribute is missing.
+struct ObjCorner
+{
+	int position, texCoord, normal;
+};
+
+//face corners with the same (position, texcoord, normal) triple become one vertex.
+struct CornerHash
+{
+	size_t operator()(const ObjCorner& corner) const
+	{
+		size_t hash = std::hash<int>()(corner.position);
+		hash = hash * 31 + std::hash<int>()(corner.texCoord);
+		hash = hash * 31 + std::hash<int>()(corner.normal);
+		return hash;
+	}
+};
+
+struct CornerEqual
+{
+	bool operator()(const ObjCorner& a, const ObjCorner& b) const
+	{
+		return a.position == b.position
+			&& a.texCoord == b.texCoord
+			&& a.normal == b.normal;
+	}
+};
+
+//everything one thread parsed out of its slice of the file.
+struct ObjChunk
+{
+	std::vector<float> positions, texCoords, normals;
+	//3 corners per triangle, polygons are fanned.
+	std::vector<ObjCorner> corners;
+	//bit 0/1/2 set when position/texcoord/normal was a negative obj index,
+	//those are relative to this chunk and get the counts of earlier chunks added on merge.
+	std::vector<unsigned char> relative;
+	//usemtl switches, the material holds from firstTriangle until the next switch.
+	//firstTriangle is relative to this chunk until the merge.
+	std::vector<std::pair<size_t, std::string>> materialRuns;
+	//mtllib names as written, relative to the obj.
+	std::vector<std::string> materialLibraries;
+};
 
 namespace util
 {
-	std::vector<float> objLoadFromFile(const char* filename, glm::mat4 preTransform);
+	MeshData objLoadFromFile(const char* filename, glm::mat4 preTransform);
+
+	//parses the records of [begin, end) into chunk, begin has to be the start of a line.
+	//used to stream files too large to parse in one go, see objLoadFromFile for the merge.
+	void objParseChunk(const char* begin, const char* end, ObjChunk& chunk);
+	//start of the line after cursor, or end.
+	const char* objNextLine(const char* cursor, const char* end);
+
+	//layout of the vertices objLoadFromFile produces.
+	VertexLayout floatVertexLayout();
 }
@@ -3,29 +3,117 @@
 
 ObjectMesh::ObjectMesh(MeshCreateInfo* createInfo)
 {
-	std::vector<float> vertices = util::objLoadFromFile(
+	//baked file sits next to the obj, e.g. models/cube.obj.mesh.
+	std::string bakedFilename = std::string(createInfo->filename) + ".mesh";
+
+	MeshBakeSettings settings = util::meshBakeSettings(createInfo);
+
+	mappedFile baked = util::mapFile(bakedFilename.c_str());
+	MeshView bakedView;
+	std::vector<unsigned char> decodedVertices, decodedIndices;
+	if (util::bakedMeshIsCurrent(baked, createInfo->filename, settings)
+		&& util::bakedMeshView(baked, bakedView, decodedVertices, decodedIndices))
+	{
+		//fast path, the mapped or decoded streams go straight to the gpu.
+		upload(bakedView);
+		util::unmapFile(baked);
+		return;
+	}
+	//close the stale mapping before the file gets rewritten.
+	util::unmapFile(baked);
+
+	MeshData mesh = util::objLoadFromFile(
 		createInfo->filename, 
 		createInfo->preTransform);
 
-	vertexCount = int(vertices.size()) / 8;
+	if (createInfo->optimize)
+		util::optimizeMesh(mesh, createInfo->filename);
+
+	if (createInfo->lodCount > 1)
+		util::generateLods(mesh, createInfo->lodCount);
+
+	std::vector<Meshlet> meshletData;
+	if (createInfo->buildMeshlets)
+		meshletData = util::buildMeshlets(mesh);
+
+	std::vector<unsigned char> vertices = util::packVertices(mesh, createInfo->format);
+
+	if (!util::bakedMeshWrite(bakedFilename.c_str(), createInfo->filename, settings, mesh, vertices, meshletData))
+		std::cout << "Failed to write baked mesh " << bakedFilename << '\n';
+
+	std::vector<unsigned char> indices = util::packIndices(mesh);
+	MeshView view;
+	view.vertices = vertices.data();
+	view.indices = indices.data();
+	view.vertexBytes = vertices.size();
+	view.indexBytes = indices.size();
+	view.vertexCount = mesh.vertexCount;
+	view.indexCount = (unsigned int)mesh.indices.size();
+	view.indexType = mesh.indexType;
+	view.layout = mesh.layout;
+	view.boundsMin = mesh.boundsMin;
+	view.boundsMax = mesh.boundsMax;
+	view.meshlets = meshletData.data();
+	view.meshletCount = meshletData.size();
+	view.lods = mesh.lods.data();
+	view.lodCount = mesh.lods.size();
+	view.materials = mesh.materials.data();
+	view.materialCount = mesh.materials.size();
+	view.submeshes = mesh.submeshes.data();
+	view.submeshCount = mesh.submeshes.size();
+	upload(view);
+}
+
+void ObjectMesh::upload(const MeshView& mesh)
+{
+	vertexCount = mesh.vertexCount;
+	indexCount = mesh.indexCount;
+	indexType = mesh.indexType;
+	boundsMin = mesh.boundsMin;
+	boundsMax = mesh.boundsMax;
+	layout = mesh.layout;
+
 	glCreateBuffers(1, &VBO);
+	glCreateBuffers(1, &EBO);
 	glCreateVertexArrays(1, &VAO);
-	glVertexArrayVertexBuffer(VAO, 0, VBO, 0, 8 * sizeof(float));
-	glNamedBufferStorage(VBO, vertices.size() * sizeof(float), vertices.data(), GL_DYNAMIC_STORAGE_BIT);
+	glVertexArrayVertexBuffer(VAO, 0, VBO, 0, mesh.layout.stride);
+	glVertexArrayElementBuffer(VAO, EBO);
+	glNamedBufferStorage(VBO, mesh.vertexBytes, mesh.vertices, GL_DYNAMIC_STORAGE_BIT);
+	glNamedBufferStorage(EBO, mesh.indexBytes, mesh.indices, GL_DYNAMIC_STORAGE_BIT);
+
+	meshlets.assign(mesh.meshlets, mesh.meshlets + mesh.meshletCount);
+
+	lods.assign(mesh.lods, mesh.lods + mesh.lodCount);
+	if (lods.empty())
+		lods.push_back({ 0, indexCount, 0.0f, 0 });
+	materials.assign(mesh.materials, mesh.materials + mesh.materialCount);
+	submeshes.assign(mesh.submeshes, mesh.submeshes + mesh.submeshCount);
+
 	//pos: 0, texcoord: 1, normal: 2; all needs declaration in shader even if not used to dispaly model.
-	glEnableVertexArrayAttrib(VAO, 0);
-	glEnableVertexArrayAttrib(VAO, 1);
-	glEnableVertexArrayAttrib(VAO, 2);
-	glVertexArrayAttribFormat(VAO, 0, 3, GL_FLOAT, GL_FALSE, 0); 
-	glVertexArrayAttribFormat(VAO, 1, 2, GL_FLOAT, GL_FALSE, 3 * sizeof(float));
-	glVertexArrayAttribFormat(VAO, 2, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(float));
-	glVertexArrayAttribBinding(VAO, 0, 0);
-	glVertexArrayAttribBinding(VAO, 1, 0);
-	glVertexArrayAttribBinding(VAO, 2, 0);	
+	for (unsigned int i = 0; i < 3; ++i)
+	{
+		const VertexAttribute& attribute = mesh.layout.attributes[i];
+		glEnableVertexArrayAttrib(VAO, i);
+		glVertexArrayAttribFormat(VAO, i, attribute.components, attribute.type, attribute.normalized, attribute.offset);
+		glVertexArrayAttribBinding(VAO, i, 0);
+	}
+}
+
+MeshBakeSettings util::meshBakeSettings(MeshCreateInfo* createInfo)
+{
+	MeshBakeSettings settings{};
+	memcpy(settings.preTransform, glm::value_ptr(createInfo->preTransform), sizeof(settings.preTransform));
+	settings.optimize = createInfo->optimize;
+	settings.format = createInfo->format;
+	settings.buildMeshlets = createInfo->buildMeshlets;
+	settings.lodCount = createInfo->lodCount;
+	settings.compress = createInfo->compress;
+	return settings;
 }
 
 ObjectMesh::~ObjectMesh()
 {
 	glDeleteBuffers(1, &VBO);
+	glDeleteBuffers(1, &EBO);
 	glDeleteVertexArrays(1, &VAO);
 }
@@ -1,18 +1,48 @@
 #pragma once
 #include "../config.h"
 #include "objectLoader.h"
+#include "bakedMesh.h"
+#include "meshOptimizer.h"
 
 struct MeshCreateInfo
 {
 	const char* filename;
 	glm::mat4 preTransform;
+	//reorder for vertex cache, overdraw and fetch locality before upload.
+	bool optimize;
+	VertexFormat format;
+	//split into meshlets for cluster culling, needs the optimized triangle order to be any good.
+	bool buildMeshlets;
+	//levels of detail including the full mesh, 1 or less keeps just the full mesh.
+	unsigned int lodCount;
+	//store the baked vertex and index streams compressed, they're decoded on load.
+	bool compress;
 };
 
 class ObjectMesh
 {
 public:
-	unsigned int VBO, VAO, vertexCount;
+	unsigned int VBO, EBO, VAO, vertexCount, indexCount, indexType;
+	//culled on the cpu in Engine::drawQueue, empty if the mesh has none.
+	std::vector<Meshlet> meshlets;
+	//always holds at least the full mesh as lod 0.
+	std::vector<MeshLod> lods;
+	std::vector<MeshMaterial> materials;
+	//submeshes[lod * materials.size() + material], see MeshData.
+	std::vector<MeshSubmesh> submeshes;
+	glm::vec3 boundsMin, boundsMax;
+	//also carries the dequantization constants for the vertex shader.
+	VertexLayout layout;
 
 	ObjectMesh(MeshCreateInfo* createInfo);
 	~ObjectMesh();	
-};
\ No newline at end of file
+
+private:
+	void upload(const MeshView& mesh);
+};
+
+namespace util
+{
+	//everything in createInfo besides the filename, as compared against baked files.
+	MeshBakeSettings meshBakeSettings(MeshCreateInfo* createInfo);
+}
\ No newline at end of file
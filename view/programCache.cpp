@@ -0,0 +1,106 @@
+#include "programCache.h"
+
+namespace
+{
+	const char programCacheMagic[4] = { 'P', 'R', 'O', 'G' };
+
+	uint64_t fnv1a(uint64_t hash, const void* data, size_t size)
+	{
+		const unsigned char* bytes = static_cast<const unsigned char*>(data);
+		for (size_t i = 0; i < size; ++i)
+		{
+			hash ^= bytes[i];
+			hash *= 1099511628211ull;
+		}
+		return hash;
+	}
+
+	//hashes the terminator too, so "ab" + "c" and "a" + "bc" differ.
+	uint64_t fnv1a(uint64_t hash, const char* text)
+	{
+		return text ? fnv1a(hash, text, strlen(text) + 1) : fnv1a(hash, "", 1);
+	}
+}
+
+uint64_t util::programCacheKey(const std::string& vertexSource, const std::string& fragmentSource, const char* defines)
+{
+	int formatCount = 0;
+	glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formatCount);
+	if (formatCount <= 0)
+		return 0;
+	std::vector<int> formats(formatCount);
+	glGetIntegerv(GL_PROGRAM_BINARY_FORMATS, formats.data());
+
+	uint64_t hash = 14695981039346656037ull;
+	hash = fnv1a(hash, vertexSource.c_str());
+	hash = fnv1a(hash, fragmentSource.c_str());
+	hash = fnv1a(hash, defines);
+	hash = fnv1a(hash, reinterpret_cast<const char*>(glGetString(GL_VENDOR)));
+	hash = fnv1a(hash, reinterpret_cast<const char*>(glGetString(GL_RENDERER)));
+	hash = fnv1a(hash, reinterpret_cast<const char*>(glGetString(GL_VERSION)));
+	hash = fnv1a(hash, formats.data(), formats.size() * sizeof(int));
+	//0 means no cache.
+	return hash ? hash : 1;
+}
+
+std::string util::programCacheFilename(const char* vertexFilepath, uint64_t key)
+{
+	std::stringstream filename;
+	filename << vertexFilepath << '.' << std::hex << std::setw(16) << std::setfill('0') << key << ".program";
+	return filename.str();
+}
+
+unsigned int util::programCacheRead(const char* cacheFilename, uint64_t key)
+{
+	std::ifstream file(cacheFilename, std::ios::binary);
+	ProgramCacheHeader header{};
+	file.read(reinterpret_cast<char*>(&header), sizeof(header));
+	if (!file || memcmp(header.magic, programCacheMagic, sizeof(header.magic)) != 0
+		|| header.version != programCacheVersion || header.key != key || header.binaryBytes == 0)
+		return 0;
+
+	//a truncated write must never reach the driver.
+	std::vector<char> binary(header.binaryBytes);
+	file.read(binary.data(), binary.size());
+	if (!file)
+		return 0;
+
+	unsigned int program = glCreateProgram();
+	glProgramBinary(program, header.binaryFormat, binary.data(), int(binary.size()));
+	//drivers may reject a binary for any reason, a full compile fixes it.
+	int success;
+	glGetProgramiv(program, GL_LINK_STATUS, &success);
+	if (!success)
+	{
+		glDeleteProgram(program);
+		return 0;
+	}
+	return program;
+}
+
+bool util::programCacheWrite(const char* cacheFilename, uint64_t key, unsigned int program)
+{
+	int binaryBytes = 0;
+	glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &binaryBytes);
+	if (binaryBytes <= 0)
+		return false;
+
+	ProgramCacheHeader header{};
+	memcpy(header.magic, programCacheMagic, sizeof(header.magic));
+	header.version = programCacheVersion;
+	header.key = key;
+	std::vector<char> binary(binaryBytes);
+	GLenum binaryFormat;
+	glGetProgramBinary(program, binaryBytes, &binaryBytes, &binaryFormat, binary.data());
+	if (binaryBytes <= 0)
+		return false;
+	header.binaryFormat = binaryFormat;
+	header.binaryBytes = uint32_t(binaryBytes);
+
+	std::ofstream file(cacheFilename, std::ios::binary | std::ios::trunc);
+	if (!file)
+		return false;
+	file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	file.write(binary.data(), binaryBytes);
+	return bool(file);
+}
@@ -0,0 +1,32 @@
+#pragma once
+#include "../config.h"
+
+//bump whenever the layout of ProgramCacheHeader changes.
+const uint32_t programCacheVersion = 1;
+
+//start of every cached program binary, the glGetProgramBinary bytes follow.
+struct ProgramCacheHeader
+{
+	char magic[4];
+	uint32_t version;
+	//programCacheKey of what the binary was linked from.
+	uint64_t key;
+	uint32_t binaryFormat, binaryBytes;
+};
+
+namespace util
+{
+	//fnv-1a of both sources, the defines and the driver's vendor, renderer, version and binary
+	//formats, so a driver update or a changed variant never picks up a stale binary.
+	//0 when the driver has no binary formats to offer.
+	uint64_t programCacheKey(const std::string& vertexSource, const std::string& fragmentSource, const char* defines);
+	//where the binary of key is cached: next to the vertex shader with the key in the name, so every
+	//variant gets its own file.
+	std::string programCacheFilename(const char* vertexFilepath, uint64_t key);
+
+	//a linked program from the cached binary, 0 if there is none, it's for another key or the driver
+	//rejects it. the caller compiles from source then.
+	unsigned int programCacheRead(const char* cacheFilename, uint64_t key);
+	//stores the binary of a program linked with GL_PROGRAM_BINARY_RETRIEVABLE_HINT.
+	bool programCacheWrite(const char* cacheFilename, uint64_t key, unsigned int program);
+}
@@ -0,0 +1,87 @@
+#pragma once
+#include "../config.h"
+
+//hands out shared handles to loaded resources, at most one live resource per key.
+//the resource is destroyed with its last handle, a later request loads it again.
+template <typename Resource>
+class ResourceCache
+{
+public:
+	typedef std::shared_ptr<Resource> Handle;
+
+	//load returns a new Resource and only runs for the first request of a key. it runs on the
+	//requesting thread, requests for the same key from other threads meanwhile wait for it.
+	template <typename Load>
+	Handle acquire(const std::string& key, Load load)
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		Entry& entry = entries[key];
+		if (Handle resource = entry.resource.lock())
+			return resource;
+		if (entry.pending.valid())
+		{
+			std::shared_future<Handle> pending = entry.pending;
+			lock.unlock();
+			return pending.get();
+		}
+
+		std::promise<Handle> promise;
+		entry.pending = promise.get_future().share();
+		lock.unlock();
+
+		Handle resource(load());
+
+		//entries are never erased, so the reference is still good.
+		lock.lock();
+		entry.resource = resource;
+		entry.pending = std::shared_future<Handle>();
+		++loads;
+		lock.unlock();
+		promise.set_value(resource);
+		return resource;
+	}
+
+	//calls visit with every resource that still has a handle, outside the lock so visit may request more.
+	template <typename Visit>
+	void forEachLive(Visit visit)
+	{
+		std::vector<Handle> live;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			for (const auto& entry : entries)
+				if (Handle resource = entry.second.resource.lock())
+					live.push_back(resource);
+		}
+		for (const Handle& resource : live)
+			visit(*resource);
+	}
+
+	//resources with at least one handle left.
+	size_t liveCount()
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		size_t live = 0;
+		for (const auto& entry : entries)
+			live += !entry.second.resource.expired();
+		return live;
+	}
+
+	//how many times load ran, more than liveCount means something was loaded twice.
+	size_t loadCount()
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		return loads;
+	}
+
+private:
+	struct Entry
+	{
+		std::weak_ptr<Resource> resource;
+		//valid while the first request is still loading.
+		std::shared_future<Handle> pending;
+	};
+
+	std::mutex mutex;
+	std::unordered_map<std::string, Entry> entries;
+	size_t loads = 0;
+};
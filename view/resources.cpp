@@ -0,0 +1,62 @@
+#include "resources.h"
+
+std::shared_ptr<ObjectMesh> Resources::mesh(MeshCreateInfo* createInfo)
+{
+	MeshBakeSettings settings = util::meshBakeSettings(createInfo);
+	return meshes.acquire(util::resourceKey(createInfo->filename, &settings, sizeof(settings)),
+		[&]() { return new ObjectMesh(createInfo); });
+}
+
+std::shared_ptr<Texture> Resources::texture(TextureCreateInfo* createInfo)
+{
+	return textures.acquire(util::resourceKey(createInfo->filename, nullptr, 0),
+		[&]() { return new Texture(createInfo); });
+}
+
+std::shared_ptr<Material> Resources::material(MaterialCreateInfo* createInfo)
+{
+	float diffuse[3] = { createInfo->diffuse.x, createInfo->diffuse.y, createInfo->diffuse.z };
+	return materials.acquire(util::resourceKey(createInfo->filename, diffuse, sizeof(diffuse)),
+		[&]()
+		{
+			TextureCreateInfo textureInfo;
+			textureInfo.filename = createInfo->filename;
+			return new Material(createInfo, texture(&textureInfo));
+		});
+}
+
+std::shared_ptr<Shader> Resources::shader(ShaderCreateInfo* createInfo)
+{
+	//same files with other defines, modules or constants are another program.
+	std::stringstream parameters;
+	parameters << createInfo->fragmentFilepath << '\0' << (createInfo->defines ? createInfo->defines : "") << '\0'
+		<< (createInfo->vertexSpirvFilepath ? createInfo->vertexSpirvFilepath : "") << '\0'
+		<< (createInfo->fragmentSpirvFilepath ? createInfo->fragmentSpirvFilepath : "") << '\0';
+	for (size_t i = 0; i < createInfo->constantIds.size(); ++i)
+		parameters << createInfo->constantIds[i] << '=' << createInfo->constantValues[i] << '\0';
+	std::string key = parameters.str();
+	return shaders.acquire(util::resourceKey(createInfo->vertexFilepath, key.data(), key.size()),
+		[&]() { return new Shader(createInfo); });
+}
+
+void Resources::pollShaders()
+{
+	shaders.forEachLive([](Shader& shader) { shader.ready(); });
+}
+
+void Resources::printStats()
+{
+	std::cout << "Resources live/loaded: meshes " << meshes.liveCount() << '/' << meshes.loadCount()
+		<< ", textures " << textures.liveCount() << '/' << textures.loadCount()
+		<< ", materials " << materials.liveCount() << '/' << materials.loadCount()
+		<< ", shaders " << shaders.liveCount() << '/' << shaders.loadCount() << '\n';
+}
+
+std::string util::resourceKey(const char* path, const void* parameters, size_t size)
+{
+	std::string key(path ? path : "");
+	key.push_back('\0');
+	if (size > 0)
+		key.append(reinterpret_cast<const char*>(parameters), size);
+	return key;
+}
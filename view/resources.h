@@ -0,0 +1,38 @@
+#pragma once
+#include "../config.h"
+#include "resourceCache.h"
+#include "objectMesh.h"
+#include "texture.h"
+#include "material.h"
+#include "shader.h"
+
+//every mesh, texture, material and shader program the engine loads goes through here, so each
+//(file, load parameters) pair is loaded and uploaded once however many objects use it.
+//gl objects get created on the requesting thread, so request from the thread owning the context.
+class Resources
+{
+public:
+	std::shared_ptr<ObjectMesh> mesh(MeshCreateInfo* createInfo);
+	std::shared_ptr<Texture> texture(TextureCreateInfo* createInfo);
+	//also shares the texture with every other material using the file.
+	std::shared_ptr<Material> material(MaterialCreateInfo* createInfo);
+	std::shared_ptr<Shader> shader(ShaderCreateInfo* createInfo);
+
+	//checks on programs the driver is still building, so they're ready by the time they're needed.
+	//once a frame from the thread owning the context.
+	void pollShaders();
+	//live resources and total loads per cache, loads above live means something got reloaded.
+	void printStats();
+
+private:
+	ResourceCache<ObjectMesh> meshes;
+	ResourceCache<Texture> textures;
+	ResourceCache<Material> materials;
+	ResourceCache<Shader> shaders;
+};
+
+namespace util
+{
+	//path plus the raw bytes of the load parameters, which have to be zero initialized so padding matches.
+	std::string resourceKey(const char* path, const void* parameters, size_t size);
+}
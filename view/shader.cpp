@@ -1,7 +1,84 @@
 #include "shader.h"
 
-unsigned int util::loadShader(const char* vertexFilepath, const char* fragmentfilepath)
+namespace
 {
+	//empty if the file can't be read.
+	std::string readModule(const char* filepath)
+	{
+		std::ifstream file(filepath, std::ios::binary);
+		std::stringstream module;
+		module << file.rdbuf();
+		return file ? module.str() : std::string();
+	}
+
+	//0 with the log printed if the module doesn't load or specialize.
+	unsigned int specializeModule(unsigned int type, const std::string& module, const ShaderCreateInfo* createInfo, const char* filepath)
+	{
+		unsigned int shader = glCreateShader(type);
+		glShaderBinary(1, &shader, GL_SHADER_BINARY_FORMAT_SPIR_V_ARB, module.data(), int(module.size()));
+		glSpecializeShaderARB(shader, "main", (unsigned int)createInfo->constantIds.size(), createInfo->constantIds.data(), createInfo->constantValues.data());
+		//specializing is where a module fails, not linking. asked right away so the text can still take over.
+		int success;
+		glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+		if (!success)
+		{
+			char errorLog[1024];
+			glGetShaderInfoLog(shader, 1024, NULL, errorLog);
+			std::cout << "Failed to specialize " << filepath << ", using the text shader: \n" << errorLog << '\n';
+			glDeleteShader(shader);
+			return 0;
+		}
+		return shader;
+	}
+}
+
+Shader::Shader(ShaderCreateInfo* createInfo)
+{
+	if (!util::submitSpirvProgram(createInfo, pending))
+		pending = util::submitProgram(createInfo->vertexFilepath, createInfo->fragmentFilepath, createInfo->defines);
+	program = pending.program;
+	finished = false;
+}
+
+Shader::~Shader()
+{
+	//stages of a program that was never waited for.
+	if (!finished)
+	{
+		glDeleteShader(pending.vertexShader);
+		glDeleteShader(pending.fragmentShader);
+	}
+	glDeleteProgram(program);
+}
+
+bool Shader::ready()
+{
+	if (!finished && util::programCompleted(pending))
+		wait();
+	return finished;
+}
+
+void Shader::wait()
+{
+	if (finished)
+		return;
+	util::finishProgram(pending);
+	reflection = util::reflectProgram(program);
+	finished = true;
+}
+
+void util::enableParallelShaderCompile()
+{
+	//0xffffffff leaves the thread count to the driver.
+	if (GLAD_GL_KHR_parallel_shader_compile)
+		glMaxShaderCompilerThreadsKHR(0xffffffff);
+	else if (GLAD_GL_ARB_parallel_shader_compile)
+		glMaxShaderCompilerThreadsARB(0xffffffff);
+}
+
+PendingProgram util::submitProgram(const char* vertexFilepath, const char* fragmentfilepath, const char* defines)
+{
+	PendingProgram pending{};
 	std::ifstream fileReader;
 	std::stringstream bufferedLines;
 	std::string line;
@@ -12,7 +89,7 @@ unsigned int util::loadShader(const char* vertexFilepath, const char* fragmentfi
 		bufferedLines << line << '\n';	
 
 	//stores the shader as a string, converting to char pointer to be used as source.
-	std::string vertexShaderSource = bufferedLines.str();
+	std::string vertexShaderSource = util::insertDefines(bufferedLines.str(), defines);
 	const char* vertexSrc = vertexShaderSource.c_str();
 	bufferedLines.str("");
 	fileReader.close();
@@ -22,55 +99,175 @@ unsigned int util::loadShader(const char* vertexFilepath, const char* fragmentfi
 	while (std::getline(fileReader, line))	
 		bufferedLines << line << '\n';	
 
-	std::string fragmentShaderSource = bufferedLines.str();
+	std::string fragmentShaderSource = util::insertDefines(bufferedLines.str(), defines);
 	const char* fragmentSrc = fragmentShaderSource.c_str();
 	bufferedLines.str("");
 	fileReader.close();	
 
+	//a binary from an earlier run skips compiling and linking altogether.
+	pending.cacheKey = util::programCacheKey(vertexShaderSource, fragmentShaderSource, defines);
+	if (pending.cacheKey)
+	{
+		pending.cacheFilename = util::programCacheFilename(vertexFilepath, pending.cacheKey);
+		pending.program = util::programCacheRead(pending.cacheFilename.c_str(), pending.cacheKey);
+		if (pending.program)
+			return pending;
+	}
+
 	//stores index of the created memory allocation for the shaders.
-	unsigned int vertexShader = glCreateShader(GL_VERTEX_SHADER);
+	pending.vertexShader = glCreateShader(GL_VERTEX_SHADER);
 	//pass the allocated adress for created shader, count, source code adress.
-	glShaderSource(vertexShader, 1, &vertexSrc, NULL);
-	//compiles the shader inside the OpenGL data structure.
-	glCompileShader(vertexShader);
+	glShaderSource(pending.vertexShader, 1, &vertexSrc, NULL);
+	//compiles the shader inside the OpenGL data structure. statuses are only queried in
+	//finishProgram, asking now would make the driver compile right here.
+	glCompileShader(pending.vertexShader);
+
+	pending.fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
+	glShaderSource(pending.fragmentShader, 1, &fragmentSrc, NULL);
+	glCompileShader(pending.fragmentShader);
+
+	//creating a shader program and storing memory adress.
+	pending.program = glCreateProgram();
+	//binding my shaders to the shader program.
+	glAttachShader(pending.program, pending.vertexShader);
+	glAttachShader(pending.program, pending.fragmentShader);
+	//keeps the binary around for the cache.
+	if (pending.cacheKey)
+		glProgramParameteri(pending.program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+	//linking shaders together.
+	glLinkProgram(pending.program);
+	return pending;
+}
+
+bool util::submitSpirvProgram(ShaderCreateInfo* createInfo, PendingProgram& pending)
+{
+	if (!GLAD_GL_ARB_gl_spirv || !createInfo->vertexSpirvFilepath || !createInfo->fragmentSpirvFilepath
+		|| createInfo->constantIds.size() != createInfo->constantValues.size())
+		return false;
+	std::string vertexModule = readModule(createInfo->vertexSpirvFilepath);
+	std::string fragmentModule = readModule(createInfo->fragmentSpirvFilepath);
+	if (vertexModule.empty() || fragmentModule.empty())
+		return false;
+
+	//the constants are all that tells specializations of the same modules apart.
+	std::stringstream constants;
+	for (size_t i = 0; i < createInfo->constantIds.size(); ++i)
+		constants << createInfo->constantIds[i] << '=' << createInfo->constantValues[i] << '\n';
+	PendingProgram spirv{};
+	spirv.cacheKey = util::programCacheKey(vertexModule, fragmentModule, constants.str().c_str());
+	if (spirv.cacheKey)
+	{
+		spirv.cacheFilename = util::programCacheFilename(createInfo->vertexSpirvFilepath, spirv.cacheKey);
+		spirv.program = util::programCacheRead(spirv.cacheFilename.c_str(), spirv.cacheKey);
+		if (spirv.program)
+		{
+			pending = spirv;
+			return true;
+		}
+	}
+
+	spirv.vertexShader = specializeModule(GL_VERTEX_SHADER, vertexModule, createInfo, createInfo->vertexSpirvFilepath);
+	spirv.fragmentShader = spirv.vertexShader ? specializeModule(GL_FRAGMENT_SHADER, fragmentModule, createInfo, createInfo->fragmentSpirvFilepath) : 0;
+	if (!spirv.fragmentShader)
+	{
+		glDeleteShader(spirv.vertexShader);
+		return false;
+	}
+
+	spirv.program = glCreateProgram();
+	glAttachShader(spirv.program, spirv.vertexShader);
+	glAttachShader(spirv.program, spirv.fragmentShader);
+	if (spirv.cacheKey)
+		glProgramParameteri(spirv.program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+	glLinkProgram(spirv.program);
+	pending = spirv;
+	return true;
+}
+
+bool util::programCompleted(const PendingProgram& pending)
+{
+	if (!pending.vertexShader || !(GLAD_GL_KHR_parallel_shader_compile || GLAD_GL_ARB_parallel_shader_compile))
+		return true;
+	int completed;
+	glGetProgramiv(pending.program, GL_COMPLETION_STATUS_KHR, &completed);
+	return completed != 0;
+}
+
+void util::finishProgram(PendingProgram& pending)
+{
+	//linked from the cache, there's nothing to check.
+	if (!pending.vertexShader)
+		return;
+
 	int success;
 	char errorLog[1024];
 	//queery the error msg queue and prints the errors if compile isn't success.
-	glGetShaderiv(vertexShader, GL_COMPILE_STATUS, &success);
+	glGetShaderiv(pending.vertexShader, GL_COMPILE_STATUS, &success);
 	if (!success)
 	{
-		glGetShaderInfoLog(vertexShader, 1024, NULL, errorLog);
+		glGetShaderInfoLog(pending.vertexShader, 1024, NULL, errorLog);
 		std::cout << "VertexShader compile error: \n" << errorLog << '\n';
 	}
 
-
-	unsigned int fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
-	glShaderSource(fragmentShader, 1, &fragmentSrc, NULL);
-	glCompileShader(fragmentShader);
-	glGetShaderiv(fragmentShader, GL_COMPILE_STATUS, &success);
+	glGetShaderiv(pending.fragmentShader, GL_COMPILE_STATUS, &success);
 	if (!success)
 	{
-		glGetShaderInfoLog(fragmentShader, 1024, NULL, errorLog);
+		glGetShaderInfoLog(pending.fragmentShader, 1024, NULL, errorLog);
 		std::cout << "FragmentShader compile error: \n" << errorLog << '\n';
 	}
 
-	//creating a shader program and storing memory adress.
-	unsigned int shader = glCreateProgram();
-	//binding my shaders to the shader program.
-	glAttachShader(shader, vertexShader);
-	glAttachShader(shader, fragmentShader);
-	//linking shaders together.
-	glLinkProgram(shader);
-	glGetProgramiv(shader, GL_LINK_STATUS, &success);
+	glGetProgramiv(pending.program, GL_LINK_STATUS, &success);
 	if (!success)
 	{
-		glGetShaderInfoLog(shader, 1024, NULL, errorLog);
+		glGetProgramInfoLog(pending.program, 1024, NULL, errorLog);
 		std::cout << "Shader linking error: \n" << errorLog << '\n';
 	}
+	else if (pending.cacheKey && !util::programCacheWrite(pending.cacheFilename.c_str(), pending.cacheKey, pending.program))
+		std::cout << "Failed to write program cache " << pending.cacheFilename << '\n';
 
 	//after linking the shaders, the exists inside the program so they can be deleted.
-	glDeleteShader(vertexShader);
-	glDeleteShader(fragmentShader);
+	glDeleteShader(pending.vertexShader);
+	glDeleteShader(pending.fragmentShader);
+	pending.vertexShader = pending.fragmentShader = 0;
+}
+
+std::string util::insertDefines(const std::string& source, const char* defines)
+{
+	if (!defines)
+		return source;
+	//#version has to stay the first line.
+	size_t versionEnd = source.find('\n');
+	if (versionEnd == std::string::npos)
+		return source;
+	return source.substr(0, versionEnd + 1) + defines + source.substr(versionEnd + 1);
+}
+
+uint32_t util::variantId(const ShaderVariantKey& key)
+{
+	return key.lightCount | uint32_t(key.virtualTexture) << 16 | uint32_t(key.octahedralNormals) << 17;
+}
 
-	return shader;
+std::string util::variantDefines(const ShaderVariantKey& key, const char* baseDefines)
+{
+	std::stringstream defines;
+	if (baseDefines)
+		defines << baseDefines;
+	defines << "#define LIGHT_COUNT " << key.lightCount << '\n';
+	if (key.virtualTexture)
+		defines << "#define VIRTUAL_TEXTURE\n";
+	if (key.octahedralNormals)
+		defines << "#define OCTAHEDRAL_NORMALS\n";
+	return defines.str();
 }
+
+std::string util::variantSpirvFilepath(const char* stage, const ShaderVariantKey& key, bool bindless)
+{
+	std::string filepath = std::string("shaders/spirv/") + stage;
+	if (bindless)
+		filepath += ".bindless";
+	if (key.virtualTexture)
+		filepath += ".virtual";
+	if (key.octahedralNormals)
+		filepath += ".octahedral";
+	return filepath + ".spv";
+}
\ No newline at end of file
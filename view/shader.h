@@ -1,7 +1,90 @@
 #pragma once
 #include "../config.h"
+#include "programCache.h"
+#include "shaderReflection.h"
+
+struct ShaderCreateInfo
+{
+	const char* vertexFilepath;
+	const char* fragmentFilepath;
+	//lines inserted after the #version line of both stages, e.g. "#define BINDLESS\n". nullptr for none.
+	const char* defines;
+	//the same sources compiled offline with the same defines by shaders/compileSpirv.bat. loaded
+	//instead of the text when the driver has ARB_gl_spirv and both modules specialize, nullptr for
+	//the text only.
+	const char* vertexSpirvFilepath;
+	const char* fragmentSpirvFilepath;
+	//specialization constants of the modules by constant_id, the text gets them through defines.
+	std::vector<uint32_t> constantIds, constantValues;
+};
+
+//what a variant of the main shader is specialized for, each becomes #defines, see util::variantDefines.
+struct ShaderVariantKey
+{
+	//LIGHT_COUNT, the lights the fragment shader loops over.
+	unsigned int lightCount;
+	//VIRTUAL_TEXTURE, compiles in the virtual texture path. the rest don't pay for its uniforms and buffer.
+	bool virtualTexture;
+	//OCTAHEDRAL_NORMALS, normals are octahedral encoded like VertexLayout::octahedralNormals says.
+	bool octahedralNormals;
+};
+
+//a program the driver may still be compiling and linking, see util::submitProgram.
+struct PendingProgram
+{
+	unsigned int program, vertexShader, fragmentShader;
+	//programCacheKey or 0, the binary gets written there once the link is checked.
+	uint64_t cacheKey;
+	std::string cacheFilename;
+};
+
+//owns a linked program, deleted with the object. compiling and linking run in the background when
+//the driver has KHR_parallel_shader_compile, the program is only waited for when it's first needed.
+class Shader
+{
+public:
+	//valid right away, but only usable once ready() or wait() returned.
+	unsigned int program;
+	//filled in once the program is linked, empty before.
+	ProgramReflection reflection;
+
+	Shader(ShaderCreateInfo* createInfo);
+	~Shader();
+
+	//never blocks. true once the driver is done and the result has been checked, poll every
+	//frame so programs finished meanwhile get checked and cached off the critical path.
+	bool ready();
+	//blocks until the program is linked, call before it's first used.
+	void wait();
+
+private:
+	PendingProgram pending;
+	bool finished;
+};
 
 namespace util
 {
-	unsigned int loadShader(const char* vertexFilepath, const char* fragmentfilepath);
+	//lets the driver compile on as many threads as it likes, once before submitting programs.
+	void enableParallelShaderCompile();
+	//reads both stages and starts compiling and linking without waiting for either, or links from
+	//the program binary cache when the driver takes it.
+	PendingProgram submitProgram(const char* vertexFilepath, const char* fragmentfilepath, const char* defines);
+	//the same for the SPIR-V modules of createInfo, specialized with its constants. false without
+	//touching pending when there are none, the driver can't load them or they don't specialize, the
+	//text path takes over then.
+	bool submitSpirvProgram(ShaderCreateInfo* createInfo, PendingProgram& pending);
+	//false while the driver is still working on it. always true without KHR_parallel_shader_compile,
+	//finishProgram blocks then.
+	bool programCompleted(const PendingProgram& pending);
+	//checks and prints compile and link errors, deletes the stages and caches the binary.
+	void finishProgram(PendingProgram& pending);
+	std::string insertDefines(const std::string& source, const char* defines);
+	//equal for keys that make the same variant.
+	uint32_t variantId(const ShaderVariantKey& key);
+	//baseDefines, nullptr for none, followed by the #define lines of the key.
+	std::string variantDefines(const ShaderVariantKey& key, const char* baseDefines);
+	//the module shaders/compileSpirv.bat makes of stage ("vertex" or "fragment") for the key's
+	//features, e.g. shaders/spirv/fragment.bindless.virtual.spv. the light count isn't part of it,
+	//modules take it as a specialization constant.
+	std::string variantSpirvFilepath(const char* stage, const ShaderVariantKey& key, bool bindless);
 }
\ No newline at end of file
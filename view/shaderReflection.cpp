@@ -0,0 +1,87 @@
+#include "shaderReflection.h"
+
+namespace
+{
+	std::string resourceName(unsigned int program, unsigned int programInterface, unsigned int index, int nameLength)
+	{
+		std::vector<char> name(std::max(nameLength, 1));
+		glGetProgramResourceName(program, programInterface, index, int(name.size()), nullptr, name.data());
+		return name.data();
+	}
+}
+
+ProgramReflection util::reflectProgram(unsigned int program)
+{
+	ProgramReflection reflection;
+
+	int blockCount = 0;
+	glGetProgramInterfaceiv(program, GL_UNIFORM_BLOCK, GL_ACTIVE_RESOURCES, &blockCount);
+	const GLenum blockProperties[] = { GL_NAME_LENGTH, GL_BUFFER_BINDING, GL_BUFFER_DATA_SIZE };
+	for (int i = 0; i < blockCount; ++i)
+	{
+		int values[3];
+		glGetProgramResourceiv(program, GL_UNIFORM_BLOCK, i, 3, blockProperties, 3, nullptr, values);
+		reflection.blocks.push_back({ resourceName(program, GL_UNIFORM_BLOCK, i, values[0]), values[1], values[2] });
+	}
+
+	int uniformCount = 0;
+	glGetProgramInterfaceiv(program, GL_UNIFORM, GL_ACTIVE_RESOURCES, &uniformCount);
+	const GLenum uniformProperties[] = { GL_NAME_LENGTH, GL_LOCATION, GL_TYPE, GL_ARRAY_SIZE, GL_BLOCK_INDEX, GL_OFFSET };
+	for (int i = 0; i < uniformCount; ++i)
+	{
+		int values[6];
+		glGetProgramResourceiv(program, GL_UNIFORM, i, 6, uniformProperties, 6, nullptr, values);
+		reflection.uniforms.push_back({ resourceName(program, GL_UNIFORM, i, values[0]), values[1], (unsigned int)values[2], values[3], values[4], values[5] });
+	}
+	return reflection;
+}
+
+bool util::checkBlockLayout(const ProgramReflection& reflection, unsigned int binding, const char* blockName, size_t mirrorSize, const std::vector<BlockMember>& members)
+{
+	int blockIndex = -1;
+	for (size_t i = 0; i < reflection.blocks.size(); ++i)
+		if (reflection.blocks[i].binding == int(binding))
+			blockIndex = int(i);
+	if (blockIndex < 0)
+	{
+		std::cout << "Uniform block " << blockName << " isn't on binding " << binding << ", its layout check is skipped\n";
+		return true;
+	}
+
+	bool matches = true;
+	if (size_t(reflection.blocks[blockIndex].dataSize) > mirrorSize)
+	{
+		std::cout << "Uniform block " << blockName << " takes " << reflection.blocks[blockIndex].dataSize
+			<< " bytes, its mirror only " << mirrorSize << '\n';
+		matches = false;
+	}
+
+	//without member names only the size can be compared.
+	bool named = std::any_of(reflection.uniforms.begin(), reflection.uniforms.end(), [&](const ReflectedUniform& uniform)
+	{
+		return uniform.blockIndex == blockIndex && !uniform.name.empty();
+	});
+	if (!named)
+	{
+		std::cout << "Uniform block " << blockName << " reports no member names, its offset check is skipped\n";
+		return matches;
+	}
+
+	for (const BlockMember& member : members)
+	{
+		auto uniform = std::find_if(reflection.uniforms.begin(), reflection.uniforms.end(), [&](const ReflectedUniform& uniform)
+		{
+			return uniform.blockIndex == blockIndex && uniform.name == member.name;
+		});
+		//the compiler may drop members nothing reads, except under std140 where every one stays.
+		if (uniform == reflection.uniforms.end())
+			std::cout << "Uniform block " << blockName << " has no member " << member.name << '\n';
+		else if (size_t(uniform->offset) != member.offset)
+		{
+			std::cout << "Uniform block " << blockName << " has " << member.name << " at offset " << uniform->offset
+				<< ", its mirror at " << member.offset << '\n';
+			matches = false;
+		}
+	}
+	return matches;
+}
@@ -0,0 +1,47 @@
+#pragma once
+#include "../config.h"
+
+//an active uniform, block members included. arrays of structs list every member of every element.
+struct ReflectedUniform
+{
+	std::string name;
+	//-1 for block members, they have an offset into the block instead.
+	int location;
+	unsigned int type;
+	int arraySize;
+	//index into ProgramReflection::blocks or -1.
+	int blockIndex;
+	int offset;
+};
+
+struct ReflectedBlock
+{
+	std::string name;
+	int binding;
+	int dataSize;
+};
+
+//what a linked program takes, queried once after linking so nothing gets looked up by name per frame.
+struct ProgramReflection
+{
+	std::vector<ReflectedUniform> uniforms;
+	std::vector<ReflectedBlock> blocks;
+};
+
+//a member of the c++ mirror of a uniform block, name as the program reports it.
+struct BlockMember
+{
+	const char* name;
+	size_t offset;
+};
+
+namespace util
+{
+	//enumerates the uniforms and uniform blocks of a linked program through the program interface queries.
+	ProgramReflection reflectProgram(unsigned int program);
+	//compares a c++ mirror struct with the std140 layout the program reports for the block on binding,
+	//prints every member at another offset and a mirror smaller than the block. spir-v programs may
+	//report no names, so the block is found by binding and blockName is only for the messages. a
+	//check that can't run is reported as skipped and passes.
+	bool checkBlockLayout(const ProgramReflection& reflection, unsigned int binding, const char* blockName, size_t mirrorSize, const std::vector<BlockMember>& members);
+}
@@ -0,0 +1,311 @@
+#include "texture.h"
+
+Texture::Texture(TextureCreateInfo* createInfo)
+{
+	texture = 0;
+	firstLevel = 0;
+	lastUsed = 0;
+	if (createInfo->filename)
+		filename = createInfo->filename;
+	if (filename.empty())
+	{
+		uploadWhite();
+		return;
+	}
+
+	if (!load(0))
+	{
+		std::cout << "Failed to load texture " << filename << '\n';
+		filename.clear();
+		uploadWhite();
+	}
+}
+
+Texture::~Texture()
+{
+	glDeleteTextures(1, &texture);
+}
+
+void Texture::setFirstLevel(int level, const UploadRegion* region, UploadRing* uploads)
+{
+	level = std::max(0, std::min(level, sourceLevelCount - 1));
+	if (level == firstLevel)
+		return;
+	if (!texture)
+	{
+		width = std::max(1, sourceWidth >> level);
+		height = std::max(1, sourceHeight >> level);
+		levelCount = sourceLevelCount - level;
+		firstLevel = level;
+		return;
+	}
+
+	//storage is immutable, the new size gets a new texture.
+	unsigned int previous = texture;
+	int previousFirst = firstLevel;
+	texture = 0;
+	setStorage(internalFormat, std::max(1, sourceWidth >> level), std::max(1, sourceHeight >> level), sourceLevelCount - level);
+
+	//levels both have move on the gpu, the ones it gets back were read into region, largest first.
+	size_t offset = 0;
+	for (int l = level; l < sourceLevelCount; ++l)
+	{
+		int levelWidth = std::max(1, sourceWidth >> l), levelHeight = std::max(1, sourceHeight >> l);
+		if (l >= previousFirst)
+			glCopyImageSubData(previous, GL_TEXTURE_2D, l - previousFirst, 0, 0, 0, texture, GL_TEXTURE_2D, l - level, 0, 0, 0, levelWidth, levelHeight, 1);
+		else
+		{
+			util::uploadLevel(uploads, *region, offset, texture, -1, l - level, internalFormat, levelWidth, levelHeight);
+			offset += levelBytes(l, 1);
+		}
+	}
+	glDeleteTextures(1, &previous);
+	firstLevel = level;
+}
+
+void Texture::releaseStorage()
+{
+	glDeleteTextures(1, &texture);
+	texture = 0;
+}
+
+bool Texture::readLevels(int first, int count, unsigned char* data) const
+{
+	//the same file load picked, in the same order.
+	size_t dot = filename.find_last_of('.');
+	std::string extension = dot == std::string::npos ? "" : filename.substr(dot);
+	std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+	if (extension == ".ktx2" || extension == ".dds")
+		return readCompressed(filename.c_str(), extension == ".dds", first, count, data);
+
+	std::string compressedFilename = filename + ".ktx2";
+	int64_t compressedTime, sourceTime, size;
+	if (util::fileStamp(compressedFilename.c_str(), compressedTime, size)
+		&& (!util::fileStamp(filename.c_str(), sourceTime, size) || compressedTime >= sourceTime))
+		return readCompressed(compressedFilename.c_str(), false, first, count, data);
+
+	std::string bakedFilename = filename + ".mips";
+	mappedFile baked = util::mapFile(bakedFilename.c_str());
+	if (util::bakedTextureIsCurrent(baked, filename.c_str()))
+	{
+		const BakedTextureHeader* header = reinterpret_cast<const BakedTextureHeader*>(baked.data);
+		bool matches = header->internalFormat == internalFormat && int(header->width) == sourceWidth
+			&& int(header->height) == sourceHeight && int(header->levelCount) == sourceLevelCount;
+		for (int l = first; matches && l < first + count; ++l)
+		{
+			matches = header->levelBytes[l] == levelBytes(l, 1);
+			if (matches)
+				memcpy(data, baked.data + header->levelOffset[l], levelBytes(l, 1));
+			data += levelBytes(l, 1);
+		}
+		util::unmapFile(baked);
+		return matches;
+	}
+	util::unmapFile(baked);
+
+	image material = util::loadFromFile(filename.c_str());
+	if (!material.pixels)
+		return false;
+	std::vector<MipLevel> chain = util::buildMipChain(material.pixels, material.width, material.height);
+	util::freeImgMem(material);
+	if (internalFormat != GL_RGBA8 || chain[0].width != sourceWidth || chain[0].height != sourceHeight || int(chain.size()) != sourceLevelCount)
+		return false;
+	for (int l = first; l < first + count; ++l)
+	{
+		memcpy(data, chain[l].pixels.data(), levelBytes(l, 1));
+		data += levelBytes(l, 1);
+	}
+	return true;
+}
+
+size_t Texture::levelBytes(int first, int count) const
+{
+	return util::textureBytes(internalFormat, std::max(1, sourceWidth >> first), std::max(1, sourceHeight >> first), count);
+}
+
+bool Texture::reloadable() const
+{
+	return !filename.empty();
+}
+
+void Texture::stopReloading()
+{
+	filename.clear();
+}
+
+bool Texture::load(int firstLevel)
+{
+	//block compressed files go to the gpu as they are.
+	size_t dot = filename.find_last_of('.');
+	std::string extension = dot == std::string::npos ? "" : filename.substr(dot);
+	std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+	if (extension == ".ktx2" || extension == ".dds")
+		return uploadCompressed(filename.c_str(), extension == ".dds", firstLevel);
+
+	//a compressed copy made with --compress-texture, e.g. textures/wood.jpg.ktx2, wins while it's
+	//at least as new as the image.
+	std::string compressedFilename = filename + ".ktx2";
+	int64_t compressedTime, sourceTime, size;
+	if (util::fileStamp(compressedFilename.c_str(), compressedTime, size)
+		&& (!util::fileStamp(filename.c_str(), sourceTime, size) || compressedTime >= sourceTime)
+		&& uploadCompressed(compressedFilename.c_str(), false, firstLevel))
+		return true;
+
+	//baked chain sits next to the image, e.g. textures/wood.jpg.mips.
+	std::string bakedFilename = filename + ".mips";
+	mappedFile baked = util::mapFile(bakedFilename.c_str());
+	if (util::bakedTextureIsCurrent(baked, filename.c_str()))
+	{
+		//fast path, every level goes straight from the mapping to the gpu.
+		const BakedTextureHeader* header = reinterpret_cast<const BakedTextureHeader*>(baked.data);
+		int first = std::min(firstLevel, int(header->levelCount) - 1);
+		setStorage(header->internalFormat, std::max(1, int(header->width >> first)), std::max(1, int(header->height >> first)),
+			int(header->levelCount) - first);
+		for (uint32_t l = uint32_t(first); l < header->levelCount; ++l)
+		{
+			int width = std::max(1, int(header->width >> l));
+			int height = std::max(1, int(header->height >> l));
+			glTextureSubImage2D(texture, int(l) - first, 0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, baked.data + header->levelOffset[l]);
+		}
+		sourceWidth = int(header->width);
+		sourceHeight = int(header->height);
+		sourceLevelCount = int(header->levelCount);
+		this->firstLevel = first;
+		util::unmapFile(baked);
+		return true;
+	}
+	//close the stale mapping before the file gets rewritten.
+	util::unmapFile(baked);
+
+	//load image from project, get image details and set rgb+alpha.
+	image material = util::loadFromFile(filename.c_str());
+	if (!material.pixels)
+		return false;
+
+	std::vector<MipLevel> chain = util::buildMipChain(material.pixels, material.width, material.height);
+	util::freeImgMem(material);
+	if (!util::bakedTextureWrite(bakedFilename.c_str(), filename.c_str(), chain))
+		std::cout << "Failed to write baked texture " << bakedFilename << '\n';
+
+	int first = std::min(firstLevel, int(chain.size()) - 1);
+	setStorage(GL_RGBA8, chain[first].width, chain[first].height, int(chain.size()) - first);
+	for (size_t l = size_t(first); l < chain.size(); ++l)
+		glTextureSubImage2D(texture, int(l) - first, 0, 0, chain[l].width, chain[l].height, GL_RGBA, GL_UNSIGNED_BYTE, chain[l].pixels.data());
+	sourceWidth = chain[0].width;
+	sourceHeight = chain[0].height;
+	sourceLevelCount = int(chain.size());
+	this->firstLevel = first;
+	return true;
+}
+
+void Texture::uploadWhite()
+{
+	unsigned char white[4] = { 255, 255, 255, 255 };
+	setStorage(GL_RGBA8, 1, 1, 1);
+	glTextureSubImage2D(texture, 0, 0, 0, 1, 1, GL_RGBA, GL_UNSIGNED_BYTE, white);
+	sourceWidth = sourceHeight = sourceLevelCount = 1;
+	firstLevel = 0;
+}
+
+void Texture::setStorage(unsigned int internalFormat, int width, int height, int levelCount)
+{
+	//storage is immutable, a different size needs a new texture.
+	if (texture)
+		glDeleteTextures(1, &texture);
+	glCreateTextures(GL_TEXTURE_2D, 1, &texture);
+	glTextureParameteri(texture, GL_TEXTURE_WRAP_S, GL_REPEAT); //if out of bound, repeate texture.
+	glTextureParameteri(texture, GL_TEXTURE_WRAP_T, GL_REPEAT);
+	glTextureParameteri(texture, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR); //if texture is far away, blend the two closest mips.
+	glTextureParameteri(texture, GL_TEXTURE_MAG_FILTER, GL_LINEAR); //if texture is close, grow using linear.
+
+	this->internalFormat = internalFormat;
+	this->width = width;
+	this->height = height;
+	this->levelCount = levelCount;
+	glTextureStorage2D(texture, levelCount, internalFormat, width, height);
+}
+
+bool Texture::uploadCompressed(const char* filename, bool dds, int firstLevel)
+{
+	mappedFile file = util::mapFile(filename);
+	CompressedTexture compressed;
+	bool parsed = dds ? util::ddsParse(file, compressed) : util::ktx2Parse(file, compressed);
+	if (parsed)
+	{
+		int first = std::min(firstLevel, compressed.levelCount - 1);
+		setStorage(compressed.internalFormat, std::max(1, compressed.width >> first), std::max(1, compressed.height >> first),
+			compressed.levelCount - first);
+		for (int l = first; l < compressed.levelCount; ++l)
+		{
+			int width = std::max(1, compressed.width >> l);
+			int height = std::max(1, compressed.height >> l);
+			glCompressedTextureSubImage2D(texture, l - first, 0, 0, width, height, compressed.internalFormat, GLsizei(compressed.levelBytes[l]), compressed.levelData[l]);
+		}
+		//a chain that stops early must not sample missing levels.
+		glTextureParameteri(texture, GL_TEXTURE_MAX_LEVEL, levelCount - 1);
+		sourceWidth = compressed.width;
+		sourceHeight = compressed.height;
+		sourceLevelCount = compressed.levelCount;
+		this->firstLevel = first;
+	}
+	util::unmapFile(file);
+	return parsed;
+}
+
+bool Texture::readCompressed(const char* filename, bool dds, int first, int count, unsigned char* data) const
+{
+	mappedFile file = util::mapFile(filename);
+	CompressedTexture compressed;
+	bool matches = (dds ? util::ddsParse(file, compressed) : util::ktx2Parse(file, compressed))
+		&& compressed.internalFormat == internalFormat && compressed.width == sourceWidth
+		&& compressed.height == sourceHeight && compressed.levelCount == sourceLevelCount;
+	for (int l = first; matches && l < first + count; ++l)
+	{
+		matches = compressed.levelBytes[l] == levelBytes(l, 1);
+		if (matches)
+			memcpy(data, compressed.levelData[l], compressed.levelBytes[l]);
+		data += levelBytes(l, 1);
+	}
+	util::unmapFile(file);
+	return matches;
+}
+
+size_t util::textureBytes(unsigned int internalFormat, int width, int height, int levelCount)
+{
+	//bytes per 4x4 block for the compressed formats, per texel for the rest.
+	size_t blockBytes = 0;
+	switch (internalFormat)
+	{
+	case GL_COMPRESSED_RGB_S3TC_DXT1_EXT:
+	case GL_COMPRESSED_RGBA_S3TC_DXT1_EXT:
+		blockBytes = 8;
+		break;
+	case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT:
+	case GL_COMPRESSED_RG_RGTC2:
+	case GL_COMPRESSED_RGBA_BPTC_UNORM:
+		blockBytes = 16;
+		break;
+	}
+
+	size_t total = 0;
+	for (int l = 0; l < levelCount; ++l)
+	{
+		int levelWidth = std::max(1, width >> l), levelHeight = std::max(1, height >> l);
+		if (blockBytes)
+			total += size_t((levelWidth + 3) / 4) * size_t((levelHeight + 3) / 4) * blockBytes;
+		else
+			total += size_t(levelWidth) * size_t(levelHeight) * 4;
+	}
+	return total;
+}
+
+void util::uploadLevel(UploadRing* uploads, const UploadRegion& region, size_t offset, unsigned int texture, int layer, int level,
+	unsigned int internalFormat, int width, int height)
+{
+	if (internalFormat != GL_RGBA8)
+		uploads->copyCompressedToTexture(region, offset, util::textureBytes(internalFormat, width, height, 1), texture, level, layer, width, height, internalFormat);
+	else if (layer < 0)
+		uploads->copyToTexture(region, offset, texture, level, 0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE);
+	else
+		uploads->copyToTextureLayer(region, offset, texture, level, 0, 0, layer, width, height, GL_RGBA, GL_UNSIGNED_BYTE);
+}
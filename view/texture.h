@@ -0,0 +1,72 @@
+#pragma once
+#include "../config.h"
+#include "image.h"
+#include "bakedTexture.h"
+#include "textureContainer.h"
+#include "uploadRing.h"
+
+struct TextureCreateInfo
+{
+	//nullptr or a file that fails to load gives a 1x1 white texture.
+	const char* filename;
+};
+
+class Texture
+{
+public:
+	//0 once TextureArrays holds the only copy.
+	unsigned int texture;
+	//what the storage was allocated with, textures of equal ones can share a texture array.
+	unsigned int internalFormat;
+	int width, height, levelCount;
+	//level of the file's chain the storage starts at, above 0 while TextureResidency keeps it smaller.
+	int firstLevel;
+	//the file's full chain.
+	int sourceWidth, sourceHeight, sourceLevelCount;
+	//frame a material last drew with it, see TextureResidency.
+	uint64_t lastUsed;
+
+	//.ktx2 and .dds files upload their block compressed levels as they are. for other images a
+	//<image>.ktx2 next to it is used first, then the baked .mips when it's current, then the image.
+	Texture(TextureCreateInfo* createInfo);
+	~Texture();
+
+	//makes level of the source chain the largest resident one and gives the texture a new name, so
+	//its bindless handle has to follow. the levels it keeps are copied on the gpu, the ones it gets
+	//back come from region, where readLevels put them. region is only read when growing. after
+	//releaseStorage only the fields change, TextureArrays::setFirstLevel moves the texels.
+	void setFirstLevel(int level, const UploadRegion* region, UploadRing* uploads);
+	//deletes the texture's own storage once a copy holds it, texture is 0 from then on.
+	void releaseStorage();
+	//any thread. reads count levels of the source chain from first into data, levelBytes of them, from
+	//the file load used. false if it's gone or no longer matches what the gpu has.
+	bool readLevels(int first, int count, unsigned char* data) const;
+	//bytes of count levels of the source chain from first.
+	size_t levelBytes(int first, int count) const;
+	//whether getting levels back is possible, the white texture and files gone missing can only drop.
+	bool reloadable() const;
+	//after a failed reload, the texture keeps the levels it has.
+	void stopReloading();
+
+private:
+	//replaces the texture with a new, empty one and deletes the old name if there is one.
+	void setStorage(unsigned int internalFormat, int width, int height, int levelCount);
+	void uploadWhite();
+	//uploads the source chain from firstLevel on. false without touching the texture if the file can't be used.
+	bool load(int firstLevel);
+	bool uploadCompressed(const char* filename, bool dds, int firstLevel);
+	bool readCompressed(const char* filename, bool dds, int first, int count, unsigned char* data) const;
+
+	//empty for the white texture.
+	std::string filename;
+};
+
+namespace util
+{
+	//bytes of a width x height texture with levelCount levels, block compressed formats included.
+	size_t textureBytes(unsigned int internalFormat, int width, int height, int levelCount);
+	//copies one width x height level from region into level of texture, or of one layer of it for
+	//array textures and -1 otherwise. block compressed formats go as they are, the rest are rgba8.
+	void uploadLevel(UploadRing* uploads, const UploadRegion& region, size_t offset, unsigned int texture, int layer, int level,
+		unsigned int internalFormat, int width, int height);
+}
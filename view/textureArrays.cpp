@@ -0,0 +1,392 @@
+#include "textureArrays.h"
+
+namespace
+{
+	//atlas regions start on multiples of this, so every atlas level still starts on whole texels.
+	const int atlasAlignment = 32;
+	const int atlasMaxLevels = 6;
+	const int atlasMaxSize = 4096;
+	//only small textures share the atlas, a 256 texture still gets down to 8x8 in it. larger ones get
+	//an array of their own so they keep their whole chain and can shrink.
+	const int atlasMaxTextureSize = 256;
+
+	struct AtlasPlacement
+	{
+		size_t texture;
+		int x, y, layer;
+	};
+
+	int alignUp(int value, int alignment)
+	{
+		return (value + alignment - 1) / alignment * alignment;
+	}
+
+	unsigned int createArray(unsigned int internalFormat, int width, int height, int levelCount, int layerCount, int wrap)
+	{
+		unsigned int array;
+		glCreateTextures(GL_TEXTURE_2D_ARRAY, 1, &array);
+		glTextureParameteri(array, GL_TEXTURE_WRAP_S, wrap);
+		glTextureParameteri(array, GL_TEXTURE_WRAP_T, wrap);
+		glTextureParameteri(array, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+		glTextureParameteri(array, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTextureStorage3D(array, levelCount, internalFormat, width, height, layerCount);
+		return array;
+	}
+
+	//shelf packing, tallest first: left to right along a shelf, a new shelf below when the row is
+	//full and a new layer when the page is. returns the layer count.
+	int packAtlas(const std::vector<Texture*>& textures, std::vector<AtlasPlacement>& placements, int size)
+	{
+		std::sort(placements.begin(), placements.end(), [&](const AtlasPlacement& a, const AtlasPlacement& b)
+		{
+			return textures[a.texture]->height > textures[b.texture]->height;
+		});
+
+		int x = 0, y = 0, shelfHeight = 0, layer = 0;
+		for (AtlasPlacement& placement : placements)
+		{
+			int width = alignUp(textures[placement.texture]->width, atlasAlignment);
+			int height = alignUp(textures[placement.texture]->height, atlasAlignment);
+			if (x + width > size)
+			{
+				x = 0;
+				y += shelfHeight;
+				shelfHeight = 0;
+			}
+			if (y + height > size)
+			{
+				x = y = shelfHeight = 0;
+				++layer;
+			}
+			placement.x = x;
+			placement.y = y;
+			placement.layer = layer;
+			x += width;
+			shelfHeight = std::max(shelfHeight, height);
+		}
+		return layer + 1;
+	}
+}
+
+TextureArrays::TextureArrays()
+{
+	atlasUnit = -1;
+	atlasSize = atlasLevelCount = atlasLayerCount = 0;
+	releasedArrays = 0;
+}
+
+TextureArrays::~TextureArrays()
+{
+	clear();
+}
+
+void TextureArrays::build(const std::vector<Texture*>& textures)
+{
+	clear();
+	arrays.assign(maxTextureArrays, 0);
+	layers.assign(maxTextureArrays, ArrayLayers());
+
+	//materials share textures, every texture gets copied once.
+	std::vector<Texture*> unique;
+	for (Texture* texture : textures)
+		if (std::find(unique.begin(), unique.end(), texture) == unique.end())
+			unique.push_back(texture);
+
+	std::map<ArrayKey, std::vector<size_t>> groups;
+	for (size_t i = 0; i < unique.size(); ++i)
+		groups[keyOf(unique[i])].push_back(i);
+
+	//small sizes no other texture shares go to the atlas, unless they're compressed.
+	auto atlasFits = [&](const Texture* texture)
+	{
+		return texture->internalFormat == GL_RGBA8 && std::max(texture->width, texture->height) <= atlasMaxTextureSize;
+	};
+	std::vector<std::vector<size_t>> layered;
+	std::vector<AtlasPlacement> placements;
+	for (const auto& group : groups)
+	{
+		if (group.second.size() > 1 || !atlasFits(unique[group.second[0]]))
+			layered.push_back(group.second);
+		else
+			placements.push_back({ group.second[0], 0, 0, 0 });
+	}
+	if (placements.size() == 1)
+	{
+		layered.push_back({ placements[0].texture });
+		placements.clear();
+	}
+
+	//the largest groups get the units, one is kept for the atlas. rgba8 groups left over join the
+	//atlas, smallest first.
+	std::stable_sort(layered.begin(), layered.end(), [](const std::vector<size_t>& a, const std::vector<size_t>& b) { return a.size() > b.size(); });
+	auto units = [&]() { return size_t(maxTextureArrays) - (placements.empty() ? 0 : 1); };
+	for (size_t g = layered.size(); g-- > 0 && layered.size() > units();)
+		if (atlasFits(unique[layered[g][0]]))
+		{
+			for (size_t member : layered[g])
+				placements.push_back({ member, 0, 0, 0 });
+			layered.erase(layered.begin() + g);
+		}
+
+	std::vector<size_t> leftOver;
+	for (const std::vector<size_t>& members : layered)
+	{
+		int unit = freeUnit();
+		if (unit < 0 || (!placements.empty() && unit == int(maxTextureArrays) - 1))
+		{
+			leftOver.insert(leftOver.end(), members.begin(), members.end());
+			continue;
+		}
+
+		addArray(unit, keyOf(unique[members[0]]), int(members.size()));
+		layers[unit].freeLayers.clear();
+		for (size_t layer = 0; layer < members.size(); ++layer)
+		{
+			copyLayer(unique[members[layer]], 0, (unsigned int)unit, int(layer));
+			slots[unique[members[layer]]] = { (unsigned int)unit, float(layer), glm::vec4(1.0f, 1.0f, 0.0f, 0.0f), false };
+		}
+	}
+
+	if (!placements.empty())
+	{
+		//smallest power of two page holding the largest texture and, roughly, all of them.
+		int largest = 0;
+		int64_t area = 0;
+		for (const AtlasPlacement& placement : placements)
+		{
+			int width = alignUp(unique[placement.texture]->width, atlasAlignment), height = alignUp(unique[placement.texture]->height, atlasAlignment);
+			largest = std::max(largest, std::max(width, height));
+			area += int64_t(width) * height;
+		}
+		atlasSize = atlasAlignment;
+		while (atlasSize < largest || int64_t(atlasSize) * atlasSize < area)
+			atlasSize *= 2;
+		atlasSize = std::min(atlasSize, atlasMaxSize);
+
+		atlasUnit = freeUnit();
+		atlasLayerCount = packAtlas(unique, placements, atlasSize);
+		atlasLevelCount = std::min(atlasMaxLevels, util::mipLevelCount(atlasSize, atlasSize));
+		arrays[atlasUnit] = createArray(GL_RGBA8, atlasSize, atlasSize, atlasLevelCount, atlasLayerCount, GL_CLAMP_TO_EDGE);
+		for (int l = 0; l < atlasLevelCount; ++l)
+			glClearTexImage(arrays[atlasUnit], l, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+
+		for (const AtlasPlacement& placement : placements)
+		{
+			const Texture* texture = unique[placement.texture];
+			copyToAtlas(texture, (unsigned int)atlasUnit, placement.x, placement.y, placement.layer);
+			glm::vec4 uvTransform = glm::vec4(texture->width, texture->height, placement.x, placement.y) / float(atlasSize);
+			slots[texture] = { (unsigned int)atlasUnit, float(placement.layer), uvTransform, true };
+		}
+	}
+
+	//no unit left: a smaller version of the texture joins an array of its format whose size it has
+	//at one of its levels.
+	std::vector<std::pair<Texture*, int>> shrunk;
+	for (size_t member : leftOver)
+	{
+		Texture* texture = unique[member];
+		int first = 1;
+		int unit = -1;
+		for (; first < texture->levelCount && unit < 0; ++first)
+		{
+			ArrayKey key = { int(texture->internalFormat), std::max(1, texture->width >> first), std::max(1, texture->height >> first), texture->levelCount - first };
+			for (size_t i = 0; i < arrays.size() && unit < 0; ++i)
+				if (arrays[i] && layers[i].key == key)
+					unit = int(i);
+		}
+		--first;
+
+		unsigned int layerUnit;
+		int layer;
+		if (unit < 0 || !allocateLayer(layers[unit].key, layerUnit, layer))
+		{
+			std::cout << "Out of texture array units, a " << texture->width << 'x' << texture->height << " texture of format 0x"
+				<< std::hex << texture->internalFormat << std::dec << " samples the first array instead\n";
+			continue;
+		}
+		std::cout << "Out of texture array units, a " << texture->width << 'x' << texture->height << " texture starts at level " << first << '\n';
+		copyLayer(texture, first, layerUnit, layer);
+		slots[texture] = { layerUnit, float(layer), glm::vec4(1.0f, 1.0f, 0.0f, 0.0f), false };
+		shrunk.push_back(std::make_pair(texture, first));
+	}
+
+	//the copies are all there is from now on.
+	for (Texture* texture : unique)
+		texture->releaseStorage();
+	for (const auto& texture : shrunk)
+		texture.first->setFirstLevel(texture.second, nullptr, nullptr);
+}
+
+TextureSlot TextureArrays::slot(const Texture* texture)
+{
+	//samples the first layer of the first array, only reached by textures build couldn't place.
+	auto found = slots.find(texture);
+	return found == slots.end() ? TextureSlot{ 0, 0.0f, glm::vec4(1.0f, 1.0f, 0.0f, 0.0f), false } : found->second;
+}
+
+bool TextureArrays::resizable(const Texture* texture)
+{
+	auto found = slots.find(texture);
+	return found != slots.end() && !found->second.atlasRegion;
+}
+
+bool TextureArrays::setFirstLevel(Texture* texture, int level, const UploadRegion* region, UploadRing* uploads)
+{
+	level = std::max(0, std::min(level, texture->sourceLevelCount - 1));
+	if (!resizable(texture) || level == texture->firstLevel)
+		return false;
+
+	ArrayKey key = { int(texture->internalFormat), std::max(1, texture->sourceWidth >> level), std::max(1, texture->sourceHeight >> level),
+		texture->sourceLevelCount - level };
+	unsigned int unit;
+	int layer;
+	if (!allocateLayer(key, unit, layer))
+	{
+		std::cout << "Out of texture array units, a " << texture->width << 'x' << texture->height
+			<< " texture keeps its size until one frees up\n";
+		return false;
+	}
+
+	//levels both have move between the layers, the ones it gets back were read into region, largest first.
+	TextureSlot& current = slots[texture];
+	size_t offset = 0;
+	for (int l = level; l < texture->sourceLevelCount; ++l)
+	{
+		int levelWidth = std::max(1, texture->sourceWidth >> l), levelHeight = std::max(1, texture->sourceHeight >> l);
+		if (l >= texture->firstLevel)
+			glCopyImageSubData(arrays[current.array], GL_TEXTURE_2D_ARRAY, l - texture->firstLevel, 0, 0, int(current.layer),
+				arrays[unit], GL_TEXTURE_2D_ARRAY, l - level, 0, 0, layer, levelWidth, levelHeight, 1);
+		else
+		{
+			util::uploadLevel(uploads, *region, offset, arrays[unit], layer, l - level, texture->internalFormat, levelWidth, levelHeight);
+			offset += texture->levelBytes(l, 1);
+		}
+	}
+	freeLayer(current);
+	current = { unit, float(layer), glm::vec4(1.0f, 1.0f, 0.0f, 0.0f), false };
+	texture->setFirstLevel(level, nullptr, nullptr);
+	return true;
+}
+
+size_t TextureArrays::residentBytes()
+{
+	size_t total = 0;
+	for (size_t unit = 0; unit < arrays.size(); ++unit)
+	{
+		if (int(unit) == atlasUnit)
+			total += util::textureBytes(GL_RGBA8, atlasSize, atlasSize, atlasLevelCount) * size_t(atlasLayerCount);
+		else if (arrays[unit])
+			total += util::textureBytes((unsigned int)layers[unit].key[0], layers[unit].key[1], layers[unit].key[2], layers[unit].key[3])
+				* size_t(layers[unit].layerCount);
+	}
+	return total;
+}
+
+void TextureArrays::bind()
+{
+	if (!arrays.empty())
+		glBindTextures(0, int(arrays.size()), arrays.data());
+}
+
+void TextureArrays::clear()
+{
+	for (unsigned int array : arrays)
+		if (array)
+			glDeleteTextures(1, &array);
+	arrays.clear();
+	layers.clear();
+	slots.clear();
+	atlasUnit = -1;
+}
+
+TextureArrays::ArrayKey TextureArrays::keyOf(const Texture* texture)
+{
+	return { int(texture->internalFormat), texture->width, texture->height, texture->levelCount };
+}
+
+int TextureArrays::freeUnit()
+{
+	for (size_t unit = 0; unit < arrays.size(); ++unit)
+		if (!arrays[unit])
+			return int(unit);
+	return -1;
+}
+
+void TextureArrays::addArray(int unit, const ArrayKey& key, int layerCount)
+{
+	arrays[unit] = createArray((unsigned int)key[0], key[1], key[2], key[3], layerCount, GL_REPEAT);
+	layers[unit].key = key;
+	layers[unit].layerCount = layerCount;
+	layers[unit].freeLayers.clear();
+	for (int layer = layerCount - 1; layer >= 0; --layer)
+		layers[unit].freeLayers.push_back(layer);
+}
+
+bool TextureArrays::allocateLayer(const ArrayKey& key, unsigned int& unit, int& layer)
+{
+	int found = -1;
+	for (size_t i = 0; i < arrays.size(); ++i)
+		if (arrays[i] && int(i) != atlasUnit && layers[i].key == key)
+			found = int(i);
+
+	if (found < 0)
+	{
+		found = freeUnit();
+		if (found < 0)
+			return false;
+		addArray(found, key, 1);
+	}
+	else if (layers[found].freeLayers.empty())
+	{
+		//storage is immutable, a full array moves to a larger one. half again as many layers keeps
+		//the copies rare.
+		ArrayLayers& full = layers[found];
+		int layerCount = full.layerCount + std::max(1, full.layerCount / 2);
+		unsigned int previous = arrays[found];
+		arrays[found] = createArray((unsigned int)key[0], key[1], key[2], key[3], layerCount, GL_REPEAT);
+		for (int l = 0; l < key[3]; ++l)
+			glCopyImageSubData(previous, GL_TEXTURE_2D_ARRAY, l, 0, 0, 0, arrays[found], GL_TEXTURE_2D_ARRAY, l, 0, 0, 0,
+				std::max(1, key[1] >> l), std::max(1, key[2] >> l), full.layerCount);
+		glDeleteTextures(1, &previous);
+		for (int added = layerCount - 1; added >= full.layerCount; --added)
+			full.freeLayers.push_back(added);
+		full.layerCount = layerCount;
+	}
+
+	unit = (unsigned int)found;
+	layer = layers[found].freeLayers.back();
+	layers[found].freeLayers.pop_back();
+	return true;
+}
+
+void TextureArrays::freeLayer(const TextureSlot& slot)
+{
+	//an array nothing is in any more gives its unit back.
+	ArrayLayers& array = layers[slot.array];
+	array.freeLayers.push_back(int(slot.layer));
+	if (int(array.freeLayers.size()) < array.layerCount)
+		return;
+	glDeleteTextures(1, &arrays[slot.array]);
+	arrays[slot.array] = 0;
+	array = ArrayLayers();
+	++releasedArrays;
+}
+
+void TextureArrays::copyLayer(const Texture* texture, int firstLevel, unsigned int unit, int layer)
+{
+	for (int l = firstLevel; l < texture->levelCount; ++l)
+		glCopyImageSubData(texture->texture, GL_TEXTURE_2D, l, 0, 0, 0, arrays[unit], GL_TEXTURE_2D_ARRAY, l - firstLevel, 0, 0, layer,
+			std::max(1, texture->width >> l), std::max(1, texture->height >> l), 1);
+}
+
+void TextureArrays::copyToAtlas(const Texture* texture, unsigned int unit, int x, int y, int layer)
+{
+	for (int l = 0; l < atlasLevelCount; ++l)
+	{
+		//textures with fewer levels than the atlas repeat their smallest one.
+		int sourceLevel = std::min(l, texture->levelCount - 1);
+		glCopyImageSubData(texture->texture, GL_TEXTURE_2D, sourceLevel, 0, 0, 0,
+			arrays[unit], GL_TEXTURE_2D_ARRAY, l, x >> l, y >> l, layer,
+			std::max(1, texture->width >> sourceLevel), std::max(1, texture->height >> sourceLevel), 1);
+	}
+}
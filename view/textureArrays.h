@@ -0,0 +1,83 @@
+#pragma once
+#include "../config.h"
+#include "texture.h"
+
+//the shader's sampler2DArray count, array i is bound to texture unit i. leaves 2 of the 16 units
+//every driver has to the virtual texture.
+const unsigned int maxTextureArrays = 14;
+
+//where a texture ended up: an array, a layer of it and the part of the layer it covers.
+struct TextureSlot
+{
+	unsigned int array;
+	float layer;
+	//xy scale, zw offset. a whole layer has scale 1 and offset 0.
+	glm::vec4 uvTransform;
+	//atlas regions repeat and clamp in the shader instead of through the sampler.
+	bool atlasRegion;
+};
+
+//gathers many textures into a few GL_TEXTURE_2D_ARRAYs so materials switch with uniforms instead of binds.
+//textures of equal size, format and level count become layers of one array. the remaining small
+//rgba8 ones are shelf packed into the layers of an atlas array, anything else gets an array of its own.
+//the arrays hold the only copy, a texture that changes size later moves to a layer of the array
+//for its new size.
+class TextureArrays
+{
+public:
+	//array on every unit, 0 for units without one.
+	std::vector<unsigned int> arrays;
+	//counts arrays deleted because nothing was left in them, a changed count means a unit freed up.
+	uint64_t releasedArrays;
+
+	TextureArrays();
+	~TextureArrays();
+
+	//copies the textures on the gpu and releases their own storage. the largest groups get a unit
+	//each, small rgba8 ones left over share the atlas and others go into an array of their format whose
+	//size one of their levels has, starting at that level. a texture none of that works for is
+	//reported and samples the first array. call once.
+	void build(const std::vector<Texture*>& textures);
+	//where build, or setFirstLevel since, put the texture.
+	TextureSlot slot(const Texture* texture);
+	//whether setFirstLevel can move the texture. atlas textures keep the size they were packed at.
+	bool resizable(const Texture* texture);
+	//Texture::setFirstLevel for a texture build packed. the levels it keeps are copied from its layer
+	//into a free layer of the array for its new size, adding layers or an array as needed, the ones
+	//it gets back come from region. false if there's no unit for a new array, the texture stays as
+	//it is and the caller has to tell TextureResidency.
+	bool setFirstLevel(Texture* texture, int level, const UploadRegion* region, UploadRing* uploads);
+	//bytes of every array, free layers and atlas space included.
+	size_t residentBytes();
+	//binds every array to its unit with one call.
+	void bind();
+	void clear();
+
+private:
+	//what textures have to agree on to be layers of one array.
+	typedef std::array<int, 4> ArrayKey;
+
+	struct ArrayLayers
+	{
+		ArrayKey key;
+		int layerCount;
+		std::vector<int> freeLayers;
+	};
+
+	static ArrayKey keyOf(const Texture* texture);
+	//a unit without an array, -1 when all are taken.
+	int freeUnit();
+	//creates an array of layerCount layers for key on unit.
+	void addArray(int unit, const ArrayKey& key, int layerCount);
+	//a free layer of an array for key, growing or adding one. false if that needs a unit there isn't.
+	bool allocateLayer(const ArrayKey& key, unsigned int& unit, int& layer);
+	void freeLayer(const TextureSlot& slot);
+	//copies the texture's own storage from its level firstLevel on.
+	void copyLayer(const Texture* texture, int firstLevel, unsigned int unit, int layer);
+	void copyToAtlas(const Texture* texture, unsigned int unit, int x, int y, int layer);
+
+	//layer bookkeeping of every unit, key[0] is 0 for units without an array and for the atlas.
+	std::vector<ArrayLayers> layers;
+	std::unordered_map<const Texture*, TextureSlot> slots;
+	int atlasUnit, atlasSize, atlasLevelCount, atlasLayerCount;
+};
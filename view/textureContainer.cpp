@@ -0,0 +1,350 @@
+#include "textureContainer.h"
+
+namespace
+{
+	const unsigned char ktx2Identifier[12] = { 0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n' };
+
+	//vkFormat values, the _SRGB variant always follows the _UNORM one.
+	const uint32_t vkFormatBc1RgbUnorm = 131;
+	const uint32_t vkFormatBc1RgbaUnorm = 133;
+	const uint32_t vkFormatBc3Unorm = 137;
+	const uint32_t vkFormatBc5Unorm = 141;
+	const uint32_t vkFormatBc7Unorm = 145;
+
+	//dxgi formats, again with the _SRGB variant right after where there is one.
+	const uint32_t dxgiFormatBc1Unorm = 71;
+	const uint32_t dxgiFormatBc3Unorm = 77;
+	const uint32_t dxgiFormatBc5Unorm = 83;
+	const uint32_t dxgiFormatBc7Unorm = 98;
+
+	struct Ktx2Header
+	{
+		uint32_t vkFormat, typeSize, pixelWidth, pixelHeight, pixelDepth, layerCount, faceCount, levelCount, supercompressionScheme;
+		uint32_t dfdByteOffset, dfdByteLength, kvdByteOffset, kvdByteLength;
+		uint64_t sgdByteOffset, sgdByteLength;
+	};
+
+	struct Ktx2Level
+	{
+		uint64_t byteOffset, byteLength, uncompressedByteLength;
+	};
+
+	struct DdsPixelFormat
+	{
+		uint32_t size, flags, fourCC, rgbBitCount, redMask, greenMask, blueMask, alphaMask;
+	};
+
+	struct DdsHeader
+	{
+		uint32_t size, flags, height, width, pitchOrLinearSize, depth, mipMapCount, reserved1[11];
+		DdsPixelFormat pixelFormat;
+		uint32_t caps, caps2, caps3, caps4, reserved2;
+	};
+
+	struct DdsHeaderDx10
+	{
+		uint32_t dxgiFormat, resourceDimension, miscFlag, arraySize, miscFlags2;
+	};
+
+	const uint32_t ddsPixelFormatFourCC = 0x4;
+
+	uint32_t fourCC(const char* code)
+	{
+		return uint32_t(uint8_t(code[0])) | uint32_t(uint8_t(code[1])) << 8 | uint32_t(uint8_t(code[2])) << 16 | uint32_t(uint8_t(code[3])) << 24;
+	}
+
+	uint64_t alignOffset(uint64_t offset, uint64_t alignment)
+	{
+		return (offset + alignment - 1) / alignment * alignment;
+	}
+
+	uint32_t vkFormat(BlockFormat format)
+	{
+		switch (format)
+		{
+		case BlockFormat::BC1:
+			return vkFormatBc1RgbUnorm;
+		case BlockFormat::BC3:
+			return vkFormatBc3Unorm;
+		case BlockFormat::BC5:
+			return vkFormatBc5Unorm;
+		default:
+			return vkFormatBc7Unorm;
+		}
+	}
+
+	//basic data format descriptor, required by ktx2 even though vkFormat already says it all.
+	std::vector<uint32_t> dataFormatDescriptor(BlockFormat format)
+	{
+		//khr_df color model and the channel of each 64 bit half of a block.
+		uint32_t colorModel;
+		std::vector<uint32_t> channels;
+		switch (format)
+		{
+		case BlockFormat::BC1:
+			colorModel = 128;
+			channels = { 0 };
+			break;
+		case BlockFormat::BC3:
+			colorModel = 130;
+			channels = { 15, 0 };
+			break;
+		case BlockFormat::BC5:
+			colorModel = 132;
+			channels = { 0, 1 };
+			break;
+		default:
+			colorModel = 134;
+			channels = { 0 };
+			break;
+		}
+
+		uint32_t blockSize = uint32_t(24 + 16 * channels.size());
+		uint32_t bytesPerBlock = uint32_t(util::blockBytes(format));
+		//bc1 and bc7 have one sample covering the whole block.
+		uint32_t sampleBits = bytesPerBlock * 8 / uint32_t(channels.size());
+
+		std::vector<uint32_t> words;
+		words.push_back(4 + blockSize);
+		words.push_back(0);
+		words.push_back(2 | blockSize << 16);
+		//bt709 primaries, linear transfer to match the unorm vkFormat.
+		words.push_back(colorModel | 1 << 8 | 1 << 16);
+		//4x4x1x1 texels, dimensions are stored minus one.
+		words.push_back(3 | 3 << 8);
+		words.push_back(bytesPerBlock);
+		words.push_back(0);
+		for (size_t i = 0; i < channels.size(); ++i)
+		{
+			words.push_back(uint32_t(i) * sampleBits | (sampleBits - 1) << 16 | channels[i] << 24);
+			words.push_back(0);
+			words.push_back(0);
+			words.push_back(0xFFFFFFFF);
+		}
+		return words;
+	}
+
+	//gl format of a vkFormat, 0 for anything this loader doesn't take.
+	uint32_t ktx2InternalFormat(uint32_t format)
+	{
+		if (format == vkFormatBc1RgbUnorm || format == vkFormatBc1RgbUnorm + 1)
+			return GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+		if (format == vkFormatBc1RgbaUnorm || format == vkFormatBc1RgbaUnorm + 1)
+			return GL_COMPRESSED_RGBA_S3TC_DXT1_EXT;
+		if (format == vkFormatBc3Unorm || format == vkFormatBc3Unorm + 1)
+			return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+		if (format == vkFormatBc5Unorm)
+			return GL_COMPRESSED_RG_RGTC2;
+		if (format == vkFormatBc7Unorm || format == vkFormatBc7Unorm + 1)
+			return GL_COMPRESSED_RGBA_BPTC_UNORM;
+		return 0;
+	}
+
+	uint32_t ddsInternalFormat(const DdsPixelFormat& pixelFormat, const DdsHeaderDx10* dx10)
+	{
+		if (dx10)
+		{
+			uint32_t format = dx10->dxgiFormat;
+			if (format == dxgiFormatBc1Unorm || format == dxgiFormatBc1Unorm + 1)
+				return GL_COMPRESSED_RGBA_S3TC_DXT1_EXT;
+			if (format == dxgiFormatBc3Unorm || format == dxgiFormatBc3Unorm + 1)
+				return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+			if (format == dxgiFormatBc5Unorm)
+				return GL_COMPRESSED_RG_RGTC2;
+			if (format == dxgiFormatBc7Unorm || format == dxgiFormatBc7Unorm + 1)
+				return GL_COMPRESSED_RGBA_BPTC_UNORM;
+			return 0;
+		}
+
+		//dds has no flag for opaque bc1, decode the punch through alpha in case it's used.
+		if (pixelFormat.fourCC == fourCC("DXT1"))
+			return GL_COMPRESSED_RGBA_S3TC_DXT1_EXT;
+		if (pixelFormat.fourCC == fourCC("DXT5"))
+			return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+		if (pixelFormat.fourCC == fourCC("ATI2") || pixelFormat.fourCC == fourCC("BC5U"))
+			return GL_COMPRESSED_RG_RGTC2;
+		return 0;
+	}
+
+	size_t internalFormatBlockBytes(uint32_t internalFormat)
+	{
+		return internalFormat == GL_COMPRESSED_RGB_S3TC_DXT1_EXT || internalFormat == GL_COMPRESSED_RGBA_S3TC_DXT1_EXT ? 8 : 16;
+	}
+
+	size_t levelBytes(uint32_t internalFormat, int width, int height)
+	{
+		return size_t((width + 3) / 4) * size_t((height + 3) / 4) * internalFormatBlockBytes(internalFormat);
+	}
+
+	bool validSize(uint32_t width, uint32_t height, uint32_t levelCount)
+	{
+		if (width == 0 || height == 0 || width > (1u << 15) || height > (1u << 15))
+			return false;
+		return levelCount >= 1 && levelCount <= compressedTextureMaxLevels
+			&& levelCount <= uint32_t(util::mipLevelCount(int(width), int(height)));
+	}
+}
+
+bool util::ktx2Write(const char* filename, BlockFormat format, int width, int height, const std::vector<std::vector<unsigned char>>& levels)
+{
+	if (levels.empty() || levels.size() > compressedTextureMaxLevels)
+		return false;
+
+	std::vector<uint32_t> dfd = dataFormatDescriptor(format);
+	uint64_t levelAlignment = blockBytes(format);
+
+	Ktx2Header header{};
+	header.vkFormat = vkFormat(format);
+	header.typeSize = 1;
+	header.pixelWidth = uint32_t(width);
+	header.pixelHeight = uint32_t(height);
+	header.faceCount = 1;
+	header.levelCount = uint32_t(levels.size());
+	header.dfdByteOffset = uint32_t(sizeof(ktx2Identifier) + sizeof(header) + levels.size() * sizeof(Ktx2Level));
+	header.dfdByteLength = uint32_t(dfd.size() * sizeof(uint32_t));
+
+	//the index lists level 0 first, but the data is stored smallest level first.
+	std::vector<Ktx2Level> index(levels.size());
+	uint64_t offset = header.dfdByteOffset + header.dfdByteLength;
+	for (size_t l = levels.size(); l-- > 0;)
+	{
+		offset = alignOffset(offset, levelAlignment);
+		index[l] = { offset, levels[l].size(), levels[l].size() };
+		offset += levels[l].size();
+	}
+
+	std::ofstream file(filename, std::ios::binary | std::ios::trunc);
+	if (!file)
+		return false;
+
+	file.write(reinterpret_cast<const char*>(ktx2Identifier), sizeof(ktx2Identifier));
+	file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	file.write(reinterpret_cast<const char*>(index.data()), index.size() * sizeof(Ktx2Level));
+	file.write(reinterpret_cast<const char*>(dfd.data()), header.dfdByteLength);
+
+	const char padding[16] = {};
+	uint64_t written = header.dfdByteOffset + header.dfdByteLength;
+	for (size_t l = levels.size(); l-- > 0;)
+	{
+		file.write(padding, index[l].byteOffset - written);
+		file.write(reinterpret_cast<const char*>(levels[l].data()), levels[l].size());
+		written = index[l].byteOffset + index[l].byteLength;
+	}
+
+	return bool(file);
+}
+
+bool util::ktx2Parse(const mappedFile& file, CompressedTexture& texture)
+{
+	if (!file.data || file.size < sizeof(ktx2Identifier) + sizeof(Ktx2Header)
+		|| memcmp(file.data, ktx2Identifier, sizeof(ktx2Identifier)) != 0)
+	{
+		std::cout << "Not a ktx2 file\n";
+		return false;
+	}
+
+	Ktx2Header header;
+	memcpy(&header, file.data + sizeof(ktx2Identifier), sizeof(header));
+	if (header.supercompressionScheme != 0)
+	{
+		std::cout << "Supercompressed ktx2 (scheme " << header.supercompressionScheme << ") isn't supported, only plain block compressed levels\n";
+		return false;
+	}
+
+	texture.internalFormat = ktx2InternalFormat(header.vkFormat);
+	if (!texture.internalFormat)
+	{
+		std::cout << "Unsupported ktx2 vkFormat " << header.vkFormat << ", expected bc1, bc3, bc5 or bc7\n";
+		return false;
+	}
+	//0 levels asks the loader to generate them, which compressed data can't do.
+	if (header.pixelDepth > 1 || header.layerCount > 1 || header.faceCount != 1
+		|| !validSize(header.pixelWidth, header.pixelHeight, header.levelCount))
+	{
+		std::cout << "Unsupported ktx2 layout, expected a 2d texture with stored levels\n";
+		return false;
+	}
+
+	size_t indexOffset = sizeof(ktx2Identifier) + sizeof(header);
+	if (indexOffset + header.levelCount * sizeof(Ktx2Level) > file.size)
+	{
+		std::cout << "Truncated ktx2 file\n";
+		return false;
+	}
+
+	texture.width = int(header.pixelWidth);
+	texture.height = int(header.pixelHeight);
+	texture.levelCount = int(header.levelCount);
+	for (int l = 0; l < texture.levelCount; ++l)
+	{
+		Ktx2Level level;
+		memcpy(&level, file.data + indexOffset + l * sizeof(Ktx2Level), sizeof(level));
+		size_t expected = levelBytes(texture.internalFormat, std::max(1, texture.width >> l), std::max(1, texture.height >> l));
+		if (level.byteLength < expected || level.byteOffset > file.size || level.byteLength > file.size - level.byteOffset)
+		{
+			std::cout << "Truncated ktx2 file\n";
+			return false;
+		}
+		texture.levelData[l] = file.data + level.byteOffset;
+		texture.levelBytes[l] = expected;
+	}
+	return true;
+}
+
+bool util::ddsParse(const mappedFile& file, CompressedTexture& texture)
+{
+	if (!file.data || file.size < 4 + sizeof(DdsHeader) || memcmp(file.data, "DDS ", 4) != 0)
+	{
+		std::cout << "Not a dds file\n";
+		return false;
+	}
+
+	DdsHeader header;
+	memcpy(&header, file.data + 4, sizeof(header));
+	size_t offset = 4 + sizeof(header);
+
+	DdsHeaderDx10 dx10;
+	bool hasDx10 = (header.pixelFormat.flags & ddsPixelFormatFourCC) && header.pixelFormat.fourCC == fourCC("DX10");
+	if (hasDx10)
+	{
+		if (file.size < offset + sizeof(dx10))
+		{
+			std::cout << "Truncated dds file\n";
+			return false;
+		}
+		memcpy(&dx10, file.data + offset, sizeof(dx10));
+		offset += sizeof(dx10);
+	}
+
+	texture.internalFormat = (header.pixelFormat.flags & ddsPixelFormatFourCC) ? ddsInternalFormat(header.pixelFormat, hasDx10 ? &dx10 : nullptr) : 0;
+	if (!texture.internalFormat)
+	{
+		std::cout << "Unsupported dds format, expected bc1, bc3, bc5 or bc7\n";
+		return false;
+	}
+	//no mip count means a single level.
+	uint32_t levelCount = std::max(1u, header.mipMapCount);
+	if (!validSize(header.width, header.height, levelCount) || (hasDx10 && dx10.arraySize > 1))
+	{
+		std::cout << "Unsupported dds layout, expected a 2d texture\n";
+		return false;
+	}
+
+	//dds levels follow each other largest first without padding.
+	texture.width = int(header.width);
+	texture.height = int(header.height);
+	texture.levelCount = int(levelCount);
+	for (int l = 0; l < texture.levelCount; ++l)
+	{
+		size_t bytes = levelBytes(texture.internalFormat, std::max(1, texture.width >> l), std::max(1, texture.height >> l));
+		if (offset + bytes > file.size)
+		{
+			std::cout << "Truncated dds file\n";
+			return false;
+		}
+		texture.levelData[l] = file.data + offset;
+		texture.levelBytes[l] = bytes;
+		offset += bytes;
+	}
+	return true;
+}
@@ -0,0 +1,29 @@
+#pragma once
+#include "../config.h"
+#include "mappedFile.h"
+#include "blockCompression.h"
+
+//enough for a 32768 texel wide texture.
+const uint32_t compressedTextureMaxLevels = 16;
+
+//block compressed levels read from a .ktx2 or .dds file, level 0 is the largest.
+//the level pointers point into the mapping the file was parsed from.
+struct CompressedTexture
+{
+	//the glCompressedTextureSubImage2D internal format.
+	uint32_t internalFormat;
+	int width, height, levelCount;
+	const unsigned char* levelData[compressedTextureMaxLevels];
+	size_t levelBytes[compressedTextureMaxLevels];
+};
+
+namespace util
+{
+	//ktx2 with the levels already compressed, no supercompression. levels[0] is the width x height level.
+	bool ktx2Write(const char* filename, BlockFormat format, int width, int height, const std::vector<std::vector<unsigned char>>& levels);
+
+	//bc1, bc3, bc5 and bc7 2d textures only. srgb variants are read as their unorm format like every other texture.
+	//false with a message for anything else, supercompressed ktx2 (basis, zstd) included.
+	bool ktx2Parse(const mappedFile& file, CompressedTexture& texture);
+	bool ddsParse(const mappedFile& file, CompressedTexture& texture);
+}
@@ -0,0 +1,224 @@
+#include "textureResidency.h"
+
+TextureResidency::TextureResidency(TextureResidencyCreateInfo* createInfo)
+{
+	budgetBytes = createInfo->budgetBytes;
+	evictAfterFrames = createInfo->evictAfterFrames;
+	maxPendingReloads = std::max(1u, createInfo->maxPendingReloads);
+	evictedSize = std::max(1, createInfo->evictedSize);
+	uploads = createInfo->uploads;
+	frame = 0;
+	ringFull = false;
+	stopping = false;
+	loader = std::thread(&TextureResidency::loaderLoop, this);
+}
+
+TextureResidency::~TextureResidency()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	wake.notify_all();
+	if (loader.joinable())
+		loader.join();
+
+	//levels that were read but never applied.
+	for (const Reload& reload : loaded)
+		uploads->release(reload.region);
+}
+
+void TextureResidency::track(const std::vector<Texture*>& textures, const std::vector<Texture*>& fixedSize)
+{
+	this->textures.clear();
+	for (Texture* texture : textures)
+		if (std::find(this->textures.begin(), this->textures.end(), texture) == this->textures.end())
+			this->textures.push_back(texture);
+	this->fixedSize = std::unordered_set<const Texture*>(fixedSize.begin(), fixedSize.end());
+}
+
+void TextureResidency::loaderLoop()
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	while (true)
+	{
+		wake.wait(lock, [this] { return stopping || (!requests.empty() && !ringFull); });
+		if (stopping)
+			return;
+
+		Reload reload = requests.back();
+		if (!uploads->allocate(reload.texture->levelBytes(reload.level, reload.count), reload.region))
+		{
+			ringFull = true;
+			continue;
+		}
+		requests.pop_back();
+
+		//the render thread keeps going while the disk is busy.
+		lock.unlock();
+		reload.read = reload.texture->readLevels(reload.level, reload.count, reload.region.data);
+		lock.lock();
+		loaded.push_back(reload);
+	}
+}
+
+const std::vector<TextureChange>& TextureResidency::update(size_t overheadBytes)
+{
+	++frame;
+	changes.clear();
+
+	//finished reloads apply first, whatever the budget says now. it shrinks them again next frame.
+	std::deque<Reload> done;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		done.swap(loaded);
+		ringFull = false;
+	}
+	wake.notify_one();
+	for (const Reload& reload : done)
+	{
+		reloading.erase(reload.texture);
+		if (reload.read)
+		{
+			changes.push_back({ reload.texture, reload.level, reload.region });
+			continue;
+		}
+		//don't try the disk every frame, the texture can still drop levels.
+		std::cout << "Failed to reload a texture, it keeps its current size\n";
+		reload.texture->stopReloading();
+		uploads->release(reload.region);
+	}
+
+	//everything at full size, then the least recently used shrink until it fits. ties go to the
+	//largest, so textures drawn every frame lose levels evenly. ones that can't be reloaded start
+	//from the size they have. textures still loading or just loaded count as they will be and don't
+	//move this frame, fixed and blocked ones never do.
+	std::vector<int> levels(textures.size(), 0);
+	std::vector<bool> settled(textures.size(), false);
+	for (size_t i = 0; i < textures.size(); ++i)
+	{
+		if (!textures[i]->reloadable())
+			levels[i] = textures[i]->firstLevel;
+		if (reloading.count(textures[i]) || fixedSize.count(textures[i]) || blocked.count(textures[i]))
+		{
+			levels[i] = textures[i]->firstLevel;
+			settled[i] = true;
+		}
+		for (const TextureChange& change : changes)
+			if (change.texture == textures[i])
+			{
+				levels[i] = change.level;
+				settled[i] = true;
+			}
+	}
+	size_t total = overheadBytes;
+	for (size_t i = 0; i < textures.size(); ++i)
+		total += bytesFrom(textures[i], levels[i]);
+	while (total > budgetBytes)
+	{
+		int pick = -1;
+		for (size_t i = 0; i < textures.size(); ++i)
+		{
+			if (settled[i] || levels[i] >= evictedLevel(textures[i]))
+				continue;
+			if (pick < 0 || textures[i]->lastUsed < textures[pick]->lastUsed
+				|| (textures[i]->lastUsed == textures[pick]->lastUsed && bytesFrom(textures[i], levels[i]) > bytesFrom(textures[pick], levels[pick])))
+				pick = int(i);
+		}
+		//every texture is as small as it gets, the budget is too small for this many.
+		if (pick < 0)
+			break;
+
+		const Texture* texture = textures[pick];
+		int level = texture->lastUsed + evictAfterFrames < frame ? evictedLevel(texture) : levels[pick] + 1;
+		total = total - bytesFrom(texture, levels[pick]) + bytesFrom(texture, level);
+		levels[pick] = level;
+	}
+
+	//shrinking happens on the gpu right away.
+	std::vector<size_t> growing;
+	for (size_t i = 0; i < textures.size(); ++i)
+	{
+		if (settled[i])
+			continue;
+		if (levels[i] > textures[i]->firstLevel)
+			changes.push_back({ textures[i], levels[i], {} });
+		else if (levels[i] < textures[i]->firstLevel && textures[i]->reloadable())
+			growing.push_back(i);
+	}
+
+	//growing reads from disk, the most recently used first and only a few at once. the rest stay as
+	//small as they are, which keeps them under the budget too.
+	std::sort(growing.begin(), growing.end(), [&](size_t a, size_t b) { return textures[a]->lastUsed > textures[b]->lastUsed; });
+	std::vector<Reload> queued;
+	for (size_t i : growing)
+	{
+		if (reloading.size() >= maxPendingReloads)
+			break;
+		//a region has to fit the ring, large textures come back a few levels at a time.
+		Texture* texture = textures[i];
+		int level = levels[i];
+		while (level < texture->firstLevel && !uploads->fits(texture->levelBytes(level, texture->firstLevel - level)))
+			++level;
+		if (level == texture->firstLevel)
+		{
+			std::cout << "Texture level too large for the upload ring, the texture keeps its current size\n";
+			texture->stopReloading();
+			continue;
+		}
+		queued.push_back({ texture, level, texture->firstLevel - level, {}, false });
+		reloading.insert(texture);
+	}
+	if (!queued.empty())
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			//the loader takes from the back, most recently used last.
+			requests.insert(requests.begin(), queued.rbegin(), queued.rend());
+		}
+		wake.notify_one();
+	}
+	return changes;
+}
+
+void TextureResidency::finish()
+{
+	//the copies out of them are issued, the ring fences them on its next submit.
+	for (const TextureChange& change : changes)
+		if (change.region.data)
+			uploads->release(change.region);
+	changes.clear();
+}
+
+void TextureResidency::block(const Texture* texture)
+{
+	blocked.insert(texture);
+}
+
+void TextureResidency::unblock()
+{
+	blocked.clear();
+}
+
+size_t TextureResidency::residentBytes()
+{
+	size_t total = 0;
+	for (const Texture* texture : textures)
+		total += util::textureBytes(texture->internalFormat, texture->width, texture->height, texture->levelCount);
+	return total;
+}
+
+size_t TextureResidency::bytesFrom(const Texture* texture, int level)
+{
+	return util::textureBytes(texture->internalFormat, std::max(1, texture->sourceWidth >> level), std::max(1, texture->sourceHeight >> level),
+		texture->sourceLevelCount - level);
+}
+
+int TextureResidency::evictedLevel(const Texture* texture)
+{
+	int level = 0;
+	while (level + 1 < texture->sourceLevelCount
+		&& std::max(texture->sourceWidth >> level, texture->sourceHeight >> level) > evictedSize)
+		++level;
+	return level;
+}
@@ -0,0 +1,96 @@
+#pragma once
+#include "../config.h"
+#include "texture.h"
+#include "uploadRing.h"
+
+struct TextureResidencyCreateInfo
+{
+	//bytes every tracked texture may take together, mips included.
+	size_t budgetBytes;
+	//textures no material drew with for this many frames get evicted before anything loses a mip.
+	unsigned int evictAfterFrames;
+	//an evicted texture keeps the level whose larger side is at most this, so it still samples as
+	//a blurry version of itself until it's reloaded.
+	int evictedSize;
+	//textures the loader thread may be reading levels of at once.
+	unsigned int maxPendingReloads;
+	//levels that come back are read straight into it.
+	UploadRing* uploads;
+};
+
+//a texture that gets a new first level this frame. growing ones bring the levels they didn't have
+//in region, shrinking ones have nothing there.
+struct TextureChange
+{
+	Texture* texture;
+	int level;
+	UploadRegion region;
+};
+
+//keeps the material textures under a memory budget. when they don't fit, the least recently used
+//ones lose their largest levels first, down to a few texels for the ones not drawn in a while.
+//levels come back once they fit again, most recently used first, read on a loader thread.
+class TextureResidency
+{
+public:
+	//advanced by update, materials stamp their texture with it when they're used.
+	uint64_t frame;
+
+	TextureResidency(TextureResidencyCreateInfo* createInfo);
+	~TextureResidency();
+
+	//replaces the tracked textures, ones shared by several materials count once. fixedSize are among
+	//them and keep the levels they have, e.g. atlas textures.
+	void track(const std::vector<Texture*>& textures, const std::vector<Texture*>& fixedSize);
+	//call once a frame. picks the first level of every texture for the budget and returns the ones
+	//that change now: textures that shrink, and textures that grow whose levels finished loading. the
+	//rest of the growing ones are queued on the loader, a texture is left alone while it loads.
+	//changed textures get new names, see Texture::setFirstLevel. overheadBytes is memory the
+	//textures take on top of their own, e.g. free array layers, it counts against the budget too.
+	const std::vector<TextureChange>& update(size_t overheadBytes);
+	//call once the changes of update are applied, their regions go back to the ring.
+	void finish();
+	//a change update returned couldn't be applied, e.g. no texture unit is left for the new size.
+	//the texture keeps its levels and counts as them, it's neither reloaded nor shrunk until unblock.
+	void block(const Texture* texture);
+	//lets blocked textures change again, once whatever stopped them may be gone.
+	void unblock();
+	//bytes the tracked textures take as they are now.
+	size_t residentBytes();
+
+private:
+	struct Reload
+	{
+		Texture* texture;
+		int level, count;
+		UploadRegion region;
+		bool read;
+	};
+
+	void loaderLoop();
+	//bytes of texture from level of its source chain down.
+	size_t bytesFrom(const Texture* texture, int level);
+	//level an evicted texture keeps.
+	int evictedLevel(const Texture* texture);
+
+	size_t budgetBytes;
+	unsigned int evictAfterFrames, maxPendingReloads;
+	int evictedSize;
+	UploadRing* uploads;
+	std::vector<Texture*> textures;
+	std::unordered_set<const Texture*> fixedSize, blocked;
+	//what the last update returned.
+	std::vector<TextureChange> changes;
+	//textures from the moment their reload is queued until its levels are applied, gl thread only.
+	std::unordered_set<const Texture*> reloading;
+
+	//shared with the loader, guarded by mutex.
+	std::thread loader;
+	std::mutex mutex;
+	std::condition_variable wake;
+	std::vector<Reload> requests;
+	std::deque<Reload> loaded;
+	//set when the loader couldn't get ring space, it waits for the next frame to free some.
+	bool ringFull;
+	bool stopping;
+};
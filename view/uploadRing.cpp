@@ -0,0 +1,136 @@
+#include "uploadRing.h"
+
+namespace
+{
+	//enough for any pixel unpack offset and keeps regions on cache lines.
+	const size_t regionAlignment = 64;
+
+	const unsigned int ringFlags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+}
+
+UploadRing::UploadRing(UploadRingCreateInfo* createInfo)
+	: frontSerial(1), head(0), tail(0), submits(0), completedSubmit(0)
+{
+	capacity = (createInfo->bytes + regionAlignment - 1) / regionAlignment * regionAlignment;
+	glCreateBuffers(1, &buffer);
+	glNamedBufferStorage(buffer, capacity, nullptr, ringFlags);
+	mapped = static_cast<unsigned char*>(glMapNamedBufferRange(buffer, 0, capacity, ringFlags));
+	if (!mapped)
+		std::cout << "Failed to map the upload ring\n";
+}
+
+UploadRing::~UploadRing()
+{
+	for (const auto& fence : fences)
+		glDeleteSync(fence.second);
+	glUnmapNamedBuffer(buffer);
+	glDeleteBuffers(1, &buffer);
+}
+
+bool UploadRing::allocate(size_t size, UploadRegion& region)
+{
+	size = (size + regionAlignment - 1) / regionAlignment * regionAlignment;
+	std::lock_guard<std::mutex> lock(mutex);
+	if (!mapped || size == 0 || size >= capacity)
+		return false;
+
+	//head == tail only ever means empty, so a region may not end right on the tail.
+	size_t begin;
+	if (allocations.empty())
+		begin = head = tail = 0;
+	else if (head >= tail && head + size <= capacity)
+		begin = head;
+	else if (head >= tail && size < tail)
+		begin = 0;
+	else if (head < tail && head + size < tail)
+		begin = head;
+	else
+		return false;
+
+	allocations.push_back({ begin, begin + size, false, 0 });
+	head = begin + size;
+	region.data = mapped + begin;
+	region.offset = begin;
+	region.size = size;
+	region.serial = frontSerial + allocations.size() - 1;
+	return true;
+}
+
+bool UploadRing::fits(size_t size)
+{
+	size = (size + regionAlignment - 1) / regionAlignment * regionAlignment;
+	return mapped && size > 0 && size < capacity;
+}
+
+void UploadRing::copyToBuffer(const UploadRegion& region, size_t offset, size_t size, unsigned int destination, size_t destinationOffset)
+{
+	glCopyNamedBufferSubData(buffer, destination, region.offset + offset, destinationOffset, size);
+}
+
+void UploadRing::copyToTexture(const UploadRegion& region, size_t offset, unsigned int texture, int level, int x, int y,
+	int width, int height, unsigned int format, unsigned int type)
+{
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer);
+	glTextureSubImage2D(texture, level, x, y, width, height, format, type, reinterpret_cast<const void*>(region.offset + offset));
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+}
+
+void UploadRing::copyToTextureLayer(const UploadRegion& region, size_t offset, unsigned int texture, int level, int x, int y, int layer,
+	int width, int height, unsigned int format, unsigned int type)
+{
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer);
+	glTextureSubImage3D(texture, level, x, y, layer, width, height, 1, format, type, reinterpret_cast<const void*>(region.offset + offset));
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+}
+
+void UploadRing::copyCompressedToTexture(const UploadRegion& region, size_t offset, size_t size, unsigned int texture, int level, int layer,
+	int width, int height, unsigned int internalFormat)
+{
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer);
+	const void* data = reinterpret_cast<const void*>(region.offset + offset);
+	if (layer < 0)
+		glCompressedTextureSubImage2D(texture, level, 0, 0, width, height, internalFormat, GLsizei(size), data);
+	else
+		glCompressedTextureSubImage3D(texture, level, 0, 0, layer, width, height, 1, internalFormat, GLsizei(size), data);
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+}
+
+void UploadRing::release(const UploadRegion& region)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	allocations[size_t(region.serial - frontSerial)].released = true;
+}
+
+void UploadRing::submit()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	//one fence covers every copy issued since the last one.
+	bool unfenced = false;
+	for (Allocation& allocation : allocations)
+		if (allocation.released && !allocation.fence)
+		{
+			allocation.fence = submits + 1;
+			unfenced = true;
+		}
+	if (unfenced)
+		fences.push_back(std::make_pair(++submits, glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0)));
+
+	while (!fences.empty())
+	{
+		GLenum status = glClientWaitSync(fences.front().second, 0, 0);
+		if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+			break;
+		completedSubmit = fences.front().first;
+		glDeleteSync(fences.front().second);
+		fences.pop_front();
+	}
+
+	//regions come back in ring order, one still being written holds up the ones after it.
+	while (!allocations.empty() && allocations.front().fence && allocations.front().fence <= completedSubmit)
+	{
+		tail = allocations.front().end;
+		allocations.pop_front();
+		++frontSerial;
+	}
+}
@@ -0,0 +1,70 @@
+#pragma once
+#include "../config.h"
+
+struct UploadRingCreateInfo
+{
+	//staging memory, the largest single upload has to fit.
+	size_t bytes;
+};
+
+//part of the ring reserved by allocate, data is write only.
+struct UploadRegion
+{
+	unsigned char* data;
+	size_t offset, size;
+	uint64_t serial;
+};
+
+//staging memory for streamed data: one persistently mapped, coherent buffer used as a ring.
+//loader threads reserve a region and write into it straight from disk, the gl thread copies from
+//it into buffers and textures on the gpu. regions come back once a fence after their copies
+//has passed, so the cpu never waits on the gpu and nothing goes through driver copies.
+class UploadRing
+{
+public:
+	unsigned int buffer;
+
+	UploadRing(UploadRingCreateInfo* createInfo);
+	~UploadRing();
+
+	//any thread. false while the ring is full of data that wasn't copied or still gets read,
+	//try again after the next submit.
+	bool allocate(size_t size, UploadRegion& region);
+	//any thread. whether allocate can ever give a region of size, however empty the ring gets.
+	bool fits(size_t size);
+	//gl thread. copies size bytes from offset into the region.
+	void copyToBuffer(const UploadRegion& region, size_t offset, size_t size, unsigned int destination, size_t destinationOffset);
+	void copyToTexture(const UploadRegion& region, size_t offset, unsigned int texture, int level, int x, int y,
+		int width, int height, unsigned int format, unsigned int type);
+	//into one layer of an array texture.
+	void copyToTextureLayer(const UploadRegion& region, size_t offset, unsigned int texture, int level, int x, int y, int layer,
+		int width, int height, unsigned int format, unsigned int type);
+	//block compressed data goes as it is, size bytes of it. layer -1 for a 2d texture.
+	void copyCompressedToTexture(const UploadRegion& region, size_t offset, size_t size, unsigned int texture, int level, int layer,
+		int width, int height, unsigned int internalFormat);
+	//any thread. the region is done with once every copy reading it has been issued, or if it's dropped.
+	void release(const UploadRegion& region);
+	//gl thread, once a frame. fences the copies issued since the last submit and takes back the
+	//regions whose fence has passed.
+	void submit();
+
+private:
+	struct Allocation
+	{
+		size_t begin, end;
+		bool released;
+		//submit that fenced it, 0 until released and fenced.
+		uint64_t fence;
+	};
+
+	unsigned char* mapped;
+	size_t capacity;
+	//allocations in ring order, front is the oldest. serial of the front one.
+	std::deque<Allocation> allocations;
+	uint64_t frontSerial;
+	size_t head, tail;
+	//fences in submit order with their submit number, and the last submit known to be done.
+	std::deque<std::pair<uint64_t, GLsync>> fences;
+	uint64_t submits, completedSubmit;
+	std::mutex mutex;
+};
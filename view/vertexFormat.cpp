@@ -0,0 +1,158 @@
+#include "vertexFormat.h"
+
+namespace
+{
+	uint32_t alignAttribute(uint32_t offset)
+	{
+		return (offset + 3) & ~3u;
+	}
+
+	//largest half extent gets the full snorm range, flat axes keep a scale of 1 to avoid dividing by 0.
+	float safeScale(float extent)
+	{
+		return extent > 0.0f ? extent : 1.0f;
+	}
+}
+
+VertexFormat util::compactVertexFormat()
+{
+	return { PositionFormat::SNORM16, TexCoordFormat::UNORM16, NormalFormat::OCTAHEDRAL_SNORM16 };
+}
+
+glm::vec2 util::octahedralEncode(glm::vec3 normal)
+{
+	normal /= std::abs(normal.x) + std::abs(normal.y) + std::abs(normal.z);
+	glm::vec2 encoded(normal.x, normal.y);
+	//lower hemisphere folds over the diagonals.
+	if (normal.z < 0.0f)
+	{
+		encoded.x = (1.0f - std::abs(normal.y)) * (normal.x >= 0.0f ? 1.0f : -1.0f);
+		encoded.y = (1.0f - std::abs(normal.x)) * (normal.y >= 0.0f ? 1.0f : -1.0f);
+	}
+	return encoded;
+}
+
+std::vector<unsigned char> util::packVertices(MeshData& mesh, VertexFormat format)
+{
+	VertexLayout layout = floatVertexLayout();
+
+	uint32_t offset = 0;
+	switch (format.position)
+	{
+	case PositionFormat::FLOAT:
+		layout.attributes[0] = { 3, GL_FLOAT, GL_FALSE, offset };
+		offset += 3 * sizeof(float);
+		break;
+	case PositionFormat::SNORM16:
+		layout.attributes[0] = { 3, GL_SHORT, GL_TRUE, offset };
+		offset += 3 * sizeof(int16_t);
+		break;
+	case PositionFormat::HALF:
+		layout.attributes[0] = { 3, GL_HALF_FLOAT, GL_FALSE, offset };
+		offset += 3 * sizeof(uint16_t);
+		break;
+	}
+
+	offset = alignAttribute(offset);
+	switch (format.texCoord)
+	{
+	case TexCoordFormat::FLOAT:
+		layout.attributes[1] = { 2, GL_FLOAT, GL_FALSE, offset };
+		offset += 2 * sizeof(float);
+		break;
+	case TexCoordFormat::HALF:
+		layout.attributes[1] = { 2, GL_HALF_FLOAT, GL_FALSE, offset };
+		offset += 2 * sizeof(uint16_t);
+		break;
+	case TexCoordFormat::UNORM16:
+		layout.attributes[1] = { 2, GL_UNSIGNED_SHORT, GL_TRUE, offset };
+		offset += 2 * sizeof(uint16_t);
+		break;
+	}
+
+	offset = alignAttribute(offset);
+	switch (format.normal)
+	{
+	case NormalFormat::FLOAT:
+		layout.attributes[2] = { 3, GL_FLOAT, GL_FALSE, offset };
+		offset += 3 * sizeof(float);
+		break;
+	case NormalFormat::OCTAHEDRAL_SNORM16:
+		layout.attributes[2] = { 2, GL_SHORT, GL_TRUE, offset };
+		offset += 2 * sizeof(int16_t);
+		layout.octahedralNormals = 1;
+		break;
+	}
+	layout.stride = alignAttribute(offset);
+
+	glm::vec3 center = 0.5f * (mesh.boundsMin + mesh.boundsMax);
+	glm::vec3 halfExtent = 0.5f * (mesh.boundsMax - mesh.boundsMin);
+	glm::vec2 texCoordMin(std::numeric_limits<float>::max()), texCoordMax(-std::numeric_limits<float>::max());
+	for (unsigned int v = 0; v < mesh.vertexCount; ++v)
+	{
+		texCoordMin = glm::min(texCoordMin, glm::make_vec2(&mesh.vertices[8 * v + 3]));
+		texCoordMax = glm::max(texCoordMax, glm::make_vec2(&mesh.vertices[8 * v + 3]));
+	}
+
+	if (format.position == PositionFormat::SNORM16)
+	{
+		for (int i = 0; i < 3; ++i)
+		{
+			layout.positionOffset[i] = center[i];
+			layout.positionScale[i] = safeScale(halfExtent[i]);
+		}
+	}
+	if (format.texCoord == TexCoordFormat::UNORM16 && mesh.vertexCount > 0)
+	{
+		for (int i = 0; i < 2; ++i)
+		{
+			layout.texCoordOffset[i] = texCoordMin[i];
+			layout.texCoordScale[i] = safeScale(texCoordMax[i] - texCoordMin[i]);
+		}
+	}
+
+	std::vector<unsigned char> packed(size_t(mesh.vertexCount) * layout.stride, 0);
+	for (unsigned int v = 0; v < mesh.vertexCount; ++v)
+	{
+		const float* source = &mesh.vertices[8 * v];
+		unsigned char* vertex = &packed[size_t(v) * layout.stride];
+
+		float* position = reinterpret_cast<float*>(vertex + layout.attributes[0].offset);
+		uint16_t* quantizedPosition = reinterpret_cast<uint16_t*>(vertex + layout.attributes[0].offset);
+		for (int i = 0; i < 3; ++i)
+		{
+			if (format.position == PositionFormat::FLOAT)
+				position[i] = source[i];
+			else if (format.position == PositionFormat::SNORM16)
+				quantizedPosition[i] = glm::packSnorm1x16((source[i] - layout.positionOffset[i]) / layout.positionScale[i]);
+			else
+				quantizedPosition[i] = glm::packHalf1x16(source[i]);
+		}
+
+		float* texCoord = reinterpret_cast<float*>(vertex + layout.attributes[1].offset);
+		uint16_t* quantizedTexCoord = reinterpret_cast<uint16_t*>(vertex + layout.attributes[1].offset);
+		for (int i = 0; i < 2; ++i)
+		{
+			if (format.texCoord == TexCoordFormat::FLOAT)
+				texCoord[i] = source[3 + i];
+			else if (format.texCoord == TexCoordFormat::HALF)
+				quantizedTexCoord[i] = glm::packHalf1x16(source[3 + i]);
+			else
+				quantizedTexCoord[i] = glm::packUnorm1x16((source[3 + i] - layout.texCoordOffset[i]) / layout.texCoordScale[i]);
+		}
+
+		glm::vec3 normal = glm::make_vec3(source + 5);
+		if (format.normal == NormalFormat::FLOAT)
+			memcpy(vertex + layout.attributes[2].offset, source + 5, 3 * sizeof(float));
+		else
+		{
+			glm::vec2 encoded = octahedralEncode(normal);
+			uint16_t* quantizedNormal = reinterpret_cast<uint16_t*>(vertex + layout.attributes[2].offset);
+			quantizedNormal[0] = glm::packSnorm1x16(encoded.x);
+			quantizedNormal[1] = glm::packSnorm1x16(encoded.y);
+		}
+	}
+
+	mesh.layout = layout;
+	return packed;
+}
@@ -0,0 +1,39 @@
+#pragma once
+#include "../config.h"
+#include "objectLoader.h"
+
+enum class PositionFormat : uint32_t
+{
+	FLOAT, SNORM16, HALF
+};
+
+enum class TexCoordFormat : uint32_t
+{
+	FLOAT, HALF, UNORM16
+};
+
+enum class NormalFormat : uint32_t
+{
+	FLOAT, OCTAHEDRAL_SNORM16
+};
+
+//how each attribute gets stored on the gpu, all FLOAT is the 32 byte vertex objLoadFromFile makes.
+struct VertexFormat
+{
+	PositionFormat position;
+	TexCoordFormat texCoord;
+	NormalFormat normal;
+};
+
+namespace util
+{
+	//snorm16 position, unorm16 texcoord and octahedral normal, 16 bytes per vertex.
+	VertexFormat compactVertexFormat();
+
+	//converts the float vertices to the requested format and sets mesh.layout to match.
+	//snorm16 positions are relative to the mesh bounds and unorm16 texcoords to the texcoord bounds.
+	std::vector<unsigned char> packVertices(MeshData& mesh, VertexFormat format);
+
+	//maps a unit vector onto the octahedron, folded into the [-1, 1] square.
+	glm::vec2 octahedralEncode(glm::vec3 normal);
+}
@@ -0,0 +1,240 @@
+#include "vertexTransform.h"
+
+//msvc only defines __AVX2__ under /arch:AVX2 and never __SSE2__, sse2 is implied on x64.
+#if defined(__AVX2__)
+#define VERTEX_TRANSFORM_AVX2
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define VERTEX_TRANSFORM_SSE
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+	const size_t blockSize = 8;
+
+	//one block of 8 vertices split into separate x, y and z lanes.
+	struct alignas(32) SoaBlock
+	{
+		float x[blockSize], y[blockSize], z[blockSize];
+	};
+
+	void loadBlock(const float* source, SoaBlock& block)
+	{
+		for (size_t i = 0; i < blockSize; ++i)
+		{
+			block.x[i] = source[3 * i];
+			block.y[i] = source[3 * i + 1];
+			block.z[i] = source[3 * i + 2];
+		}
+	}
+
+	void storeBlock(const SoaBlock& block, float* destination)
+	{
+		for (size_t i = 0; i < blockSize; ++i)
+		{
+			destination[3 * i] = block.x[i];
+			destination[3 * i + 1] = block.y[i];
+			destination[3 * i + 2] = block.z[i];
+		}
+	}
+
+	//rows of the matrix broadcast once per call, translation is zero for normals.
+	void transformBlock(SoaBlock& block, const glm::mat4& m, bool translate, bool normalize)
+	{
+#if defined(VERTEX_TRANSFORM_AVX2)
+		__m256 x = _mm256_load_ps(block.x);
+		__m256 y = _mm256_load_ps(block.y);
+		__m256 z = _mm256_load_ps(block.z);
+		__m256 out[3];
+		for (int row = 0; row < 3; ++row)
+		{
+			__m256 sum = _mm256_mul_ps(_mm256_set1_ps(m[0][row]), x);
+			sum = _mm256_add_ps(sum, _mm256_mul_ps(_mm256_set1_ps(m[1][row]), y));
+			sum = _mm256_add_ps(sum, _mm256_mul_ps(_mm256_set1_ps(m[2][row]), z));
+			if (translate)
+				sum = _mm256_add_ps(sum, _mm256_set1_ps(m[3][row]));
+			out[row] = sum;
+		}
+		if (normalize)
+		{
+			__m256 length = _mm256_mul_ps(out[0], out[0]);
+			length = _mm256_add_ps(length, _mm256_mul_ps(out[1], out[1]));
+			length = _mm256_add_ps(length, _mm256_mul_ps(out[2], out[2]));
+			length = _mm256_max_ps(_mm256_sqrt_ps(length), _mm256_set1_ps(1e-20f));
+			for (int row = 0; row < 3; ++row)
+				out[row] = _mm256_div_ps(out[row], length);
+		}
+		_mm256_store_ps(block.x, out[0]);
+		_mm256_store_ps(block.y, out[1]);
+		_mm256_store_ps(block.z, out[2]);
+#elif defined(VERTEX_TRANSFORM_SSE)
+		//two 4 wide halves per block.
+		for (size_t half = 0; half < blockSize; half += 4)
+		{
+			__m128 x = _mm_load_ps(block.x + half);
+			__m128 y = _mm_load_ps(block.y + half);
+			__m128 z = _mm_load_ps(block.z + half);
+			__m128 out[3];
+			for (int row = 0; row < 3; ++row)
+			{
+				__m128 sum = _mm_mul_ps(_mm_set1_ps(m[0][row]), x);
+				sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(m[1][row]), y));
+				sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(m[2][row]), z));
+				if (translate)
+					sum = _mm_add_ps(sum, _mm_set1_ps(m[3][row]));
+				out[row] = sum;
+			}
+			if (normalize)
+			{
+				__m128 length = _mm_mul_ps(out[0], out[0]);
+				length = _mm_add_ps(length, _mm_mul_ps(out[1], out[1]));
+				length = _mm_add_ps(length, _mm_mul_ps(out[2], out[2]));
+				length = _mm_max_ps(_mm_sqrt_ps(length), _mm_set1_ps(1e-20f));
+				for (int row = 0; row < 3; ++row)
+					out[row] = _mm_div_ps(out[row], length);
+			}
+			_mm_store_ps(block.x + half, out[0]);
+			_mm_store_ps(block.y + half, out[1]);
+			_mm_store_ps(block.z + half, out[2]);
+		}
+#else
+		for (size_t i = 0; i < blockSize; ++i)
+		{
+			glm::vec3 v = glm::mat3(m) * glm::vec3(block.x[i], block.y[i], block.z[i]);
+			if (translate)
+				v += glm::vec3(m[3]);
+			if (normalize)
+				v /= std::max(glm::length(v), 1e-20f);
+			block.x[i] = v.x;
+			block.y[i] = v.y;
+			block.z[i] = v.z;
+		}
+#endif
+	}
+
+	const char* kernelName()
+	{
+#if defined(VERTEX_TRANSFORM_AVX2)
+		return "avx2";
+#elif defined(VERTEX_TRANSFORM_SSE)
+		return "sse2";
+#else
+		return "scalar";
+#endif
+	}
+
+	//best time of repeats runs in milliseconds, every run starts from a fresh copy of source.
+	template <typename Transform>
+	double bestTime(const std::vector<float>& source, std::vector<float>& result, int repeats, Transform transform)
+	{
+		double best = std::numeric_limits<double>::max();
+		for (int i = 0; i < repeats; ++i)
+		{
+			result = source;
+			auto start = std::chrono::high_resolution_clock::now();
+			transform(result.data(), result.size() / 3);
+			std::chrono::duration<double, std::milli> elapsed = std::chrono::high_resolution_clock::now() - start;
+			best = std::min(best, elapsed.count());
+		}
+		return best;
+	}
+
+	float largestDifference(const std::vector<float>& a, const std::vector<float>& b)
+	{
+		float largest = 0.0f;
+		for (size_t i = 0; i < a.size(); ++i)
+			largest = std::max(largest, std::abs(a[i] - b[i]));
+		return largest;
+	}
+
+	void transformAll(float* data, size_t count, const glm::mat4& transform, bool translate, bool normalize)
+	{
+		SoaBlock block;
+		size_t full = count - count % blockSize;
+		for (size_t i = 0; i < full; i += blockSize)
+		{
+			loadBlock(data + 3 * i, block);
+			transformBlock(block, transform, translate, normalize);
+			storeBlock(block, data + 3 * i);
+		}
+
+		//pad the tail out to a whole block so it takes the same path.
+		size_t tail = count - full;
+		if (tail > 0)
+		{
+			float padded[3 * blockSize] = {};
+			memcpy(padded, data + 3 * full, 3 * tail * sizeof(float));
+			loadBlock(padded, block);
+			transformBlock(block, transform, translate, normalize);
+			storeBlock(block, padded);
+			memcpy(data + 3 * full, padded, 3 * tail * sizeof(float));
+		}
+	}
+}
+
+void util::transformPositions(float* positions, size_t count, const glm::mat4& transform)
+{
+	transformAll(positions, count, transform, true, false);
+}
+
+void util::transformNormals(float* normals, size_t count, const glm::mat4& transform)
+{
+	transformAll(normals, count, transform, false, true);
+}
+
+void util::benchmarkVertexTransform(size_t count, int repeats)
+{
+	//a fixed seed so runs compare, the tail past the last whole block is kept on purpose.
+	std::vector<float> positions(3 * count), normals(3 * count);
+	uint32_t state = 12345;
+	for (size_t i = 0; i < positions.size(); ++i)
+	{
+		state = state * 1664525u + 1013904223u;
+		positions[i] = float(state >> 8) / float(1 << 24) * 200.0f - 100.0f;
+		normals[i] = float(state & 0xffff) / 65535.0f * 2.0f - 1.0f;
+	}
+	glm::mat4 transform = glm::translate(glm::mat4(1.0f), glm::vec3(1.0f, -2.0f, 3.0f))
+		* glm::rotate(glm::mat4(1.0f), 0.7f, glm::normalize(glm::vec3(1.0f, 2.0f, 3.0f)))
+		* glm::scale(glm::mat4(1.0f), glm::vec3(2.0f, 0.5f, 1.5f));
+
+	std::vector<float> scalarResult, kernelResult;
+	double scalarPositions = bestTime(positions, scalarResult, repeats, [&](float* p, size_t n)
+	{
+		for (size_t i = 0; i < n; ++i)
+		{
+			glm::vec4 position = transform * glm::vec4(p[3 * i], p[3 * i + 1], p[3 * i + 2], 1.0f);
+			p[3 * i] = position.x;
+			p[3 * i + 1] = position.y;
+			p[3 * i + 2] = position.z;
+		}
+	});
+	double kernelPositions = bestTime(positions, kernelResult, repeats, [&](float* p, size_t n)
+	{
+		transformPositions(p, n, transform);
+	});
+	float positionDifference = largestDifference(scalarResult, kernelResult);
+
+	double scalarNormals = bestTime(normals, scalarResult, repeats, [&](float* p, size_t n)
+	{
+		glm::mat3 rotation(transform);
+		for (size_t i = 0; i < n; ++i)
+		{
+			glm::vec3 normal = glm::normalize(rotation * glm::vec3(p[3 * i], p[3 * i + 1], p[3 * i + 2]));
+			p[3 * i] = normal.x;
+			p[3 * i + 1] = normal.y;
+			p[3 * i + 2] = normal.z;
+		}
+	});
+	double kernelNormals = bestTime(normals, kernelResult, repeats, [&](float* p, size_t n)
+	{
+		transformNormals(p, n, transform);
+	});
+	float normalDifference = largestDifference(scalarResult, kernelResult);
+
+	std::cout << count << " vertices, best of " << repeats << ", " << kernelName() << " kernel\n" << std::fixed << std::setprecision(3)
+		<< "positions: mat4 " << scalarPositions << " ms, kernel " << kernelPositions << " ms, "
+		<< scalarPositions / kernelPositions << "x, largest difference " << positionDifference << '\n'
+		<< "normals: mat3 " << scalarNormals << " ms, kernel " << kernelNormals << " ms, "
+		<< scalarNormals / kernelNormals << "x, largest difference " << normalDifference << '\n';
+}
\ No newline at end of file
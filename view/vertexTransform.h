@@ -0,0 +1,15 @@
+#pragma once
+#include "../config.h"
+
+namespace util
+{
+	//transforms xyz triples in place with w taken as 1, 8 at a time as soa blocks.
+	void transformPositions(float* positions, size_t count, const glm::mat4& transform);
+
+	//transforms xyz normals in place by the upper 3x3 and renormalizes them.
+	void transformNormals(float* normals, size_t count, const glm::mat4& transform);
+
+	//times both kernels against the per vertex mat4 path the obj loader used before them on count
+	//made up vertices, best of repeats, and prints the results and the largest difference.
+	void benchmarkVertexTransform(size_t count, int repeats);
+}
@@ -0,0 +1,355 @@
+#include "virtualTexture.h"
+
+namespace
+{
+	//set in loading for pages that couldn't be read, so they aren't requested again every frame.
+	const unsigned char pageFailed = 2;
+}
+
+VirtualTexture::VirtualTexture(VirtualTextureCreateInfo* createInfo)
+	: filename(createInfo->filename), uploads(createInfo->uploads), header{}, rootPage(0), uploadsPerFrame(std::max(1u, createInfo->uploadsPerFrame)),
+	maxPendingPages(std::max(1u, createInfo->maxPendingPages)), frame(0), pageTableDirty(false), feedbackIndex(0), ringFull(false), stopping(false)
+{
+	physical = pageTable = 0;
+	physicalPagesPerSide = int(std::min(std::max(createInfo->physicalPagesPerSide, 1u), 256u));
+	feedbackBuffers.fill(0);
+	feedbackFences.fill(nullptr);
+
+	std::ifstream file(filename, std::ios::binary);
+	file.read(reinterpret_cast<char*>(&header), sizeof(header));
+	if (!file || memcmp(header.magic, virtualTextureMagic, sizeof(header.magic)) != 0 || header.version != virtualTextureVersion
+		|| header.levelCount == 0 || header.levelCount > virtualTextureMaxLevels
+		|| header.levelCount != util::virtualLevelCount(header.width, header.height))
+	{
+		std::cout << "Failed to open virtual texture " << filename << '\n';
+		header.levelCount = 0;
+		return;
+	}
+
+	for (uint32_t l = 0, first = 0; l <= header.levelCount; ++l)
+	{
+		levelFirstPage.push_back(first);
+		if (l < header.levelCount)
+		{
+			glm::ivec2 pages = util::virtualLevelPages(header.width, header.height, l);
+			first += uint32_t(pages.x * pages.y);
+		}
+	}
+	if (levelFirstPage.back() != header.pageCount)
+	{
+		std::cout << "Virtual texture " << filename << " has a broken page count\n";
+		header.levelCount = 0;
+		return;
+	}
+	rootPage = levelFirstPage[header.levelCount - 1];
+
+	int physicalSize = physicalPagesPerSide * virtualPageStride;
+	glCreateTextures(GL_TEXTURE_2D, 1, &physical);
+	glTextureParameteri(physical, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTextureParameteri(physical, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTextureParameteri(physical, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTextureParameteri(physical, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTextureStorage2D(physical, 1, GL_RGBA8, physicalSize, physicalSize);
+
+	//integer texture, it's only ever fetched.
+	glm::ivec2 tablePages = util::virtualLevelPages(header.width, header.height, 0);
+	glCreateTextures(GL_TEXTURE_2D, 1, &pageTable);
+	glTextureParameteri(pageTable, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+	glTextureParameteri(pageTable, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTextureStorage2D(pageTable, header.levelCount, GL_RGBA8UI, tablePages.x, tablePages.y);
+
+	requestBits.resize((header.pageCount + 31) / 32);
+	glCreateBuffers(int(feedbackCount), feedbackBuffers.data());
+	for (unsigned int buffer : feedbackBuffers)
+		glNamedBufferStorage(buffer, requestBits.size() * sizeof(uint32_t), nullptr, 0);
+
+	pageSlots.assign(header.pageCount, -1);
+	lastUsed.assign(header.pageCount, 0);
+	loading.assign(header.pageCount, 0);
+	slotPages.assign(size_t(physicalPagesPerSide) * physicalPagesPerSide, -1);
+	for (size_t slot = slotPages.size(); slot-- > 0;)
+		freeSlots.push_back(int(slot));
+
+	//the root covers the whole texture, it's what gets sampled while nothing else is resident.
+	LoadedPage root;
+	root.page = rootPage;
+	if (!uploads->allocate(virtualPageBytes, root.region))
+		std::cout << "The root page of " << filename << " doesn't fit the upload ring\n";
+	else if (readPage(file, rootPage, root.region.data))
+		upload(root);
+	else
+	{
+		std::cout << "Failed to read the root page of " << filename << '\n';
+		uploads->release(root.region);
+	}
+	rebuildPageTable();
+
+	loader = std::thread(&VirtualTexture::loaderLoop, this);
+}
+
+VirtualTexture::~VirtualTexture()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	wake.notify_all();
+	if (loader.joinable())
+		loader.join();
+
+	//loaded pages that never got uploaded.
+	for (const LoadedPage& page : loaded)
+		uploads->release(page.region);
+
+	for (GLsync fence : feedbackFences)
+		if (fence)
+			glDeleteSync(fence);
+	if (feedbackBuffers[0])
+		glDeleteBuffers(int(feedbackCount), feedbackBuffers.data());
+	glDeleteTextures(1, &physical);
+	glDeleteTextures(1, &pageTable);
+}
+
+bool VirtualTexture::readPage(std::ifstream& file, uint32_t page, unsigned char* data)
+{
+	file.clear();
+	file.seekg(header.pageOffset + uint64_t(page) * virtualPageBytes);
+	file.read(reinterpret_cast<char*>(data), virtualPageBytes);
+	return bool(file);
+}
+
+void VirtualTexture::loaderLoop()
+{
+	std::ifstream file(filename, std::ios::binary);
+	std::unique_lock<std::mutex> lock(mutex);
+	while (true)
+	{
+		wake.wait(lock, [this] { return stopping || (!requests.empty() && loaded.size() < maxPendingPages && !ringFull); });
+		if (stopping)
+			return;
+
+		LoadedPage page;
+		page.page = requests.back();
+		if (!uploads->allocate(virtualPageBytes, page.region))
+		{
+			ringFull = true;
+			continue;
+		}
+		requests.pop_back();
+		loading[page.page] = 1;
+
+		//the render thread keeps going while the disk is busy.
+		lock.unlock();
+		bool read = readPage(file, page.page, page.region.data);
+		lock.lock();
+
+		if (read)
+			loaded.push_back(page);
+		else
+		{
+			std::cout << "Failed to read virtual texture page " << page.page << " of " << filename << '\n';
+			uploads->release(page.region);
+			loading[page.page] = pageFailed;
+		}
+	}
+}
+
+uint32_t VirtualTexture::pageLevel(uint32_t page)
+{
+	return uint32_t(std::upper_bound(levelFirstPage.begin(), levelFirstPage.end(), page) - levelFirstPage.begin() - 1);
+}
+
+int VirtualTexture::parentPage(uint32_t page)
+{
+	uint32_t level = pageLevel(page);
+	if (level + 1 >= header.levelCount)
+		return -1;
+
+	glm::ivec2 pages = util::virtualLevelPages(header.width, header.height, level);
+	glm::ivec2 parentPages = util::virtualLevelPages(header.width, header.height, level + 1);
+	uint32_t local = page - levelFirstPage[level];
+	int x = int(local % pages.x) / 2, y = int(local / pages.x) / 2;
+	return int(levelFirstPage[level + 1] + y * parentPages.x + x);
+}
+
+void VirtualTexture::upload(const LoadedPage& page)
+{
+	//evict the least recently wanted page that no frame still in flight asked for.
+	if (freeSlots.empty())
+	{
+		int victim = -1;
+		for (size_t slot = 0; slot < slotPages.size(); ++slot)
+		{
+			int resident = slotPages[slot];
+			if (resident < 0 || uint32_t(resident) == rootPage || lastUsed[resident] + feedbackCount >= frame)
+				continue;
+			if (victim < 0 || lastUsed[resident] < lastUsed[slotPages[victim]])
+				victim = int(slot);
+		}
+		//everything resident is in use, the page gets requested again once something isn't.
+		if (victim < 0)
+		{
+			uploads->release(page.region);
+			return;
+		}
+
+		pageSlots[slotPages[victim]] = -1;
+		slotPages[victim] = -1;
+		freeSlots.push_back(victim);
+	}
+
+	int slot = freeSlots.back();
+	freeSlots.pop_back();
+	uploads->copyToTexture(page.region, 0, physical, 0, (slot % physicalPagesPerSide) * virtualPageStride, (slot / physicalPagesPerSide) * virtualPageStride,
+		virtualPageStride, virtualPageStride, GL_RGBA, GL_UNSIGNED_BYTE);
+	uploads->release(page.region);
+
+	pageSlots[page.page] = slot;
+	slotPages[slot] = int(page.page);
+	lastUsed[page.page] = frame;
+	pageTableDirty = true;
+}
+
+void VirtualTexture::rebuildPageTable()
+{
+	//coarsest level first, a missing page points wherever its parent points.
+	std::vector<unsigned char> entries, parentEntries;
+	glm::ivec2 parentPages(1);
+	for (uint32_t l = header.levelCount; l-- > 0;)
+	{
+		glm::ivec2 pages = util::virtualLevelPages(header.width, header.height, l);
+		entries.assign(4 * size_t(pages.x) * pages.y, 0);
+		for (int y = 0; y < pages.y; ++y)
+			for (int x = 0; x < pages.x; ++x)
+			{
+				unsigned char* entry = &entries[4 * (size_t(y) * pages.x + x)];
+				int slot = pageSlots[levelFirstPage[l] + y * pages.x + x];
+				if (slot >= 0)
+				{
+					entry[0] = (unsigned char)(slot % physicalPagesPerSide);
+					entry[1] = (unsigned char)(slot / physicalPagesPerSide);
+					entry[2] = (unsigned char)l;
+					entry[3] = 255;
+				}
+				else if (l + 1 < header.levelCount)
+					memcpy(entry, &parentEntries[4 * (size_t(y / 2) * parentPages.x + x / 2)], 4);
+			}
+
+		glTextureSubImage2D(pageTable, int(l), 0, 0, pages.x, pages.y, GL_RGBA_INTEGER, GL_UNSIGNED_BYTE, entries.data());
+		entries.swap(parentEntries);
+		parentPages = pages;
+	}
+	pageTableDirty = false;
+}
+
+void VirtualTexture::readRequests(size_t feedback)
+{
+	glGetNamedBufferSubData(feedbackBuffers[feedback], 0, requestBits.size() * sizeof(uint32_t), requestBits.data());
+	for (size_t word = 0; word < requestBits.size(); ++word)
+		for (uint32_t bits = requestBits[word]; bits; bits &= bits - 1)
+		{
+			uint32_t page = uint32_t(word * 32);
+			for (uint32_t bit = bits; !(bit & 1); bit >>= 1)
+				++page;
+
+			//the ancestors are what gets sampled until the page arrives, they're wanted as well.
+			for (int wantedPage = int(page); wantedPage >= 0; wantedPage = parentPage(uint32_t(wantedPage)))
+			{
+				if (lastUsed[wantedPage] == frame)
+					break;
+				lastUsed[wantedPage] = frame;
+				if (pageSlots[wantedPage] < 0 && !loading[wantedPage])
+					wanted.push_back(std::make_pair(pageLevel(uint32_t(wantedPage)), uint32_t(wantedPage)));
+			}
+		}
+}
+
+void VirtualTexture::update()
+{
+	if (header.levelCount == 0)
+		return;
+	++frame;
+
+	//only frames the gpu has finished, waiting on the others would stall.
+	wanted.clear();
+	bool readBack = false;
+	for (size_t i = 0; i < feedbackCount; ++i)
+	{
+		if (!feedbackFences[i])
+			continue;
+		GLenum status = glClientWaitSync(feedbackFences[i], 0, 0);
+		if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+			continue;
+		glDeleteSync(feedbackFences[i]);
+		feedbackFences[i] = nullptr;
+		readRequests(i);
+		readBack = true;
+	}
+
+	std::vector<LoadedPage> pages;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		while (!loaded.empty() && pages.size() < uploadsPerFrame)
+		{
+			pages.push_back(loaded.front());
+			loaded.pop_front();
+			loading[pages.back().page] = 0;
+		}
+		//the last submit may have freed ring space.
+		ringFull = false;
+	}
+	for (const LoadedPage& page : pages)
+		upload(page);
+	if (pageTableDirty)
+		rebuildPageTable();
+
+	//replaces the last requests, pages nobody wants anymore are never read.
+	//sorted by level, the loader takes the coarsest from the back first.
+	if (!readBack)
+		return;
+	std::sort(wanted.begin(), wanted.end());
+	size_t maxRequests = 4 * size_t(maxPendingPages);
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		requests.clear();
+		for (size_t i = wanted.size() > maxRequests ? wanted.size() - maxRequests : 0; i < wanted.size(); ++i)
+			if (!loading[wanted[i].second])
+				requests.push_back(wanted[i].second);
+	}
+	wake.notify_one();
+}
+
+void VirtualTexture::use(const VirtualTextureLocation& location)
+{
+	if (header.levelCount == 0)
+		return;
+
+	//a buffer still unread a full ring later is stale, it gets dropped.
+	GLsync& fence = feedbackFences[feedbackIndex];
+	if (fence)
+	{
+		glDeleteSync(fence);
+		fence = nullptr;
+	}
+	glClearNamedBufferData(feedbackBuffers[feedbackIndex], GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, nullptr);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, virtualRequestBinding, feedbackBuffers[feedbackIndex]);
+	glBindTextureUnit(virtualPhysicalUnit, physical);
+	glBindTextureUnit(virtualPageTableUnit, pageTable);
+
+	glUniform1i(location.enabled, 1);
+	glUniform2i(location.size, int(header.width), int(header.height));
+	glUniform1i(location.levelCount, int(header.levelCount));
+	glUniform1uiv(location.levelFirstPage, header.levelCount, levelFirstPage.data());
+}
+
+void VirtualTexture::finish(const VirtualTextureLocation& location)
+{
+	if (header.levelCount == 0)
+		return;
+
+	glUniform1i(location.enabled, 0);
+	//the shader's atomics have to land before the buffer is read back.
+	glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+	feedbackFences[feedbackIndex] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	feedbackIndex = (feedbackIndex + 1) % feedbackCount;
+}
@@ -0,0 +1,107 @@
+#pragma once
+#include "../config.h"
+#include "virtualTextureFile.h"
+#include "uploadRing.h"
+
+//texture units of the physical pages and the page table, right after the texture arrays. fragment.txt
+//binds its samplers to them.
+const unsigned int virtualPhysicalUnit = 14;
+const unsigned int virtualPageTableUnit = 15;
+//shader storage binding of the page request bits, 1 holds the materials.
+const unsigned int virtualRequestBinding = 2;
+
+struct VirtualTextureCreateInfo
+{
+	const char* filename;
+	//the physical texture holds this many pages along each side, at most 256.
+	unsigned int physicalPagesPerSide;
+	//pages the loader thread may hold in ram before the render thread uploads them.
+	unsigned int maxPendingPages;
+	//bounds the hitch when the camera turns towards something with nothing resident.
+	unsigned int uploadsPerFrame;
+	//pages are read straight into it.
+	UploadRing* uploads;
+};
+
+//fragment shader uniforms of the virtual texture path.
+struct VirtualTextureLocation
+{
+	unsigned int enabled, size, levelCount, levelFirstPage;
+};
+
+//samples a paged texture with a fixed memory footprint, however large the file is.
+//the fragment shader sets a bit for every page it wanted and samples the closest resident ancestor
+//through the page table meanwhile. the bits are read back a few frames later without stalling, the
+//missing pages get read on a loader thread, coarsest first, and the least recently wanted evicted.
+class VirtualTexture
+{
+public:
+	//physical page cache and page table, the table has one texel per page and a level per level.
+	unsigned int physical, pageTable;
+
+	VirtualTexture(VirtualTextureCreateInfo* createInfo);
+	~VirtualTexture();
+
+	//reads back finished request bits, uploads loaded pages and queues what's still missing.
+	//call once a frame before drawing.
+	void update();
+	//binds the textures and a cleared request buffer and turns the virtual path on.
+	void use(const VirtualTextureLocation& location);
+	//turns the virtual path off again and fences this frame's requests for update.
+	void finish(const VirtualTextureLocation& location);
+
+private:
+	struct LoadedPage
+	{
+		uint32_t page;
+		UploadRegion region;
+	};
+
+	void loaderLoop();
+	bool readPage(std::ifstream& file, uint32_t page, unsigned char* data);
+	void upload(const LoadedPage& page);
+	void readRequests(size_t feedback);
+	uint32_t pageLevel(uint32_t page);
+	//the page covering the same texels one level up, or -1 for the root.
+	int parentPage(uint32_t page);
+	void rebuildPageTable();
+
+	std::string filename;
+	UploadRing* uploads;
+	VirtualTextureHeader header;
+	//first page of every level, plus the page count at the end.
+	std::vector<uint32_t> levelFirstPage;
+	uint32_t rootPage;
+	unsigned int uploadsPerFrame, maxPendingPages;
+	int physicalPagesPerSide;
+
+	//slot of every resident page or -1, and the frame it was last wanted.
+	std::vector<int> pageSlots;
+	std::vector<uint64_t> lastUsed;
+	//page in every slot or -1.
+	std::vector<int> slotPages;
+	std::vector<int> freeSlots;
+	uint64_t frame;
+	bool pageTableDirty;
+
+	//request bits, one buffer per frame in flight. a fence is set while a buffer waits to be read.
+	static const size_t feedbackCount = 3;
+	std::array<unsigned int, feedbackCount> feedbackBuffers;
+	std::array<GLsync, feedbackCount> feedbackFences;
+	size_t feedbackIndex;
+	std::vector<uint32_t> requestBits;
+	//level and page of everything wanted but not resident.
+	std::vector<std::pair<uint32_t, uint32_t>> wanted;
+
+	//shared with the loader, guarded by mutex. requests are sorted so the coarsest is at the back.
+	std::thread loader;
+	std::mutex mutex;
+	std::condition_variable wake;
+	std::vector<uint32_t> requests;
+	std::deque<LoadedPage> loaded;
+	//set from the moment the loader takes a request until the page gets uploaded.
+	std::vector<unsigned char> loading;
+	//set when the loader couldn't get ring space, it waits for the next frame to free some.
+	bool ringFull;
+	bool stopping;
+};
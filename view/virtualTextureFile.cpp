@@ -0,0 +1,105 @@
+#include "virtualTextureFile.h"
+#include "image.h"
+#include "mipChain.h"
+
+namespace
+{
+	bool powerOfTwo(int value)
+	{
+		return value > 0 && (value & (value - 1)) == 0;
+	}
+
+	//copies one page with its border, texels outside the level repeat the edge.
+	void cutPage(const MipLevel& level, int pageX, int pageY, std::vector<unsigned char>& page)
+	{
+		for (int y = 0; y < virtualPageStride; ++y)
+		{
+			int sourceY = std::min(std::max(pageY * virtualPageSize + y - virtualPageBorder, 0), level.height - 1);
+			for (int x = 0; x < virtualPageStride; ++x)
+			{
+				int sourceX = std::min(std::max(pageX * virtualPageSize + x - virtualPageBorder, 0), level.width - 1);
+				memcpy(&page[4 * (size_t(y) * virtualPageStride + x)], &level.pixels[4 * (size_t(sourceY) * level.width + sourceX)], 4);
+			}
+		}
+	}
+}
+
+glm::ivec2 util::virtualLevelPages(uint32_t width, uint32_t height, uint32_t level)
+{
+	int levelWidth = std::max(1, int(width >> level)), levelHeight = std::max(1, int(height >> level));
+	return glm::ivec2((levelWidth + virtualPageSize - 1) / virtualPageSize, (levelHeight + virtualPageSize - 1) / virtualPageSize);
+}
+
+uint32_t util::virtualLevelCount(uint32_t width, uint32_t height)
+{
+	uint32_t levels = 1;
+	while (virtualLevelPages(width, height, levels - 1) != glm::ivec2(1))
+		++levels;
+	return levels;
+}
+
+bool util::buildVirtualTexture(const char* imageFilename, const char* virtualFilename)
+{
+	image source = util::loadFromFile(imageFilename);
+	if (!source.pixels)
+	{
+		std::cout << "Failed to load texture " << imageFilename << '\n';
+		return false;
+	}
+	if (!powerOfTwo(source.width) || !powerOfTwo(source.height))
+	{
+		std::cout << "Virtual textures need power of two sides, " << imageFilename << " is "
+			<< source.width << 'x' << source.height << '\n';
+		util::freeImgMem(source);
+		return false;
+	}
+
+	VirtualTextureHeader header{};
+	memcpy(header.magic, virtualTextureMagic, sizeof(header.magic));
+	header.version = virtualTextureVersion;
+	header.width = uint32_t(source.width);
+	header.height = uint32_t(source.height);
+	header.levelCount = virtualLevelCount(header.width, header.height);
+	if (header.levelCount > virtualTextureMaxLevels)
+	{
+		std::cout << imageFilename << " is too large for a virtual texture\n";
+		util::freeImgMem(source);
+		return false;
+	}
+	for (uint32_t l = 0; l < header.levelCount; ++l)
+	{
+		glm::ivec2 pages = virtualLevelPages(header.width, header.height, l);
+		header.pageCount += uint32_t(pages.x * pages.y);
+	}
+	header.pageOffset = sizeof(header);
+
+	std::vector<MipLevel> chain = util::buildMipChain(source.pixels, source.width, source.height);
+	util::freeImgMem(source);
+
+	std::ofstream file(virtualFilename, std::ios::binary | std::ios::trunc);
+	if (!file)
+	{
+		std::cout << "Failed to create " << virtualFilename << '\n';
+		return false;
+	}
+	file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+	std::vector<unsigned char> page(virtualPageBytes);
+	for (uint32_t l = 0; l < header.levelCount; ++l)
+	{
+		glm::ivec2 pages = virtualLevelPages(header.width, header.height, l);
+		for (int y = 0; y < pages.y; ++y)
+			for (int x = 0; x < pages.x; ++x)
+			{
+				cutPage(chain[l], x, y, page);
+				file.write(reinterpret_cast<const char*>(page.data()), page.size());
+			}
+	}
+
+	if (!file)
+	{
+		std::cout << "Failed to write " << virtualFilename << '\n';
+		return false;
+	}
+	return true;
+}
@@ -0,0 +1,39 @@
+#pragma once
+#include "../config.h"
+
+//paged texture file, for textures too large to ever be resident whole.
+//header followed by every page of every level, level 0 first and pages row by row within a level.
+const char virtualTextureMagic[4] = { 'V', 'T', 'E', 'X' };
+const uint32_t virtualTextureVersion = 1;
+//texels of a level one page covers along each axis.
+const int virtualPageSize = 128;
+//texels repeated from the neighbouring pages on every side, so filtering never reads another page.
+const int virtualPageBorder = 4;
+//side of a stored page and of a slot in the physical texture.
+const int virtualPageStride = virtualPageSize + 2 * virtualPageBorder;
+const size_t virtualPageBytes = 4 * size_t(virtualPageStride) * virtualPageStride;
+//enough for a 4 million texel wide texture.
+const uint32_t virtualTextureMaxLevels = 16;
+
+struct VirtualTextureHeader
+{
+	char magic[4];
+	uint32_t version;
+	//power of two sizes, so every page has exactly one parent.
+	uint32_t width, height;
+	//down to the level covered by a single page.
+	uint32_t levelCount, pageCount;
+	uint64_t pageOffset;
+};
+
+namespace util
+{
+	//pages along x and y of a level.
+	glm::ivec2 virtualLevelPages(uint32_t width, uint32_t height, uint32_t level);
+	//levels of a width x height virtual texture.
+	uint32_t virtualLevelCount(uint32_t width, uint32_t height);
+
+	//cuts the rgba8 mip chain of an image with power of two sides into pages and writes them with
+	//their borders. the source has to fit in ram, only the result is streamed.
+	bool buildVirtualTexture(const char* imageFilename, const char* virtualFilename);
+}